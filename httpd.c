@@ -2,13 +2,15 @@
 /* 文件名:    httpd.c                                                        */
 /* 描  述:    轻量HTTP服务器                                                  */
 /* 创  建:    2020-04-12 changzehai                                          */
-/* 更  新:    无                                                             */
+/* 更  新:    2026-10-16 changzehai 改为epoll边沿触发事件驱动模型+工作线程池   */
 /* Copyright 1998 - 2020 CZH. All Rights Reserved                            */
 /*****************************************************************************/
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <ctype.h>
@@ -18,783 +20,9685 @@
 #include <pthread.h>
 #include <sys/wait.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <zlib.h>
+#include <sys/un.h>
+#include <sys/prctl.h>
+#include <spawn.h>
+#include <sched.h>
+#include <linux/filter.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifdef HTTPD_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#endif
+
+
+/*-----------------------------------*/
+/* 宏定义                            */
+/*-----------------------------------*/
+#define SERVER_STRING "Server: httpd/1.0.0\r\n" /* 定义http server名称 */
+
+#define HTTPD_SERVER_PORT  8000  /* 服务监听端口                 */
+#define HTTPD_MAX_EVENTS   1024  /* epoll_wait一次最多返回的事件数 */
+#define HTTPD_LISTEN_BACKLOG  1024  /* 监听socket等待队列长度(默认) */
+#define HTTPD_ACCEPT_BATCH    64    /* 工作线程一次最多accept的连接数 */
+#define HTTPD_ACCEPT_PAUSE_MS 100   /* 文件描述符耗尽时暂停accept的时间(毫秒) */
+#define HTTPD_MAX_CONNS       0     /* 最大连接数(默认0表示按文件描述符上限计算) */
+#define HTTPD_FD_RESERVE      256   /* 为静态文件、CGI管道等保留的文件描述符数(默认) */
+#define HTTPD_RBUF_SIZE    8192  /* 连接接收缓冲区大小(请求行及请求头的最大长度) */
+#define HTTPD_BUF_SIZE     4096  /* 连接收发缓冲区大小            */
+#define HTTPD_SENDFILE_CHUNK  (1024 * 1024)  /* 单次sendfile/splice最大字节数 */
+#define HTTPD_CACHE_SIZE      (32 * 1024)    /* 静态文件缓存默认容量(KB)     */
+#define HTTPD_CACHE_BUCKETS   4096           /* 静态文件缓存哈希桶数         */
+#define HTTPD_HEADER_SIZE     512            /* 预生成回复报文头的最大长度    */
+#define HTTPD_ETAG_SIZE       64             /* ETag最大长度               */
+#define HTTPD_RANGE_MAX       16             /* 单个请求最多接受的Range区间数 */
+#define HTTPD_RANGE_BOUNDARY  "HTTPD_BYTERANGES_3c9d1f"  /* multipart/byteranges分隔符 */
+#define HTTPD_GZIP_MIN_SIZE   256            /* 小于该长度的文件不压缩       */
+#define HTTPD_HEADER_MAX      64             /* 单个请求最多接受的请求头数    */
+#define HTTPD_HEADER_HASH_SIZE 64            /* 已知请求头完美哈希表大小(2的幂) */
+#define HTTPD_PATH_SIZE       4096           /* 请求资源路径最大长度(PATH_MAX) */
+#define HTTPD_PATH_CACHE_SIZE 1024           /* 每个工作线程的路径缓存项数(2的幂) */
+#define HTTPD_PATH_CACHE_KEY  256            /* 可缓存的请求URL路径最大长度   */
+#define HTTPD_PATH_CACHE_TTL  2              /* 路径缓存有效期(秒)           */
+#define HTTPD_DOC_ROOT        "htdocs"       /* 静态文件及CGI程序根目录      */
+#define HTTPD_INDEX_FILE      "index.html"   /* 请求目录时返回的首页文件      */
+#define HTTPD_QUEUE_SIZE   1024  /* 每个工作线程的新连接队列长度   */
+#define HTTPD_STEAL_BATCH  16    /* 一次最多从其他线程窃取的连接数  */
+#define HTTPD_KEEPALIVE_TIMEOUT  15   /* 持久连接空闲超时时间(秒)     */
+#define HTTPD_KEEPALIVE_MAX      100  /* 每个持久连接最多处理的请求数  */
+#define HTTPD_HEADER_TIMEOUT     10   /* 接收请求行及请求头的最长时间(秒，默认) */
+#define HTTPD_BODY_TIMEOUT       30   /* 接收请求体期间无数据的超时时间(秒，默认) */
+#define HTTPD_SEND_TIMEOUT       30   /* 发送回复期间无进展的超时时间(秒，默认) */
+#define HTTPD_BODY_MAX           (1024 * 1024) /* 请求体最大长度(KB，默认)，0表示不限制 */
+#define HTTPD_CGI_TIMEOUT        60   /* CGI程序最长执行时间(秒，默认)   */
+#define HTTPD_TIMER_BITS         6    /* 时间轮每层2^6个槽(每槽1秒)    */
+#define HTTPD_TIMER_SLOTS        (1 << HTTPD_TIMER_BITS)
+#define HTTPD_TIMER_LEVELS       4    /* 时间轮层数，最长定时2^24秒     */
+#define HTTPD_CGI_PIPE_SIZE   (256 * 1024)  /* CGI管道容量                  */
+#define HTTPD_CGI_CHUNK_SIZE  (16 * 1024)   /* CGI输出缓冲区大小，攒满一个chunk即发送 */
+#define HTTPD_CGI_CHUNK_HEAD  10     /* chunk头("长度\r\n")预留长度      */
+#define HTTPD_CGI_FLUSH_MS    20     /* 不足一个chunk的CGI输出最长缓冲时间(毫秒) */
+#define HTTPD_CGI_ENV_SIZE    4096   /* CGI环境变量缓冲区大小            */
+#define HTTPD_CGI_ENV_MAX     32     /* CGI环境变量最大个数              */
+#define HTTPD_CGI_MAX         64     /* 同时运行的CGI程序数上限(默认)     */
+#define HTTPD_CGI_SCRIPT_MAX  16     /* 单个CGI脚本同时运行数上限(默认)   */
+#define HTTPD_CGI_WAIT_MAX    128    /* 等待运行的CGI请求数上限(默认)     */
+#define HTTPD_CGI_WAIT_TIMEOUT 5     /* CGI请求最长等待时间(秒，默认)     */
+#define HTTPD_CGI_BUCKETS     256    /* CGI脚本运行计数哈希桶数           */
+#define HTTPD_FCGI_MAX_APPS   16     /* 最多配置的FastCGI程序数         */
+#define HTTPD_FCGI_MAX_PROCS  64     /* 每个FastCGI程序最多的进程数      */
+#define HTTPD_FCGI_PROCS      2      /* FastCGI程序默认进程数           */
+#define HTTPD_FCGI_BACKLOG    128    /* FastCGI监听socket的等待队列长度  */
+#define HTTPD_FCGI_BUF_SIZE   16384  /* FastCGI收发缓冲区大小           */
+#define HTTPD_CONN_POOL_MAX   256    /* 每个工作线程缓存的空闲连接对象数   */
+#define HTTPD_ARENA_CHUNK     (16 * 1024)  /* 连接内存池的内存块大小      */
+#define HTTPD_ARENA_KEEP      (64 * 1024)  /* 连接对象回收时保留的内存池上限 */
+#define HTTPD_STATUS_PATH     "/server-status"  /* 服务器状态页路径         */
+#define HTTPD_STATUS_SIZE     (64 * 1024)  /* 服务器状态页最大长度          */
+#define HTTPD_LOG_RING_SIZE   (256 * 1024) /* 每个工作线程的访问日志缓冲区大小(2的幂) */
+#define HTTPD_LOG_LINE_SIZE   4096   /* 单条访问日志最大长度            */
+#define HTTPD_LOG_FLUSH_MS    100    /* 访问日志最长刷新间隔(毫秒)       */
+#define HTTPD_LOG_IOV_MAX     64     /* 日志线程一次writev的最大段数      */
+#define HTTPD_HIST_SUB_BITS   4      /* 耗时直方图每个2的幂区间细分为2^4个桶 */
+#define HTTPD_HIST_MAX_BITS   40     /* 耗时直方图记录的最大值2^40ns(约18分钟) */
+#define HTTPD_HIST_BUCKETS    ((HTTPD_HIST_MAX_BITS - HTTPD_HIST_SUB_BITS + 1) << HTTPD_HIST_SUB_BITS)
+
+/* 统计计数只由所属工作线程写入，读写都用relaxed原子操作，不需要加锁 */
+#define HTTPD_STAT_ADD(counter, n) \
+    atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (n), \
+                          memory_order_relaxed)
+
+/* FastCGI协议定义 */
+#define FCGI_VERSION_1        1
+#define FCGI_BEGIN_REQUEST    1
+#define FCGI_END_REQUEST      3
+#define FCGI_PARAMS           4
+#define FCGI_STDIN            5
+#define FCGI_STDOUT           6
+#define FCGI_STDERR           7
+#define FCGI_RESPONDER        1
+#define FCGI_HEADER_LEN       8
+
+/* 回复报文体编码，同时用作Accept-Encoding的位掩码 */
+#define HTTPD_ENC_IDENTITY  0
+#define HTTPD_ENC_GZIP      1
+#define HTTPD_ENC_BR        2
+
+#ifdef HTTPD_IO_URING
+#define HTTPD_URING_ENTRIES   256    /* io_uring提交队列长度              */
+#define HTTPD_URING_CQ_RATIO  16     /* 完成队列长度是提交队列的倍数        */
+#define HTTPD_URING_BUF_NUM   256    /* 每个工作线程提供给内核的接收缓冲区数(2的幂) */
+#define HTTPD_URING_BUF_SIZE  4096   /* 单个接收缓冲区大小                */
+#define HTTPD_URING_BGID      0      /* 接收缓冲区组ID                   */
+
+/* io_uring请求类型，保存在user_data低3位，高位为所属连接地址 */
+#define HTTPD_URING_ACCEPT      1    /* multishot accept           */
+#define HTTPD_URING_RECV        2    /* 从内核提供的缓冲区中接收请求  */
+#define HTTPD_URING_SPLICE_IN   3    /* 静态文件->管道              */
+#define HTTPD_URING_POLL_OUT    4    /* 等待socket可写              */
+#define HTTPD_URING_SPLICE_OUT  5    /* 管道->socket               */
+#define HTTPD_URING_CANCEL      6    /* 取消连接尚未完成的请求        */
+#define HTTPD_URING_OP_MASK     7
+#define HTTPD_URING_DATA(conn, op)  ((__u64)(uintptr_t)(conn) | (op))
+#endif
+
+/*-----------------------------------*/
+/* 数据结构定义                       */
+/*-----------------------------------*/
+/* 指向接收缓冲区的字符串视图(不以'\0'结尾，不拷贝数据) */
+typedef struct __HTTPD_STR_T_
+{
+    const char *data;  /* 起始地址 */
+    size_t len;        /* 长度     */
+} httpd_str_t;
+
+/* 已知请求头编号，按字段名完美哈希查找 */
+typedef enum __HTTPD_HEADER_ID_E_
+{
+    HTTPD_HDR_HOST = 0,
+    HTTPD_HDR_CONNECTION,
+    HTTPD_HDR_CONTENT_LENGTH,
+    HTTPD_HDR_CONTENT_TYPE,
+    HTTPD_HDR_TRANSFER_ENCODING,
+    HTTPD_HDR_EXPECT,
+    HTTPD_HDR_IF_NONE_MATCH,
+    HTTPD_HDR_IF_MODIFIED_SINCE,
+    HTTPD_HDR_RANGE,
+    HTTPD_HDR_IF_RANGE,
+    HTTPD_HDR_ACCEPT_ENCODING,
+    HTTPD_HDR_ACCEPT,
+    HTTPD_HDR_USER_AGENT,
+    HTTPD_HDR_COOKIE,
+    HTTPD_HDR_REFERER,
+    HTTPD_HDR_AUTHORIZATION,
+    HTTPD_HDR_ACCEPT_LANGUAGE,
+    HTTPD_HDR_CACHE_CONTROL,
+    HTTPD_HDR_UPGRADE,
+    HTTPD_HDR_PRAGMA,
+    HTTPD_HDR_NUM,                   /* 已知请求头个数   */
+    HTTPD_HDR_UNKNOWN = HTTPD_HDR_NUM /* 其他请求头      */
+} httpd_header_id_e;
+
+/* HTTP请求头字段视图(字段名和字段值均以'\0'结尾) */
+typedef struct __HTTPD_HEADER_T_
+{
+    httpd_str_t name;   /* 字段名              */
+    httpd_str_t value;  /* 字段值(已去除首尾空白) */
+    int id;             /* 已知请求头编号HTTPD_HDR_* */
+} httpd_header_t;
+
+/* HTTP请求行数据结构定义 */
+typedef struct __HTTP_REQUEST_LINE_DATA_T_
+{
+    const char *method;        /* 请求方法(指向接收缓冲区)               */
+    httpd_str_t uri;           /* 请求URI中的路径部分(不含查询参数)        */
+    const char *query_string;  /* 查询参数(指向接收缓冲区)，没有时为""     */
+    char path[HTTPD_PATH_SIZE]; /* 请求资源路径                         */
+    int  cgi;                  /* 是否需要执行CGI程序标志                */
+    int  http_version;         /* HTTP版本: 10/11                      */
+} http_request_line_data_t;
+
+/* HTTP请求数据结构定义，请求行和请求头在接收缓冲区中原地解析，
+   请求处理完之前接收缓冲区中的请求头不会被移动 */
+typedef struct __HTTP_REQUEST_DATA_T_
+{
+    http_request_line_data_t req_line_data;  /* 请求行数据    */
+    long long content_length;                /* 请求体数据长度 */
+    int connection;                          /* Connection请求头: 0未指定 1keep-alive 2close */
+    int chunked;                             /* 请求体按chunked编码传输 */
+    int expect_continue;                     /* Expect: 100-continue，需先回复100再接收请求体 */
+    struct stat file_stat;                   /* 请求资源的文件属性 */
+    time_t if_modified_since;                /* If-Modified-Since请求头，0表示未指定 */
+    int accept_encoding;                     /* Accept-Encoding请求头(HTTPD_ENC_*位掩码) */
+    int scan_pos;                            /* 行尾查找位置(上次数据未到齐处) */
+    int parse_pos;                           /* 下一行的起始位置              */
+    int header_num;                          /* 请求头数                    */
+    unsigned char known[HTTPD_HDR_NUM];      /* 已知请求头在headers中的下标+1，0表示没有 */
+    httpd_header_t headers[HTTPD_HEADER_MAX]; /* 请求头(复位时不清零，须放在最后) */
+} http_request_data_t;
+
+/* 静态文件区间定义 */
+typedef struct __HTTPD_RANGE_T_
+{
+    off_t first;  /* 起始位置 */
+    off_t last;   /* 结束位置(包含) */
+} httpd_range_t;
+
+/* 静态文件缓存项定义 */
+typedef struct __HTTPD_CACHE_ENTRY_T_
+{
+    char path[256];                 /* 文件路径(缓存键)              */
+    int encoding;                   /* 内容编码HTTPD_ENC_*(缓存键)    */
+    unsigned int hash;              /* 文件路径哈希值                 */
+    dev_t dev;                      /* 文件属性，用于判断缓存是否过期   */
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    char header[HTTPD_HEADER_SIZE]; /* 预生成的回复报文头(不含Connection) */
+    size_t header_len;
+    char *body;                     /* 文件内容(按encoding编码)       */
+    size_t body_len;
+    atomic_int refs;                /* 引用计数: 缓存本身及正在发送的连接 */
+    struct __HTTPD_CACHE_ENTRY_T_ *hash_next;  /* 哈希桶链表   */
+    struct __HTTPD_CACHE_ENTRY_T_ *lru_prev;   /* LRU链表      */
+    struct __HTTPD_CACHE_ENTRY_T_ *lru_next;
+} httpd_cache_entry_t;
+
+/* 静态文件缓存定义(所有工作线程共享) */
+typedef struct __HTTPD_CACHE_T_
+{
+    pthread_mutex_t lock;                                /* 互斥锁            */
+    httpd_cache_entry_t *buckets[HTTPD_CACHE_BUCKETS];   /* 哈希表            */
+    httpd_cache_entry_t *lru_head;                       /* 最近使用的缓存项   */
+    httpd_cache_entry_t *lru_tail;                       /* 最久未使用的缓存项 */
+    size_t used;                                         /* 已使用字节数       */
+    size_t budget;                                       /* 容量(字节)         */
+} httpd_cache_t;
+
+/* 路径缓存项定义: 请求URL路径到规范化后的文件路径及文件属性的映射，
+   stat失败的结果同样缓存 */
+typedef struct __HTTPD_PATH_ENTRY_T_
+{
+    time_t expire;                        /* 过期时间(单调时钟秒)，0表示空 */
+    unsigned int hash;                    /* URL路径哈希值               */
+    int err;                              /* stat的错误码，0表示成功       */
+    const char *content_type;             /* 按扩展名确定的MIME类型        */
+    struct stat st;                       /* 文件属性                    */
+    size_t uri_len;
+    char uri[HTTPD_PATH_CACHE_KEY];       /* 请求URL路径(未解码，缓存键)   */
+    char path[HTTPD_PATH_CACHE_KEY + sizeof(HTTPD_DOC_ROOT "/" HTTPD_INDEX_FILE)]; /* 文件路径 */
+} httpd_path_entry_t;
+
+/* MIME类型定义 */
+typedef struct __HTTPD_MIME_T_
+{
+    const char *ext;       /* 扩展名(小写，不含'.') */
+    const char *type;      /* Content-Type          */
+    int compress;          /* 是否适合gzip压缩       */
+} httpd_mime_t;
+
+/* 连接处理阶段定义 */
+typedef enum __HTTPD_CONN_STATE_E_
+{
+    HTTPD_CONN_REQUEST_LINE = 0,  /* 解析请求行       */
+    HTTPD_CONN_REQUEST_HEADER,    /* 解析请求头       */
+    HTTPD_CONN_RESPONSE,          /* 发送回复报文     */
+    HTTPD_CONN_CGI_WAIT,          /* 等待CGI执行名额  */
+    HTTPD_CONN_CGI,               /* 执行CGI程序      */
+    HTTPD_CONN_CLOSE              /* 处理结束关闭连接  */
+} httpd_conn_state_e;
+
+/* chunked请求体解析状态定义 */
+typedef enum __HTTPD_CHUNK_STATE_E_
+{
+    HTTPD_CHUNK_LENGTH = 0,       /* 等待chunk长度行           */
+    HTTPD_CHUNK_DATA_END,         /* 等待chunk内容之后的CRLF    */
+    HTTPD_CHUNK_TRAILER           /* 结束chunk之后的trailer及空行 */
+} httpd_chunk_state_e;
+
+/* 连接超时类型定义 */
+typedef enum __HTTPD_TIMEOUT_E_
+{
+    HTTPD_TIMEOUT_NONE = 0,       /* 未设置超时                         */
+    HTTPD_TIMEOUT_HEADER,         /* 接收请求行及请求头(从第一个字节起计)  */
+    HTTPD_TIMEOUT_IDLE,           /* 持久连接等待下一个请求               */
+    HTTPD_TIMEOUT_BODY,           /* 接收请求体(无数据到达起计)           */
+    HTTPD_TIMEOUT_CGI_WAIT,       /* 等待CGI执行名额                     */
+    HTTPD_TIMEOUT_CGI,            /* CGI程序执行(从启动起计)              */
+    HTTPD_TIMEOUT_SEND            /* 发送回复(无进展起计)                 */
+} httpd_timeout_e;
+
+/* 请求处理阶段定义(耗时统计) */
+typedef enum __HTTPD_STAGE_E_
+{
+    HTTPD_STAGE_ACCEPT = 0,      /* accept到加入工作线程epoll  */
+    HTTPD_STAGE_REQUEST_LINE,    /* 解析请求行(含读socket)    */
+    HTTPD_STAGE_REQUEST_HEADER,  /* 解析请求头(含读socket)    */
+    HTTPD_STAGE_STAT,            /* stat请求资源             */
+    HTTPD_STAGE_STATIC_SEND,     /* 非CGI请求开始处理到回复发送完毕 */
+    HTTPD_STAGE_CGI_SPAWN,       /* 启动CGI程序              */
+    HTTPD_STAGE_CGI_DONE,        /* CGI程序启动到输出转发完毕   */
+    HTTPD_STAGE_NUM
+} httpd_stage_e;
+
+/* 耗时直方图定义(纳秒，对数-线性分桶) */
+typedef struct __HTTPD_HIST_T_
+{
+    atomic_ulong count;                       /* 次数   */
+    atomic_ulong sum;                         /* 总耗时 */
+    atomic_ulong max;                         /* 最大值 */
+    atomic_ulong buckets[HTTPD_HIST_BUCKETS]; /* 各桶次数 */
+} httpd_hist_t;
+
+/* 工作线程统计数据定义(只由本线程写入) */
+typedef struct __HTTPD_STATS_T_
+{
+    atomic_ulong accepted;                  /* 接受的连接数     */
+    atomic_ulong closed;                    /* 关闭的连接数     */
+    atomic_ulong timeouts;                  /* 超时关闭的连接数  */
+    atomic_ulong requests;                  /* 处理的请求数     */
+    atomic_ulong bytes_sent;                /* 发送给客户端的字节数 */
+    atomic_ulong status[500];               /* 各状态码(100~599)的回复数 */
+    httpd_hist_t hist[HTTPD_STAGE_NUM];     /* 各阶段耗时       */
+} httpd_stats_t;
+
+/* 所有工作线程统计数据的汇总 */
+typedef struct __HTTPD_STATS_SNAPSHOT_T_
+{
+    unsigned long accepted;
+    unsigned long closed;
+    unsigned long timeouts;
+    unsigned long requests;
+    unsigned long bytes_sent;
+    unsigned long log_dropped;
+    unsigned long rejected;
+    unsigned long accept_paused;
+    unsigned long status[500];
+    unsigned long count[HTTPD_STAGE_NUM];
+    unsigned long sum[HTTPD_STAGE_NUM];
+    unsigned long max[HTTPD_STAGE_NUM];
+    unsigned long buckets[HTTPD_STAGE_NUM][HTTPD_HIST_BUCKETS];
+} httpd_stats_snapshot_t;
+
+/* 访问日志环形缓冲区定义: 工作线程写入、日志线程读取的单生产者单消费者
+   队列，head/tail只增不减，对缓冲区大小取模得到位置 */
+typedef struct __HTTPD_LOG_RING_T_
+{
+    _Alignas(64) atomic_size_t head;    /* 写入位置(工作线程) */
+    _Alignas(64) atomic_size_t tail;    /* 读取位置(日志线程) */
+    atomic_ulong dropped;               /* 缓冲区满时丢弃的日志条数 */
+    char buf[HTTPD_LOG_RING_SIZE];      /* 日志数据          */
+} httpd_log_ring_t;
+
+/* 连接准入控制定义(所有线程共享) */
+typedef struct __HTTPD_ADMISSION_T_
+{
+    atomic_int active;                  /* 已接受尚未关闭的连接数 */
+    int limit;                          /* 连接数上限             */
+    atomic_ulong rejected;              /* 超过上限回复503的连接数 */
+    atomic_ulong paused;                /* 文件描述符耗尽暂停accept的次数 */
+    char response[HTTPD_HEADER_SIZE];   /* 预生成的503回复        */
+    size_t response_len;
+} httpd_admission_t;
+
+/* 访问日志定义 */
+typedef struct __HTTPD_LOG_T_
+{
+    const char *path;                   /* 日志文件，"-"为标准输出，NULL为不记录 */
+    int json;                           /* 1: JSON格式  0: Combined Log Format */
+    int fd;                             /* 日志文件描述符      */
+    int event_fd;                       /* 缓冲区过半时唤醒日志线程 */
+    volatile sig_atomic_t reopen;       /* 收到SIGHUP，需重新打开日志文件 */
+} httpd_log_t;
+
+/* epoll事件源类型定义 */
+typedef enum __HTTPD_EVENT_TYPE_E_
+{
+    HTTPD_EV_NOTIFY = 0,  /* 工作线程唤醒通知   */
+    HTTPD_EV_LISTEN,      /* 工作线程自己的监听socket(SO_REUSEPORT) */
+    HTTPD_EV_CLIENT,      /* 客户端socket     */
+    HTTPD_EV_CGI_INPUT,   /* CGI程序标准输入管道 */
+    HTTPD_EV_CGI_OUTPUT,  /* CGI程序标准输出管道 */
+    HTTPD_EV_FCGI,        /* FastCGI程序连接   */
+#ifdef HTTPD_IO_URING
+    HTTPD_EV_URING,       /* io_uring完成通知(eventfd) */
+#endif
+} httpd_event_type_e;
+
+struct __HTTPD_CONN_T_;
+
+/* FastCGI程序定义: 常驻进程共享同一个Unix监听socket(作为进程的标准输入)，
+   服务器每个请求建立一个连接 */
+typedef struct __HTTPD_FCGI_APP_T_
+{
+    char path[256];                    /* 脚本路径                  */
+    int  procs;                        /* 进程数                    */
+    int  listen_fd;                    /* 监听socket，重启进程时使用  */
+    struct sockaddr_un addr;           /* 监听地址(私有目录中的socket文件) */
+    socklen_t addr_len;
+    pid_t  pids[HTTPD_FCGI_MAX_PROCS];  /* 进程ID，0表示需要重启      */
+    time_t spawned[HTTPD_FCGI_MAX_PROCS]; /* 最近一次启动时间，防止频繁重启 */
+} httpd_fcgi_app_t;
+
+/* FastCGI请求数据结构定义 */
+typedef struct __HTTPD_FCGI_REQ_T_
+{
+    int  opos;                        /* obuf已发送位置               */
+    int  olen;
+    int  stdin_done;                  /* 结束FCGI_STDIN流的空记录已放入 */
+    int  ipos;                        /* ibuf已解析位置               */
+    int  ilen;
+    int  type;                        /* 当前记录类型                 */
+    int  content_left;                /* 当前记录剩余内容长度          */
+    int  padding_left;                /* 当前记录剩余填充长度          */
+    int  sock_eof;                    /* FastCGI程序已关闭连接         */
+    char obuf[HTTPD_FCGI_BUF_SIZE];   /* 发往FastCGI程序的记录(不需要清零) */
+    char ibuf[HTTPD_FCGI_BUF_SIZE];   /* 从FastCGI程序收到的记录      */
+} httpd_fcgi_req_t;
+
+/* CGI输出数据结构定义(CGI和FastCGI共用，从连接内存池分配) */
+typedef struct __HTTPD_CGI_OUT_T_
+{
+    int  header_done;                 /* CGI报文头已转换为HTTP回复头    */
+    int  chunked;                     /* 报文体按chunked编码发送，否则以关闭连接结束 */
+    int  error;                       /* CGI报文头错误，已回复500       */
+    int  nobody;                      /* 1xx/204/304回复没有报文体，丢弃CGI输出 */
+    int  last;                        /* 结束chunk已放入发送缓冲区      */
+    int  chunk_left;                  /* 从管道直接转发的chunk剩余长度   */
+    int  len;                         /* 缓冲区中的报文体长度           */
+    int  pos;                         /* 正在发送的chunk的发送位置      */
+    int  end;                         /* 正在发送的chunk的结束位置，0表示未在发送 */
+    char buf[HTTPD_CGI_CHUNK_HEAD + HTTPD_CGI_CHUNK_SIZE + 7]; /* chunk头+报文体+"\r\n"(+结束chunk) */
+} httpd_cgi_out_t;
+
+/* 连接内存池的内存块 */
+typedef struct __HTTPD_ARENA_CHUNK_T_
+{
+    struct __HTTPD_ARENA_CHUNK_T_ *next;  /* 下一个内存块 */
+    size_t size;                          /* 可用大小     */
+    size_t used;                          /* 已分配大小   */
+    _Alignas(max_align_t) char data[];    /* 内存         */
+} httpd_arena_chunk_t;
+
+/* 连接内存池: 请求处理期间按顺序分配，请求结束时整体复位，内存块保留给
+   后续请求使用 */
+typedef struct __HTTPD_ARENA_T_
+{
+    httpd_arena_chunk_t *head;  /* 第一个内存块     */
+    httpd_arena_chunk_t *cur;   /* 当前分配的内存块  */
+    size_t total;               /* 内存块总大小     */
+} httpd_arena_t;
+
+/* epoll事件源数据结构定义(epoll_event.data.ptr指向该结构) */
+typedef struct __HTTPD_EVENT_T_
+{
+    int fd;                        /* 文件描述符      */
+    int type;                      /* 事件源类型      */
+    struct __HTTPD_CONN_T_ *conn;  /* 所属客户端连接  */
+} httpd_event_t;
+
+#ifdef HTTPD_IO_URING
+/* io_uring实例定义(直接使用系统调用，不依赖liburing) */
+typedef struct __HTTPD_URING_T_
+{
+    int fd;                          /* io_uring实例                      */
+    void *ring;                      /* 提交队列和完成队列的共享内存        */
+    size_t ring_size;
+    struct io_uring_sqe *sqes;       /* 提交队列项数组                     */
+    size_t sqes_size;
+    unsigned int *sq_head;           /* 提交队列头(内核更新)               */
+    unsigned int *sq_tail;           /* 提交队列尾(本线程更新)             */
+    unsigned int *sq_flags;          /* 内核设置的状态标志(完成队列溢出等)   */
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int sqe_tail;           /* 已填写的提交队列项尾，提交时发布到sq_tail */
+    unsigned int *cq_head;           /* 完成队列头(本线程更新)             */
+    unsigned int *cq_tail;           /* 完成队列尾(内核更新)               */
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;       /* 完成队列项数组                     */
+    struct io_uring_buf_ring *buf_ring; /* 提供给内核的接收缓冲区环，NULL表示不支持 */
+    char *bufs;                      /* 接收缓冲区内存                     */
+    unsigned short buf_tail;         /* 接收缓冲区环尾                     */
+} httpd_uring_t;
+#endif
+
+/* 定时器定义(嵌入在所属对象中) */
+typedef struct __HTTPD_TIMER_T_
+{
+    time_t expire;                   /* 到期时间(单调时钟秒)   */
+    struct __HTTPD_TIMER_T_ *prev;   /* 时间轮槽双向循环链表，NULL表示未加入 */
+    struct __HTTPD_TIMER_T_ *next;
+} httpd_timer_t;
+
+/* 分层时间轮定义: 第0层每槽1秒，第n层每槽64^n秒，高层的定时器在低层转完
+   一圈时下放到低层，加入/删除均为O(1) */
+typedef struct __HTTPD_TIMER_WHEEL_T_
+{
+    time_t now;                                             /* 已处理到的时间 */
+    httpd_timer_t slots[HTTPD_TIMER_LEVELS][HTTPD_TIMER_SLOTS]; /* 各槽链表头 */
+} httpd_timer_wheel_t;
+
+/* epoll反应堆数据结构定义 */
+typedef struct __HTTPD_REACTOR_T_
+{
+    int epoll_fd;                    /* epoll实例                     */
+    httpd_event_t notify_ev;         /* 新连接通知事件(eventfd)        */
+    httpd_event_t listen_ev;         /* 本线程的监听socket事件，-1表示由主线程accept */
+    struct __HTTPD_CONN_T_ *closed;  /* 本轮事件处理中关闭的连接(延迟释放) */
+    time_t now;                      /* 本轮事件循环的时间(单调时钟秒)  */
+    httpd_timer_wheel_t timers;      /* 本线程连接的超时定时器          */
+    struct __HTTPD_CONN_T_ *_Atomic cgi_ready; /* 已分配到CGI执行名额的等待连接(受CGI限流锁
+                                        保护，本线程不加锁检查是否为空) */
+    struct __HTTPD_CONN_T_ *cgi_flush; /* CGI输出等待定时发送的连接     */
+    struct __HTTPD_CONN_T_ *conn_pool; /* 可复用的空闲连接对象         */
+    int conn_pool_num;               /* 空闲连接对象数                */
+    httpd_stats_t stats;             /* 本线程的统计数据               */
+    httpd_log_ring_t *log;           /* 本线程的访问日志缓冲区，NULL表示不记录 */
+    long long accept_resume;         /* 暂停accept到该时间(单调时钟纳秒)，0表示未暂停 */
+    httpd_path_entry_t *paths;       /* 本线程的路径缓存(直接映射)      */
+    time_t log_time;                 /* 访问日志时间字符串对应的时间    */
+    char log_date[32];               /* 访问日志时间字符串(每秒更新)    */
+#ifdef HTTPD_IO_URING
+    httpd_uring_t *uring;            /* 本线程的io_uring，NULL表示使用epoll+非阻塞调用 */
+    httpd_event_t uring_ev;          /* io_uring完成通知事件(eventfd)   */
+    int listen_uring;                /* 监听socket由io_uring multishot accept接受 */
+#endif
+} httpd_reactor_t;
+
+/* CGI脚本运行计数定义 */
+typedef struct __HTTPD_CGI_SCRIPT_T_
+{
+    char path[HTTPD_PATH_SIZE];          /* 脚本路径       */
+    int  running;                        /* 正在运行的个数  */
+    struct __HTTPD_CGI_SCRIPT_T_ *next;  /* 哈希桶链表     */
+} httpd_cgi_script_t;
+
+/* 客户端连接数据结构定义 */
+typedef struct __HTTPD_CONN_T_
+{
+    httpd_event_t ev;                /* 客户端socket事件             */
+    httpd_event_t cgi_in_ev;         /* CGI标准输入管道事件(写)       */
+    httpd_event_t cgi_out_ev;        /* CGI标准输出管道事件(读)       */
+    httpd_reactor_t *reactor;        /* 所属反应堆                   */
+    struct __HTTPD_CONN_T_ *next;    /* 延迟释放链表                 */
+    int state;                       /* 连接处理阶段                 */
+    http_request_data_t http_data;   /* HTTP请求数据                 */
+    int  rpos;                       /* 已解析位置                   */
+    int  rlen;                       /* 已接收数据长度               */
+    int  wpos;                       /* 已发送位置                   */
+    int  wlen;                       /* 数据长度                     */
+    int  file_fd;                    /* 正在发送的静态文件            */
+    off_t file_offset;               /* 静态文件下一次发送的位置       */
+    off_t file_left;                 /* 静态文件剩余未发送的字节数      */
+    int  splice_pipe[2];             /* sendfile不可用时splice使用的管道 */
+    size_t splice_len;               /* 管道中尚未发送的字节数          */
+    httpd_cache_entry_t *cache_entry; /* 正在发送的静态文件缓存项       */
+    size_t cache_sent;               /* 缓存回复已发送的字节数          */
+    httpd_range_t ranges[HTTPD_RANGE_MAX]; /* 请求的文件区间              */
+    int  range_num;                  /* 区间数，大于1时按multipart/byteranges回复 */
+    int  range_idx;                  /* 正在发送的区间                 */
+    const char *encoding;            /* 静态文件的Content-Encoding: NULL不协商编码
+                                        ""未编码但回复随Accept-Encoding变化 */
+    const char *content_type;        /* 静态文件的Content-Type          */
+    long long body_left;             /* 尚未写入CGI程序的请求体长度(chunked编码
+                                        时为当前chunk的剩余长度) */
+    int  body_chunked;               /* 请求体按chunked编码接收，结束chunk未到 */
+    int  chunk_state;                /* chunked请求体解析状态HTTPD_CHUNK_* */
+    long long body_size;             /* 已确定的请求体长度(chunked编码时为已解析
+                                        chunk的长度之和) */
+    pid_t cgi_pid;                   /* CGI子进程ID                  */
+    int  cgi_eof;                    /* CGI程序输出是否结束           */
+    int  cgi_nosplice;               /* 不能用splice转发CGI数据时用缓冲区拷贝 */
+    httpd_fcgi_req_t *fcgi;          /* 由FastCGI常驻进程处理的请求    */
+    httpd_cgi_out_t *cgi_out;        /* CGI输出的报文头解析及chunked编码 */
+    long long cgi_flush_at;          /* 缓冲的CGI输出最晚发送时间(纳秒)，0表示未缓冲 */
+    struct __HTTPD_CONN_T_ *cgi_flush_prev; /* CGI输出定时发送链表      */
+    struct __HTTPD_CONN_T_ *cgi_flush_next;
+    httpd_cgi_script_t *cgi_script;  /* 请求的CGI脚本运行计数          */
+    int  cgi_slot;                   /* 是否占用CGI执行名额            */
+    int  cgi_wait;                   /* 0未等待 1在等待队列中 2已分配名额待启动 */
+    time_t cgi_deadline;             /* CGI程序执行截止时间            */
+    struct __HTTPD_CONN_T_ *cgi_wait_prev; /* CGI等待队列/待启动链表   */
+    struct __HTTPD_CONN_T_ *cgi_wait_next;
+    int  keep_alive;                 /* 当前请求处理完后是否保持连接    */
+    int  nodelay;                    /* socket已设置TCP_NODELAY         */
+    int  requests;                   /* 本连接已处理的请求数           */
+    httpd_timer_t timer;             /* 当前阶段的超时定时器           */
+    int  timeout;                    /* 定时器对应的超时类型HTTPD_TIMEOUT_* */
+    long long timeout_mark;          /* 设置定时器时的进展(已发送/未接收字节数) */
+#ifdef HTTPD_IO_URING
+    int  uring_ops;                  /* 尚未完成的io_uring请求数        */
+    int  uring_recv;                 /* 是否有未完成的接收请求           */
+    int  uring_file;                 /* 未完成的静态文件发送请求数        */
+    int  uring_error;                /* io_uring请求返回连接关闭或出错    */
+    int  uring_detached;             /* 连接已关闭，由最后一个完成事件释放 */
+    int  splice_pipe_size;           /* splice管道容量                 */
+#endif
+    long long parse_ns;              /* 当前解析阶段已花费的时间(纳秒)  */
+    long long response_start;        /* 非CGI请求开始处理的时间(纳秒)   */
+    long long cgi_start;             /* CGI程序启动时间(纳秒)          */
+    long long request_start;         /* 请求开始处理的时间(纳秒)，0表示已记录访问日志 */
+    long long sent;                  /* 本次回复已发送的字节数          */
+    int  status;                     /* 本次回复的状态码               */
+    char remote[INET_ADDRSTRLEN];    /* 客户端IP(仅记录访问日志时获取)  */
+    /* 以下字段在连接对象复用时不清零 */
+    httpd_arena_t arena;             /* 请求处理期间使用的内存池       */
+    char rbuf[HTTPD_RBUF_SIZE];      /* 接收缓冲区(请求头及请求体)     */
+    char wbuf[HTTPD_BUF_SIZE];       /* 待发送给客户端的数据          */
+} httpd_conn_t;
+
+/* CGI并发限制定义(所有工作线程共享) */
+typedef struct __HTTPD_CGI_LIMIT_T_
+{
+    pthread_mutex_t lock;
+    int running;                        /* 正在运行的CGI程序数 */
+    int waiting;                        /* 等待队列长度       */
+    httpd_conn_t *wait_head;            /* 等待队列(按到达顺序) */
+    httpd_conn_t *wait_tail;
+    httpd_cgi_script_t *scripts[HTTPD_CGI_BUCKETS]; /* 各脚本运行计数 */
+} httpd_cgi_limit_t;
+
+/* 环形队列单元定义 */
+typedef struct __HTTPD_RING_CELL_T_
+{
+    atomic_size_t seq;  /* 单元序号，用于判断单元可读/可写 */
+    int fd;             /* 客户端socket                 */
+    long long accepted; /* accept时间(纳秒)              */
+} httpd_ring_cell_t;
+
+/* 有界无锁MPMC环形队列定义 */
+typedef struct __HTTPD_RING_T_
+{
+    httpd_ring_cell_t *cells;                      /* 队列单元       */
+    size_t mask;                                   /* 队列长度减1     */
+    _Alignas(64) atomic_size_t enqueue_pos;        /* 下一个写入位置  */
+    _Alignas(64) atomic_size_t dequeue_pos;        /* 下一个读取位置  */
+} httpd_ring_t;
+
+/* 工作线程数据结构定义 */
+typedef struct __HTTPD_WORKER_T_
+{
+    int id;                   /* 线程编号                     */
+    pthread_t tid;            /* 线程ID                       */
+    httpd_reactor_t reactor;  /* 本线程的epoll反应堆            */
+    httpd_ring_t queue;       /* 分配给本线程的新连接队列        */
+    int notified;             /* 本批新连接是否需要唤醒(仅主线程使用) */
+} httpd_worker_t;
+
+/* 服务器配置数据结构定义 */
+typedef struct __HTTPD_CONFIG_T_
+{
+    int port;        /* 监听端口              */
+    int worker_num;  /* 工作线程数            */
+    int queue_size;  /* 每个工作线程的连接队列长度 */
+    int keepalive_timeout;  /* 持久连接空闲超时时间(秒) */
+    int keepalive_max;      /* 每个持久连接最多处理的请求数 */
+    int cache_size;         /* 静态文件缓存容量(KB)，0表示不缓存 */
+    int cgi_max;            /* 同时运行的CGI程序数上限，0表示不限制 */
+    int cgi_script_max;     /* 单个CGI脚本同时运行数上限，0表示不限制 */
+    int cgi_wait_max;       /* 等待运行的CGI请求数上限 */
+    int cgi_wait_timeout;   /* CGI请求最长等待时间(秒) */
+    int header_timeout;     /* 接收请求行及请求头的最长时间(秒) */
+    int body_timeout;       /* 接收请求体期间无数据的超时时间(秒) */
+    int send_timeout;       /* 发送回复期间无进展的超时时间(秒) */
+    int cgi_timeout;        /* CGI程序最长执行时间(秒) */
+    int backlog;            /* 监听socket等待队列长度 */
+    int reuseport;          /* 每个工作线程用SO_REUSEPORT独立监听 */
+    int pin_cpu;            /* 工作线程绑定CPU */
+    int io_uring;           /* 使用io_uring(编译时需定义HTTPD_IO_URING) */
+    int max_conns;          /* 最大连接数，0表示按文件描述符上限计算 */
+    int fd_reserve;         /* 为静态文件、CGI管道等保留的文件描述符数 */
+    long long body_max;     /* 请求体最大长度(字节)，0表示不限制 */
+} httpd_config_t;
+
+/*-----------------------------------*/
+/* 全局变量定义                       */
+/*-----------------------------------*/
+static httpd_config_t  g_httpd_config;           /* 服务器配置   */
+static httpd_worker_t *g_httpd_workers = NULL;   /* 工作线程池   */
+static httpd_cache_t   g_httpd_cache;            /* 静态文件缓存 */
+static httpd_fcgi_app_t g_httpd_fcgi_apps[HTTPD_FCGI_MAX_APPS]; /* FastCGI程序 */
+static int              g_httpd_fcgi_app_num = 0;
+static pthread_mutex_t  g_httpd_fcgi_lock = PTHREAD_MUTEX_INITIALIZER; /* 保护进程表 */
+static atomic_int       g_httpd_fcgi_dead;        /* 需要重启的FastCGI进程数 */
+static char             g_httpd_fcgi_dir[64];     /* FastCGI监听socket所在的私有目录 */
+static httpd_cgi_limit_t g_httpd_cgi_limit;        /* CGI并发限制 */
+
+/* 分隔符查找函数，启动时按CPU支持的指令集选择 */
+static const char *(*g_httpd_scan)(const char *p, const char *end, const char *set, int n);
+
+/* 已知请求头字段名，按HTTPD_HDR_*编号排列 */
+static const httpd_str_t g_httpd_header_names[HTTPD_HDR_NUM] =
+{
+#define HTTPD_HDR_NAME(s)  {s, sizeof(s) - 1}
+    HTTPD_HDR_NAME("Host"),
+    HTTPD_HDR_NAME("Connection"),
+    HTTPD_HDR_NAME("Content-Length"),
+    HTTPD_HDR_NAME("Content-Type"),
+    HTTPD_HDR_NAME("Transfer-Encoding"),
+    HTTPD_HDR_NAME("Expect"),
+    HTTPD_HDR_NAME("If-None-Match"),
+    HTTPD_HDR_NAME("If-Modified-Since"),
+    HTTPD_HDR_NAME("Range"),
+    HTTPD_HDR_NAME("If-Range"),
+    HTTPD_HDR_NAME("Accept-Encoding"),
+    HTTPD_HDR_NAME("Accept"),
+    HTTPD_HDR_NAME("User-Agent"),
+    HTTPD_HDR_NAME("Cookie"),
+    HTTPD_HDR_NAME("Referer"),
+    HTTPD_HDR_NAME("Authorization"),
+    HTTPD_HDR_NAME("Accept-Language"),
+    HTTPD_HDR_NAME("Cache-Control"),
+    HTTPD_HDR_NAME("Upgrade"),
+    HTTPD_HDR_NAME("Pragma"),
+#undef HTTPD_HDR_NAME
+};
+
+/* 已知请求头完美哈希表: 哈希值->编号+1，0表示空 */
+static unsigned char g_httpd_header_hash[HTTPD_HEADER_HASH_SIZE];
+
+/* 扩展名到MIME类型的映射，按扩展名排序以便二分查找 */
+static const httpd_mime_t g_httpd_mime_types[] =
+{
+    {"7z",    "application/x-7z-compressed", 0},
+    {"avif",  "image/avif",                  0},
+    {"bmp",   "image/bmp",                   0},
+    {"css",   "text/css",                    1},
+    {"csv",   "text/csv",                    1},
+    {"gif",   "image/gif",                   0},
+    {"gz",    "application/gzip",            0},
+    {"htm",   "text/html",                   1},
+    {"html",  "text/html",                   1},
+    {"ico",   "image/x-icon",                0},
+    {"jpeg",  "image/jpeg",                  0},
+    {"jpg",   "image/jpeg",                  0},
+    {"js",    "text/javascript",             1},
+    {"json",  "application/json",            1},
+    {"map",   "application/json",            1},
+    {"md",    "text/markdown",               1},
+    {"mjs",   "text/javascript",             1},
+    {"mp3",   "audio/mpeg",                  0},
+    {"mp4",   "video/mp4",                   0},
+    {"otf",   "font/otf",                    0},
+    {"pdf",   "application/pdf",             0},
+    {"png",   "image/png",                   0},
+    {"svg",   "image/svg+xml",               1},
+    {"tar",   "application/x-tar",           0},
+    {"ttf",   "font/ttf",                    0},
+    {"txt",   "text/plain",                  1},
+    {"wasm",  "application/wasm",            0},
+    {"webm",  "video/webm",                  0},
+    {"webp",  "image/webp",                  0},
+    {"woff",  "font/woff",                   0},
+    {"woff2", "font/woff2",                  0},
+    {"xml",   "application/xml",             1},
+    {"zip",   "application/zip",             0},
+};
+
+/* 请求处理阶段名称，按HTTPD_STAGE_*编号排列 */
+static const char *g_httpd_stage_names[HTTPD_STAGE_NUM] =
+{
+    "accept", "request_line", "request_header", "stat", "static_send", "cgi_spawn", "cgi_done"
+};
+
+static time_t g_httpd_start_time;  /* 服务器启动时间(单调时钟秒) */
+static httpd_log_t g_httpd_log;    /* 访问日志                 */
+static httpd_admission_t g_httpd_admission; /* 连接准入控制     */
+
+/*-----------------------------------*/
+/* 函数声明                          */
+/*-----------------------------------*/
+/* 记录错误信息并关闭服务器程序 */
+static void httpd_error_exit(const char *error); 
+
+/* 设置文件描述符为非阻塞模式 */
+static int httpd_set_nonblocking(int fd);
+
+/* 创建TCP服务监听 */
+static int httpd_server_startup(int reuseport);
+
+/* 将SYN所在CPU对应的监听socket选为连接的接收者 */
+static void httpd_reuseport_attach_cpu(int listen_fd, int group_size);
+
+/* 工作线程绑定CPU */
+static void httpd_worker_pin_cpu(httpd_worker_t *worker);
+
+/* 工作线程accept自己监听socket上的连接 */
+static void httpd_reactor_accept(httpd_reactor_t *reactor);
+
+/* 文件描述符耗尽时暂停本线程的accept */
+static void httpd_reactor_accept_pause(httpd_reactor_t *reactor);
+
+/* 恢复本线程的accept */
+static void httpd_reactor_accept_resume(httpd_reactor_t *reactor);
+
+/* 从socket读取数据到连接接收缓冲区 */
+static int httpd_conn_fill(httpd_conn_t *conn);
+
+/* 查找分隔符(逐字节) */
+static const char *httpd_scan_scalar(const char *p, const char *end, const char *set, int n);
+
+#if defined(__x86_64__) || defined(__i386__)
+/* 查找分隔符(SSE4.2) */
+static const char *httpd_scan_sse42(const char *p, const char *end, const char *set, int n);
+
+/* 查找分隔符(AVX2) */
+static const char *httpd_scan_avx2(const char *p, const char *end, const char *set, int n);
+#endif
+
+/* 按CPU支持的指令集选择分隔符查找函数 */
+static void httpd_scan_init(void);
+
+/* 生成已知请求头完美哈希表 */
+static void httpd_header_hash_init(void);
+
+/* 计算请求头字段名的哈希值 */
+static unsigned int httpd_header_hash(const char *name, size_t len);
+
+/* 查找已知请求头编号 */
+static int  httpd_header_lookup(const char *name, size_t len);
+
+/* 获取已知请求头的值 */
+static const char *httpd_request_header(const http_request_data_t *h_data, int id);
+
+/* 获取一行HTTP报文 */
+static int httpd_get_line_message(httpd_conn_t *conn, httpd_str_t *line);
+
+/* 将请求头行拆分为字段名和字段值 */
+static int httpd_header_split(const httpd_str_t *line, httpd_header_t *header);
+
+/* 字符串视图与字符串常量比较(忽略大小写) */
+static int httpd_str_equal(const httpd_str_t *str, const char *literal);
+
+/* 解析HTTP报文的请求行 */
+static int httpd_request_line_analyze(httpd_conn_t *conn);
+
+/* 解析HTTP报文的请求头 */
+static int httpd_request_header_analyze(httpd_conn_t *conn);
+
+/* 返回请求方法错误信息给客户端 */
+static void httpd_request_method_error(httpd_conn_t *conn);
+
+/* 返回请求资源路径错误给客户端 */
+static void httpd_request_path_error(httpd_conn_t *conn);
+
+/* 返回不能执行CGI程序错误给客户端 */
+static void httpd_request_cannot_execute_error(httpd_conn_t *conn);
+
+/* 返回服务暂不可用错误 */
+static void httpd_request_unavailable_error(httpd_conn_t *conn);
+
+/* 返回HTTP坏请求错误(content_lenght有误) */
+static void httpd_request_bad_error(httpd_conn_t *conn);
+
+/* 返回请求行或请求头过长错误 */
+static void httpd_request_too_large_error(httpd_conn_t *conn);
+
+/* 返回请求体过长错误 */
+static void httpd_request_entity_too_large_error(httpd_conn_t *conn);
+
+/* 解析接收缓冲区中chunked编码请求体的chunk长度行及trailer */
+static int  httpd_request_chunk_parse(httpd_conn_t *conn);
+
+/* chunked编码请求体: 当前chunk已转发完时解析下一个chunk */
+static int  httpd_request_body_next(httpd_conn_t *conn);
+
+/* 十六进制字符转换为数值 */
+static int  httpd_hex_value(char c);
+
+/* MIME类型表二分查找比较函数 */
+static int  httpd_mime_compare(const void *key, const void *item);
+
+/* 按扩展名查找MIME类型 */
+static const httpd_mime_t *httpd_mime_lookup(const char *path);
+
+/* 将请求URL路径解析为文件路径 */
+static int  httpd_path_resolve(const char *uri, size_t len, char *path, size_t size);
+
+/* 查找请求资源的文件路径及属性(带路径缓存) */
+static int  httpd_path_lookup(httpd_conn_t *conn);
+
+/* 检查并处理HTTP请求错误 */
+static int  httpd_request_error_deal(httpd_conn_t *conn);
+
+/* 生成回复报文头(不含Connection及结尾空行) */
+static int  httpd_response_header_format(char *buf, size_t size, const char *status,
+                                         const char *content_type, long content_length,
+                                         const struct stat *st, const char *encoding);
+
+/* 发送回复报文头 */
+static void httpd_response_header(httpd_conn_t *conn, const char *status, long content_length,
+                                  const struct stat *st);
+
+/* 根据文件属性生成ETag */
+static int  httpd_file_etag(const struct stat *st, const char *encoding, char *buf, size_t size);
+
+/* 解析Accept-Encoding请求头 */
+static int  httpd_accept_encoding_parse(const httpd_str_t *value);
+
+/* 解析Connection请求头 */
+static int  httpd_connection_parse(const httpd_str_t *value);
+
+/* 判断静态文件是否适合压缩 */
+static int  httpd_file_compressible(const char *path);
+
+/* 选择静态文件的内容编码 */
+static int  httpd_encoding_select(httpd_conn_t *conn, const char *path, char *sidecar,
+                                  size_t size, struct stat *st);
+
+/* gzip压缩 */
+static int  httpd_gzip(const char *in, size_t in_len, char **out, size_t *out_len);
+
+/* 生成HTTP日期 */
+static void httpd_http_date(time_t t, char *buf, size_t size);
+
+/* 解析HTTP日期 */
+static time_t httpd_http_date_parse(const httpd_str_t *str);
+
+/* 判断静态文件自客户端缓存以来是否未修改 */
+static int  httpd_request_not_modified(httpd_conn_t *conn, const struct stat *st);
+
+/* 解析Range请求头 */
+static int  httpd_range_parse(httpd_conn_t *conn, const struct stat *st);
+
+/* 生成multipart/byteranges中一个区间的报文头 */
+static int  httpd_range_part_header(const httpd_range_t *range, off_t size, const char *content_type,
+                                    char *buf, size_t buf_size);
+
+/* 发送部分文件内容 */
+static void httpd_send_file_range(httpd_conn_t *conn, const struct stat *st);
+
+/* 回复416 Range Not Satisfiable */
+static void httpd_response_range_error(httpd_conn_t *conn, const struct stat *st);
+
+/* 切换到下一个文件区间 */
+static int  httpd_range_next(httpd_conn_t *conn);
+
+/* 初始化静态文件缓存 */
+static void httpd_cache_init(size_t budget);
+
+/* 查找静态文件缓存 */
+static httpd_cache_entry_t *httpd_cache_lookup(const char *path, const struct stat *st, int encoding);
+
+/* 读取静态文件并加入缓存 */
+static httpd_cache_entry_t *httpd_cache_load(const char *path, const struct stat *st,
+                                             const char *content_type, int encoding, int compress);
+
+/* 将缓存项移出缓存 */
+static void httpd_cache_unlink(httpd_cache_entry_t *entry);
+
+/* 释放缓存项引用 */
+static void httpd_cache_release(httpd_cache_entry_t *entry);
+
+/* 用writev发送缓存的回复 */
+static int  httpd_conn_send_cached(httpd_conn_t *conn);
+
+/* 返回静态请求文件给客户端 */
+static void httpd_send_file(httpd_conn_t *conn, const char *filename);
+
+/* 执行CGI程序处理HTTP请求 */
+static void httpd_execute_cgi(httpd_conn_t *conn);
+
+/* 在CGI程序和客户端之间转发数据 */
+static int  httpd_cgi_transfer(httpd_conn_t *conn);
+
+/* 启动CGI程序(FastCGI或fork/exec) */
+static void httpd_cgi_start(httpd_conn_t *conn);
+
+/* 申请CGI执行名额 */
+static int  httpd_cgi_acquire(httpd_conn_t *conn);
+
+/* 释放CGI执行名额 */
+static void httpd_cgi_release(httpd_conn_t *conn);
+
+/* 将空出的名额分配给等待队列中的请求 */
+static void httpd_cgi_grant(void);
+
+/* 连接关闭时退出CGI等待队列 */
+static void httpd_cgi_wait_cancel(httpd_conn_t *conn);
+
+/* 启动已分配到名额的等待请求 */
+static void httpd_reactor_cgi_ready(httpd_reactor_t *reactor);
+
+/* 生成CGI/1.1环境变量 */
+static int  httpd_cgi_env(httpd_conn_t *conn, char *buf, size_t size, char **envp, int max);
+
+/* 解析CGI报文头并转换为HTTP回复头 */
+static int  httpd_cgi_header_parse(httpd_conn_t *conn);
+
+/* 按chunked编码发送CGI输出 */
+static int  httpd_cgi_output(httpd_conn_t *conn);
+
+/* 判断CGI回复是否已全部发送 */
+static int  httpd_cgi_done(httpd_conn_t *conn);
+
+/* 缓冲的CGI输出加入定时发送链表 */
+static void httpd_cgi_flush_schedule(httpd_conn_t *conn);
+
+/* 移出CGI输出定时发送链表 */
+static void httpd_cgi_flush_cancel(httpd_conn_t *conn);
+
+/* 发送缓冲时间已到的CGI输出 */
+static void httpd_reactor_cgi_flush(httpd_reactor_t *reactor);
+
+/* 解析FastCGI程序配置 */
+static int  httpd_fcgi_config(const char *arg);
+
+/* 启动所有FastCGI程序 */
+static void httpd_fcgi_startup(void);
+
+/* 服务器被终止时结束FastCGI进程并删除监听socket */
+static void httpd_fcgi_shutdown(int sig);
+
+/* 启动一个FastCGI进程 */
+static pid_t httpd_fcgi_spawn(httpd_fcgi_app_t *app);
+
+/* 记录已退出的FastCGI进程 */
+static void httpd_fcgi_child_exit(pid_t pid);
+
+/* 重启已退出的FastCGI进程 */
+static void httpd_fcgi_respawn(time_t now);
+
+/* 查找处理请求的FastCGI程序 */
+static httpd_fcgi_app_t *httpd_fcgi_lookup(const char *path);
+
+/* 将请求交给FastCGI程序处理 */
+static int  httpd_fcgi_execute(httpd_conn_t *conn, httpd_fcgi_app_t *app);
+
+/* 生成FastCGI记录头 */
+static void httpd_fcgi_header(char *buf, int type, int content_len);
+
+/* 添加一个FastCGI参数 */
+static int  httpd_fcgi_param(char *buf, size_t size, const char *env);
+
+/* 在FastCGI程序和客户端之间转发数据 */
+static int  httpd_fcgi_transfer(httpd_conn_t *conn);
+
+/* 解析FastCGI程序发来的记录 */
+static void httpd_fcgi_parse(httpd_conn_t *conn);
+
+/* 将数据放入连接发送缓冲区 */
+static void httpd_conn_send(httpd_conn_t *conn, const char *buf, size_t len);
+
+/* 发送连接缓冲区中的回复数据 */
+static int  httpd_conn_flush(httpd_conn_t *conn);
+
+/* 用sendfile发送静态文件 */
+static int  httpd_conn_sendfile(httpd_conn_t *conn);
+
+/* 经管道用splice发送静态文件 */
+static int  httpd_conn_splice_file(httpd_conn_t *conn);
+
+/* 处理解析完成的HTTP请求 */
+static void httpd_request_process(httpd_conn_t *conn);
+
+/* 驱动客户端连接状态机 */
+static void httpd_conn_process(httpd_conn_t *conn);
+
+/* 关闭客户端连接 */
+static void httpd_conn_close(httpd_conn_t *conn);
+
+/* 复位连接，准备处理同一连接上的下一个请求 */
+static void httpd_conn_reset(httpd_conn_t *conn);
+
+/* 从连接内存池分配内存 */
+static void *httpd_arena_alloc(httpd_arena_t *arena, size_t size);
+
+/* 复位连接内存池 */
+static void httpd_arena_reset(httpd_arena_t *arena);
+
+/* 复位连接内存池，超过保留上限时释放所有内存块 */
+static void httpd_arena_release(httpd_arena_t *arena, size_t keep);
+
+/* 取一个连接对象 */
+static httpd_conn_t *httpd_conn_alloc(httpd_reactor_t *reactor);
+
+/* 回收连接对象 */
+static void httpd_conn_recycle(httpd_conn_t *conn);
+
+/* 初始化时间轮 */
+static void httpd_timer_init(httpd_timer_wheel_t *wheel, time_t now);
+
+/* 加入定时器 */
+static void httpd_timer_add(httpd_timer_wheel_t *wheel, httpd_timer_t *timer, time_t expire);
+
+/* 按到期时间将定时器放入时间轮的槽 */
+static void httpd_timer_link(httpd_timer_wheel_t *wheel, httpd_timer_t *timer);
+
+/* 删除定时器 */
+static void httpd_timer_del(httpd_timer_t *timer);
+
+/* 推进时间轮，处理到期的定时器 */
+static void httpd_timer_advance(httpd_reactor_t *reactor);
+
+/* 按连接当前阶段设置超时定时器 */
+static void httpd_conn_timer_update(httpd_conn_t *conn);
+
+/* 处理超时的连接 */
+static void httpd_conn_timeout(httpd_conn_t *conn);
+
+/* 获取单调时钟秒数 */
+static time_t httpd_monotonic_time(void);
+
+/* 获取单调时钟纳秒数 */
+static long long httpd_monotonic_ns(void);
+
+/* 计算耗时所在的直方图桶 */
+static int  httpd_hist_index(unsigned long ns);
+
+/* 计算直方图桶的上界 */
+static unsigned long httpd_hist_upper(int idx);
+
+/* 记录一次阶段耗时 */
+static void httpd_stats_record(httpd_reactor_t *reactor, int stage, long long ns);
+
+/* 按状态码统计回复数 */
+static void httpd_stats_status(httpd_conn_t *conn, int status);
+
+/* 汇总所有工作线程的统计数据 */
+static void httpd_stats_snapshot(httpd_stats_snapshot_t *snap);
+
+/* 从直方图计算百分位耗时 */
+static unsigned long httpd_hist_percentile(const httpd_stats_snapshot_t *snap, int stage, double q);
+
+/* 生成文本格式的服务器状态 */
+static size_t httpd_status_text(const httpd_stats_snapshot_t *snap, char *buf, size_t size);
+
+/* 生成Prometheus格式的服务器状态 */
+static size_t httpd_status_prometheus(const httpd_stats_snapshot_t *snap, char *buf, size_t size);
+
+/* 回复服务器状态页 */
+static void httpd_server_status(httpd_conn_t *conn);
+
+/* 记录发送给客户端的字节数 */
+static void httpd_conn_sent(httpd_conn_t *conn, ssize_t n);
+
+/* 转义访问日志字段 */
+static size_t httpd_log_escape(char *dst, size_t size, const char *src, size_t len);
+
+/* 访问日志写入环形缓冲区 */
+static void httpd_log_push(httpd_log_ring_t *ring, const char *line, size_t len);
+
+/* 记录访问日志 */
+static void httpd_access_log(httpd_conn_t *conn);
+
+/* SIGHUP信号处理 */
+static void httpd_log_sighup(int sig);
+
+/* 打开访问日志文件 */
+static int  httpd_log_open(void);
+
+/* 批量写出访问日志 */
+static void httpd_log_flush(void);
+
+/* 日志线程 */
+static void *httpd_log_run(void *arg);
+
+/* 启动访问日志 */
+static void httpd_log_startup(void);
+
+/* 处理客户端请求 */
+static void httpd_accept_client_request(httpd_reactor_t *reactor, int client, long long accepted);
+
+/* 初始化环形队列 */
+static int  httpd_ring_init(httpd_ring_t *ring, size_t size);
+
+/* 将文件描述符放入环形队列 */
+static int  httpd_ring_push(httpd_ring_t *ring, int fd, long long accepted);
+
+/* 从环形队列取出文件描述符 */
+static int  httpd_ring_pop(httpd_ring_t *ring, long long *accepted);
+
+/* 判断环形队列是否为空 */
+static int  httpd_ring_empty(httpd_ring_t *ring);
+
+/* 唤醒工作线程 */
+static void httpd_worker_notify(httpd_worker_t *worker);
+
+/* 接管分配给工作线程的新连接 */
+static void httpd_worker_take_connections(httpd_worker_t *worker);
+
+/* 工作线程主函数 */
+static void *httpd_worker_run(void *arg);
+
+/* 创建工作线程池 */
+static void httpd_worker_pool_startup(void);
+
+/* 将新连接分配给工作线程 */
+static httpd_worker_t *httpd_dispatch_connection(int client);
+
+/* 初始化连接准入控制 */
+static void httpd_admission_init(void);
+
+/* 检查新连接是否超过连接数上限 */
+static int  httpd_admission_check(int client);
+
+/* 判断accept失败是否因为资源耗尽 */
+static int  httpd_accept_exhausted(int err);
+
+/* 接受客户端连接并分配给工作线程 */
+static void httpd_accept_connections(int server_sock);
+
+#ifdef HTTPD_IO_URING
+/* 创建io_uring实例 */
+static httpd_uring_t *httpd_uring_create(unsigned int entries, int recv_bufs);
+
+/* 销毁io_uring实例 */
+static void httpd_uring_destroy(httpd_uring_t *ring);
+
+/* 提交已填写的请求，可等待完成事件 */
+static int  httpd_uring_submit(httpd_uring_t *ring, unsigned int wait_nr);
+
+/* 确保提交队列有足够的空位 */
+static int  httpd_uring_reserve(httpd_uring_t *ring, unsigned int n);
+
+/* 取一个提交队列项 */
+static struct io_uring_sqe *httpd_uring_get_sqe(httpd_uring_t *ring, __u64 user_data);
+
+/* 取一个完成事件 */
+static int  httpd_uring_peek(httpd_uring_t *ring, struct io_uring_cqe *cqe);
+
+/* 将接收缓冲区归还给内核 */
+static void httpd_uring_buf_recycle(httpd_uring_t *ring, int bid);
+
+/* 提交multishot accept */
+static int  httpd_uring_accept(httpd_uring_t *ring, int listen_fd);
+
+/* 提交接收请求 */
+static void httpd_uring_recv(httpd_conn_t *conn);
+
+/* 用io_uring发送静态文件 */
+static int  httpd_uring_send_file(httpd_conn_t *conn);
+
+/* 取消连接尚未完成的io_uring请求 */
+static void httpd_uring_cancel(httpd_conn_t *conn);
+
+/* 为反应堆创建io_uring */
+static void httpd_reactor_uring_init(httpd_reactor_t *reactor);
+
+/* 处理反应堆io_uring的完成事件 */
+static void httpd_reactor_uring_complete(httpd_reactor_t *reactor);
+
+/* 用io_uring multishot accept接受客户端连接并分配给工作线程 */
+static int  httpd_uring_accept_connections(int server_sock);
+#endif
+
+/* 打印命令行用法 */
+static void httpd_usage(const char *prog);
+
+
+/*****************************************************************************
+ * 函  数:    httpd_error_exit
+ * 功  能:    记录错误信息并关闭服务器程序
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_error_exit(const char *error)
+{
+    perror(error);
+    exit(1);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_set_nonblocking
+ * 功  能:    设置文件描述符为非阻塞模式
+ * 输  入:    fd: 文件描述符
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_set_nonblocking(int fd)
+{
+    int flags = 0;
+
+    flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0)
+    {
+        return -1;
+    }
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+/*****************************************************************************
+ * 函  数:    httpd_server_startup
+ * 功  能:    创建TCP服务监听
+ * 输  入:    reuseport: 是否设置SO_REUSEPORT(多个socket监听同一端口，由内核
+ *                       在它们之间分配连接)
+ * 输  出:    无
+ * 返回值:    监听socket
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 监听socket改为非阻塞；等待队列长度可配置；
+ *            支持SO_REUSEPORT
+ ****************************************************************************/
+static int httpd_server_startup(int reuseport)
+{
+    int server_sock = -1;
+    int on = 1;
+    struct sockaddr_in server_addr;
+
+    server_sock = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (-1 == server_sock)
+    {
+        httpd_error_exit("socket failed");
+    }
+
+    memset(&server_addr, 0x00, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(g_httpd_config.port);
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0)
+    {
+        httpd_error_exit("setsockopt failed");
+    }
+
+    if (reuseport && (setsockopt(server_sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0))
+    {
+        httpd_error_exit("setsockopt SO_REUSEPORT failed");
+    }
+
+    if (bind(server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    {
+        httpd_error_exit("bind failed");
+    }
+
+    /* 等待队列过短时突发连接的SYN会被丢弃(实际长度受net.core.somaxconn限制) */
+    if (listen(server_sock, g_httpd_config.backlog) < 0)
+    {
+        httpd_error_exit("listen failed");
+    }
+
+    return (server_sock);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_reuseport_attach_cpu
+ * 功  能:    为SO_REUSEPORT监听组加载cBPF程序，按处理SYN的CPU选择监听socket
+ *            (CPU编号对监听socket数取模)。工作线程绑定CPU时，连接由与网卡
+ *            中断同一CPU上的线程处理；加载失败时仍按四元组哈希分配
+ * 输  入:    listen_fd:  监听组中的任一socket
+ *            group_size: 监听组中的socket数
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_reuseport_attach_cpu(int listen_fd, int group_size)
+{
+    struct sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU},  /* A = 当前CPU      */
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, (unsigned int)group_size}, /* A = A % 监听数   */
+        {BPF_RET | BPF_A, 0, 0, 0},                                  /* 返回监听socket序号 */
+    };
+    struct sock_fprog prog;
+
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(listen_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0)
+    {
+        perror("setsockopt SO_ATTACH_REUSEPORT_CBPF failed");
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_fill
+ * 功  能:    从socket读取数据到连接接收缓冲区，缓冲区已满时先将未解析的数据
+ *            移到缓冲区头部
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    >0: 读取的字节数  0: 暂无数据  -1: 连接已关闭或出错
+ *            -2: 缓冲区已满(单行报文过长)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 使用io_uring时，请求阶段暂无数据则提交
+ *            接收请求，数据到达后由完成事件直接放入接收缓冲区
+ ****************************************************************************/
+static int httpd_conn_fill(httpd_conn_t *conn)
+{
+    int n = 0;
+
+#ifdef HTTPD_IO_URING
+    if (conn->uring_error)
+    {
+        return -1;
+    }
+
+    /* 接收请求完成前不能再读socket，否则数据顺序会乱 */
+    if (conn->uring_recv)
+    {
+        return 0;
+    }
+#endif
+
+    if (conn->rlen == (int)sizeof(conn->rbuf))
+    {
+        if (0 == conn->rpos)
+        {
+            return -2;
+        }
+
+        memmove(conn->rbuf, conn->rbuf + conn->rpos, conn->rlen - conn->rpos);
+        conn->rlen -= conn->rpos;
+        conn->rpos = 0;
+    }
+
+    while (1)
+    {
+        n = recv(conn->ev.fd, conn->rbuf + conn->rlen, sizeof(conn->rbuf) - conn->rlen, 0);
+        if (n > 0)
+        {
+            conn->rlen += n;
+            return n;
+        }
+        else if (0 == n)
+        {
+            return -1;
+        }
+        else if (EINTR != errno)
+        {
+            if ((EAGAIN != errno) && (EWOULDBLOCK != errno))
+            {
+                return -1;
+            }
+#ifdef HTTPD_IO_URING
+            if (conn->state <= HTTPD_CONN_REQUEST_HEADER)
+            {
+                httpd_uring_recv(conn);
+            }
+#endif
+            return 0;
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_scan_scalar
+ * 功  能:    逐字节查找第一个属于分隔符集合的字符
+ * 输  入:    p:   查找起始位置
+ *            end: 查找结束位置
+ *            set: 分隔符集合
+ *            n:   分隔符个数
+ * 输  出:    无
+ * 返回值:    第一个分隔符的位置，没有时返回end
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static const char *httpd_scan_scalar(const char *p, const char *end, const char *set, int n)
+{
+    int i = 0;
+
+    for (; p < end; p++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (*p == set[i])
+            {
+                return p;
+            }
+        }
+    }
+
+    return end;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*****************************************************************************
+ * 函  数:    httpd_scan_sse42
+ * 功  能:    用SSE4.2 PCMPESTRI每次比较16字节，查找第一个属于分隔符集合的
+ *            字符，不足16字节的尾部逐字节查找
+ * 输  入:    p:   查找起始位置
+ *            end: 查找结束位置
+ *            set: 分隔符集合(最多16个)
+ *            n:   分隔符个数
+ * 输  出:    无
+ * 返回值:    第一个分隔符的位置，没有时返回end
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+__attribute__((target("sse4.2")))
+static const char *httpd_scan_sse42(const char *p, const char *end, const char *set, int n)
+{
+    char needle_buf[16] = {0};
+    __m128i needle;
+    __m128i hay;
+    int idx = 0;
+
+    /* 分隔符集合可能不足16字节，复制后再加载避免越界读 */
+    memcpy(needle_buf, set, n);
+    needle = _mm_loadu_si128((const __m128i *)needle_buf);
+
+    while (end - p >= 16)
+    {
+        hay = _mm_loadu_si128((const __m128i *)p);
+        idx = _mm_cmpestri(needle, n, hay, 16,
+                           _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (idx < 16)
+        {
+            return p + idx;
+        }
+        p += 16;
+    }
+
+    return httpd_scan_scalar(p, end, set, n);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_scan_avx2
+ * 功  能:    用AVX2每次比较32字节，查找第一个属于分隔符集合的字符，不足32
+ *            字节的尾部逐字节查找
+ * 输  入:    p:   查找起始位置
+ *            end: 查找结束位置
+ *            set: 分隔符集合(最多4个，更多时改用SSE4.2)
+ *            n:   分隔符个数
+ * 输  出:    无
+ * 返回值:    第一个分隔符的位置，没有时返回end
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+__attribute__((target("avx2")))
+static const char *httpd_scan_avx2(const char *p, const char *end, const char *set, int n)
+{
+    __m256i needle[4];
+    __m256i hay;
+    __m256i eq;
+    unsigned int mask = 0;
+    int i = 0;
+
+    if (n > 4)
+    {
+        return httpd_scan_sse42(p, end, set, n);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        needle[i] = _mm256_set1_epi8(set[i]);
+    }
+
+    while (end - p >= 32)
+    {
+        hay = _mm256_loadu_si256((const __m256i *)p);
+        eq = _mm256_cmpeq_epi8(hay, needle[0]);
+        for (i = 1; i < n; i++)
+        {
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(hay, needle[i]));
+        }
+
+        mask = (unsigned int)_mm256_movemask_epi8(eq);
+        if (0 != mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+
+    return httpd_scan_scalar(p, end, set, n);
+}
+#endif
+
+/*****************************************************************************
+ * 函  数:    httpd_scan_init
+ * 功  能:    按CPU支持的指令集选择分隔符查找函数(AVX2 > SSE4.2 > 逐字节)，
+ *            编译时不需要指定-m选项
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_scan_init(void)
+{
+    g_httpd_scan = httpd_scan_scalar;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        g_httpd_scan = httpd_scan_avx2;
+    }
+    else if (__builtin_cpu_supports("sse4.2"))
+    {
+        g_httpd_scan = httpd_scan_sse42;
+    }
+#endif
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_header_hash
+ * 功  能:    计算请求头字段名的哈希值: 长度+首字符+尾字符*4(字母转为小写)，
+ *            对已知请求头没有冲突
+ * 输  入:    name: 字段名
+ *            len:  字段名长度(>0)
+ * 输  出:    无
+ * 返回值:    哈希值
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static unsigned int httpd_header_hash(const char *name, size_t len)
+{
+    return (unsigned int)(len + (name[0] | 0x20) + ((name[len - 1] | 0x20) << 2)) &
+           (HTTPD_HEADER_HASH_SIZE - 1);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_header_hash_init
+ * 功  能:    生成已知请求头完美哈希表，新增的请求头与已有请求头哈希冲突时
+ *            退出程序，需调整哈希函数
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_header_hash_init(void)
+{
+    unsigned int h = 0;
+    int id = 0;
+
+    for (id = 0; id < HTTPD_HDR_NUM; id++)
+    {
+        h = httpd_header_hash(g_httpd_header_names[id].data, g_httpd_header_names[id].len);
+        if (0 != g_httpd_header_hash[h])
+        {
+            httpd_error_exit("header hash collision");
+        }
+        g_httpd_header_hash[h] = (unsigned char)(id + 1);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_header_lookup
+ * 功  能:    查找已知请求头编号: 哈希定位后只需比较一次字段名
+ * 输  入:    name: 字段名
+ *            len:  字段名长度(>0)
+ * 输  出:    无
+ * 返回值:    HTTPD_HDR_*，不是已知请求头时返回HTTPD_HDR_UNKNOWN
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_header_lookup(const char *name, size_t len)
+{
+    int id = g_httpd_header_hash[httpd_header_hash(name, len)] - 1;
+
+    if ((id >= 0) && (g_httpd_header_names[id].len == len) &&
+        (0 == strncasecmp(g_httpd_header_names[id].data, name, len)))
+    {
+        return id;
+    }
+
+    return HTTPD_HDR_UNKNOWN;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_header
+ * 功  能:    获取已知请求头的值，同名请求头出现多次时返回第一个
+ * 输  入:    h_data: HTTP请求数据
+ *            id:     HTTPD_HDR_*
+ * 输  出:    无
+ * 返回值:    以'\0'结尾的字段值(指向接收缓冲区)，没有该请求头时返回NULL
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static const char *httpd_request_header(const http_request_data_t *h_data, int id)
+{
+    int idx = h_data->known[id];
+
+    return (0 != idx) ? h_data->headers[idx - 1].value.data : NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_get_line_message
+ * 功  能:    获取一行HTTP报文。请求行和请求头解析期间conn->rpos保持为0，
+ *            数据未到齐时下次从上次查找结束处继续，不重复扫描
+ * 输  入:    conn: 客户端连接
+ * 输  出:    line: 指向接收缓冲区的行视图(不含行尾"\r\n"，行尾原地改为'\0')
+ * 返回值:    1: 获取到一行  0: 数据未到齐  -1: 连接已关闭或出错
+ *            -2: 请求行和请求头超过接收缓冲区大小  -3: 行中有单独的'\r'
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 改为在连接接收缓冲区中查找行尾，一次recv
+ *            读取尽可能多的数据，返回行视图而不拷贝
+ *            2026-10-16 changzehai(DTT) 用SIMD查找行尾，增量解析
+ ****************************************************************************/
+static int httpd_get_line_message(httpd_conn_t *conn, httpd_str_t *line)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    char *start = NULL;
+    char *end = NULL;
+    char *limit = NULL;
+    int next = 0;
+    int n = 0;
+
+    while (1)
+    {
+        limit = conn->rbuf + conn->rlen;
+        end = (char *)g_httpd_scan(conn->rbuf + h_data->scan_pos, limit, "\r\n", 2);
+        if ((end < limit) && ('\r' == *end))
+        {
+            if (end + 1 == limit)
+            {
+                /* '\r'是已接收的最后一个字节，等待后面的'\n' */
+                end = limit;
+            }
+            else if ('\n' != end[1])
+            {
+                return -3;
+            }
+            else
+            {
+                next = end - conn->rbuf + 2;
+            }
+        }
+        else
+        {
+            /* 行尾"\r\n"和"\n"都视为行结束 */
+            next = end - conn->rbuf + 1;
+        }
+
+        if (end < limit)
+        {
+            start = conn->rbuf + h_data->parse_pos;
+            *end = '\0';
+            h_data->parse_pos = next;
+            h_data->scan_pos = next;
+
+            line->data = start;
+            line->len = end - start;
+            return 1;
+        }
+
+        h_data->scan_pos = end - conn->rbuf;
+        if ((h_data->scan_pos > 0) && ('\r' == end[-1]))
+        {
+            h_data->scan_pos--;
+        }
+
+        n = httpd_conn_fill(conn);
+        if (n <= 0)
+        {
+            return n;
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_header_split
+ * 功  能:    将请求头行拆分为字段名和字段值视图，字段名后的':'和字段值后的
+ *            空白原地改为'\0'，并查找已知请求头编号
+ * 输  入:    line: 请求头行(以'\0'结尾，位于接收缓冲区中)
+ * 输  出:    header: 字段名、字段值及已知请求头编号
+ * 返回值:    0: 成功  -1: 格式错误(没有':'、字段名为空或字段名后有空白)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 用SIMD查找':'，拒绝不合法的字段名
+ ****************************************************************************/
+static int httpd_header_split(const httpd_str_t *line, httpd_header_t *header)
+{
+    const char *colon = NULL;
+    const char *value = NULL;
+    const char *end = line->data + line->len;
+
+    /* 字段名中及字段名与':'之间不允许有空白(RFC 7230 3.2.4) */
+    colon = g_httpd_scan(line->data, end, ": \t", 3);
+    if ((colon == end) || (':' != *colon) || (colon == line->data))
+    {
+        return -1;
+    }
+
+    header->name.data = line->data;
+    header->name.len = colon - line->data;
+
+    value = colon + 1;
+    while ((value < end) && ((' ' == *value) || ('\t' == *value)))
+    {
+        value++;
+    }
+    while ((end > value) && ((' ' == end[-1]) || ('\t' == end[-1])))
+    {
+        end--;
+    }
+
+    header->value.data = value;
+    header->value.len = end - value;
+
+    ((char *)colon)[0] = '\0';
+    ((char *)end)[0] = '\0';
+    header->id = httpd_header_lookup(header->name.data, header->name.len);
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_str_equal
+ * 功  能:    字符串视图与字符串常量比较(忽略大小写)
+ * 输  入:    str:     字符串视图
+ *            literal: 字符串常量
+ * 输  出:    无
+ * 返回值:    1: 相等  0: 不相等
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_str_equal(const httpd_str_t *str, const char *literal)
+{
+    return ((strlen(literal) == str->len) && (0 == strncasecmp(str->data, literal, str->len)));
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_line_analyze
+ * 功  能:    解析HTTP报文的请求行: 方法 SP 请求URI SP HTTP版本，方法和查询
+ *            参数原地以'\0'结尾，不拷贝
+ * 输  入:    conn: 客户端连接
+ * 输  出:    conn->http_data.req_line_data: 请求行数据
+ * 返回值:    1: 解析完成  0: 数据未到齐  -1: 连接已关闭或出错
+ *            -2: 请求URI过长  -3: 请求行格式错误
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 改为从接收缓冲区的行视图解析
+ *            2026-10-16 changzehai(DTT) 用SIMD查找分隔符，不再截断过长的URI；
+ *            所有方法都拆分查询参数
+ *            2026-10-16 changzehai(DTT) URL路径改在处理请求时解析为文件路径
+ ****************************************************************************/
+static int httpd_request_line_analyze(httpd_conn_t *conn)
+{
+    http_request_line_data_t *req_line_data = &conn->http_data.req_line_data;
+    httpd_str_t line;
+    char *p = NULL;
+    char *end = NULL;
+    char *sp = NULL;
+    int query = 0;
+    int n = 0;
+
+    /* 请求行之前的空行忽略 */
+    do
+    {
+        n = httpd_get_line_message(conn, &line);
+        if (n <= 0)
+        {
+            return n;
+        }
+    } while (0 == line.len);
+
+    p = (char *)line.data;
+    end = p + line.len;
+
+    /* 请求方法 */
+    sp = (char *)g_httpd_scan(p, end, " ", 1);
+    if ((sp == p) || (sp == end))
+    {
+        return -3;
+    }
+    *sp = '\0';
+    req_line_data->method = p;
+
+    /* 请求URI，第一个'?'之后为查询参数 */
+    p = sp + 1;
+    if ('/' != *p)
+    {
+        return -3;
+    }
+
+    sp = (char *)g_httpd_scan(p, end, " ?", 2);
+    req_line_data->uri.data = p;
+    req_line_data->uri.len = sp - p;
+    req_line_data->query_string = "";
+    if ((sp < end) && ('?' == *sp))
+    {
+        req_line_data->query_string = sp + 1;
+        query = 1;
+        sp = (char *)g_httpd_scan(sp + 1, end, " ", 1);
+    }
+
+    /* HTTP版本，没有时按HTTP/1.0处理 */
+    req_line_data->http_version = 10;
+    if (sp < end)
+    {
+        *sp = '\0';
+        p = sp + 1;
+        if ((end - p != 8) || (0 != strncmp(p, "HTTP/1.", 7)) || (('0' != p[7]) && ('1' != p[7])))
+        {
+            return -3;
+        }
+        req_line_data->http_version = ('0' == p[7]) ? 10 : 11;
+    }
+
+    if (0 == strcasecmp(req_line_data->method, "GET"))
+    {
+        req_line_data->cgi = query;
+    }
+    else if (0 == strcasecmp(req_line_data->method, "POST"))
+    {
+        req_line_data->cgi = 1;
+    }
+
+    /* url中的路径在处理请求时才解析为文件路径(httpd_path_lookup)，这里只
+       检查解析后的长度不会超出 */
+    if (sizeof(HTTPD_DOC_ROOT "/" HTTPD_INDEX_FILE) + req_line_data->uri.len > sizeof(req_line_data->path))
+    {
+        return -2;
+    }
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_header_analyze
+ * 功  能:    解析HTTP报文的请求头，所有请求头保存为字段名/字段值视图，
+ *            已知请求头可按编号直接查找
+ * 输  入:    conn: 客户端连接
+ * 输  出:    conn->http_data.headers/header_num/known: 请求头
+ *            conn->http_data.content_length: 请求体长度
+ *            conn->http_data.connection:     Connection请求头
+ *            conn->http_data.if_modified_since: 条件请求头
+ *            conn->http_data.accept_encoding: 客户端接受的内容编码
+ *            conn->http_data.chunked/expect_continue: 请求体传输方式
+ *            conn->rpos: 请求体起始位置
+ * 返回值:    1: 请求头接收完毕  0: 数据未到齐  -1: 连接已关闭或出错
+ *            -2: 请求头过长或过多  -3: 请求头格式错误
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 改为逐行增量解析，请求头拆分为字段名和
+ *            字段值视图后按字段名匹配
+ *            2026-10-16 changzehai(DTT) 保存所有请求头，已知请求头用完美哈希
+ *            查找；检查续行、非法字段名及Content-Length
+ *            2026-10-16 changzehai(DTT) 解析Transfer-Encoding及Expect
+ *            2026-10-16 changzehai(DTT) Content-Length不再限制在2GB以内
+ *            2026-10-16 changzehai(DTT) Connection请求头按逗号分隔的选项解析
+ ****************************************************************************/
+static int httpd_request_header_analyze(httpd_conn_t *conn)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    httpd_header_t *header = NULL;
+    httpd_str_t line;
+    const char *p = NULL;
+    long long length = 0;
+    int numchars = 1;
+    int n = 0;
+
+    while ((numchars = httpd_get_line_message(conn, &line)) > 0)
+    {
+        /* 空行表示请求头结束，其后为请求体或流水线发送的下一个请求；
+           同时指定Content-Length和chunked编码时请求体边界有歧义 */
+        if (0 == line.len)
+        {
+            if (h_data->chunked && (h_data->content_length >= 0))
+            {
+                return -3;
+            }
+            conn->rpos = h_data->parse_pos;
+            return 1;
+        }
+
+        /* 不支持已废弃的续行(obs-fold) */
+        if ((' ' == line.data[0]) || ('\t' == line.data[0]))
+        {
+            return -3;
+        }
+
+        if (h_data->header_num >= HTTPD_HEADER_MAX)
+        {
+            return -2;
+        }
+
+        header = &h_data->headers[h_data->header_num];
+        if (httpd_header_split(&line, header) < 0)
+        {
+            return -3;
+        }
+        h_data->header_num++;
+
+        if (HTTPD_HDR_UNKNOWN == header->id)
+        {
+            continue;
+        }
+
+        if (0 == h_data->known[header->id])
+        {
+            h_data->known[header->id] = (unsigned char)h_data->header_num;
+        }
+
+        switch (header->id)
+        {
+            case HTTPD_HDR_CONTENT_LENGTH:
+                /* 只接受十进制数字，溢出时按格式错误处理；多个Content-Length不一致时
+                   无法确定请求体边界。长度上限由httpd_request_error_deal检查 */
+                length = 0;
+                for (p = header->value.data; p < header->value.data + header->value.len; p++)
+                {
+                    if (!isdigit((unsigned char)*p) || (length > (LLONG_MAX - (*p - '0')) / 10))
+                    {
+                        return -3;
+                    }
+                    length = length * 10 + (*p - '0');
+                }
+                if ((0 == header->value.len) ||
+                    ((h_data->content_length >= 0) && (h_data->content_length != length)))
+                {
+                    return -3;
+                }
+                h_data->content_length = length;
+                break;
+
+            case HTTPD_HDR_TRANSFER_ENCODING:
+                /* 只支持chunked编码，其他编码无法确定请求体边界 */
+                if (!httpd_str_equal(&header->value, "chunked") || h_data->chunked)
+                {
+                    return -3;
+                }
+                h_data->chunked = 1;
+                break;
+
+            case HTTPD_HDR_EXPECT:
+                if (httpd_str_equal(&header->value, "100-continue"))
+                {
+                    h_data->expect_continue = 1;
+                }
+                break;
+
+            case HTTPD_HDR_ACCEPT_ENCODING:
+                h_data->accept_encoding = httpd_accept_encoding_parse(&header->value);
+                break;
+
+            case HTTPD_HDR_IF_MODIFIED_SINCE:
+                h_data->if_modified_since = httpd_http_date_parse(&header->value);
+                break;
+
+            case HTTPD_HDR_CONNECTION:
+                /* 可能有多个Connection请求头，close优先 */
+                n = httpd_connection_parse(&header->value);
+                if (n > h_data->connection)
+                {
+                    h_data->connection = n;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return numchars;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_method_error
+ * 功  能:    返回请求方法错误信息给客户端
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 先生成报文体以填写Content-Length
+ ****************************************************************************/
+static void httpd_request_method_error(httpd_conn_t *conn)
+{
+	const char *body = "<HTML><HEAD><TITLE>Method Not Implemented\r\n"
+	                   "</TITLE></HEAD>\r\n"
+	                   "<BODY><P>HTTP request method not supported.\r\n"
+	                   "</BODY></HTML>\r\n";
+
+
+	/* 发送501说明相应方法没有实现，未知方法的请求体无法跳过，需关闭连接 */
+	conn->keep_alive = 0;
+	httpd_response_header(conn, "501 Method Not Implemented", strlen(body), NULL);
+	httpd_conn_send(conn, body, strlen(body));
+
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_path_error
+ * 功  能:    返回请求资源路径错误给客户端
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 先生成报文体以填写Content-Length
+ ****************************************************************************/
+static void httpd_request_path_error(httpd_conn_t *conn)
+{
+	const char *body = "<HTML><TITLE>Not Found</TITLE>\r\n"
+	                   "<BODY><P>The server could not fulfill\r\n"
+	                   "your request because the resource specified\r\n"
+	                   "is unavailable or nonexistent.\r\n"
+	                   "</BODY></HTML>\r\n";
+
+	/* 返回404 */
+	httpd_response_header(conn, "404 NOT FOUND", strlen(body), NULL);
+	httpd_conn_send(conn, body, strlen(body));
+}
+
+
+/*****************************************************************************
+ * 函  数:    httpd_request_cannot_execute_error
+ * 功  能:    返回不能执行CGI程序错误给客户端
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 先生成报文体以填写Content-Length
+ *            2026-10-16 changzehai(DTT) 回复后关闭连接
+ ****************************************************************************/
+static void httpd_request_cannot_execute_error(httpd_conn_t *conn)
+{
+	const char *body = "<P>Error prohibited CGI execution.\r\n";
+
+
+	/* 发送500 错误，请求体可能未读取，需关闭连接 */
+	conn->keep_alive = 0;
+	httpd_response_header(conn, "500 Internal Server Error", strlen(body), NULL);
+	httpd_conn_send(conn, body, strlen(body));
+
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_bad_error
+ * 功  能:    返回HTTP坏请求错误(content_lenght有误)
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 先生成报文体以填写Content-Length
+ ****************************************************************************/
+static void httpd_request_bad_error(httpd_conn_t *conn)
+{
+	const char *body = "<P>Your browser sent a bad request, "
+	                   "such as a POST without a Content-Length.\r\n";
+
+
+	/* 发送400错误，请求边界已无法确定，需关闭连接 */
+	conn->keep_alive = 0;
+	httpd_response_header(conn, "400 BAD REQUEST", strlen(body), NULL);
+	httpd_conn_send(conn, body, strlen(body));
+
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_too_large_error
+ * 功  能:    返回请求行或请求头过长错误: 解析请求行时回复414，解析请求头时
+ *            回复431
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_request_too_large_error(httpd_conn_t *conn)
+{
+	const char *body = "<P>Your browser sent a request that this server could not handle, "
+	                   "the request line or header fields are too large.\r\n";
+	const char *status = (HTTPD_CONN_REQUEST_LINE == conn->state) ?
+	                     "414 URI Too Long" : "431 Request Header Fields Too Large";
+
+
+	/* 请求未接收完整，需关闭连接 */
+	conn->keep_alive = 0;
+	httpd_response_header(conn, status, strlen(body), NULL);
+	httpd_conn_send(conn, body, strlen(body));
+
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_entity_too_large_error
+ * 功  能:    返回请求体过长错误(超过g_httpd_config.body_max)
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_request_entity_too_large_error(httpd_conn_t *conn)
+{
+	const char *body = "<P>Your browser sent a request body larger than "
+	                   "this server accepts.\r\n";
+
+
+	/* 请求体未读取，需关闭连接 */
+	conn->keep_alive = 0;
+	httpd_response_header(conn, "413 Payload Too Large", strlen(body), NULL);
+	httpd_conn_send(conn, body, strlen(body));
+
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_unavailable_error
+ * 功  能:    返回服务暂不可用错误(CGI程序已满且等待队列已满或等待超时)
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计回复状态码
+ ****************************************************************************/
+static void httpd_request_unavailable_error(httpd_conn_t *conn)
+{
+	const char *body = "<HTML><HEAD><TITLE>Service Unavailable\r\n"
+	                   "</TITLE></HEAD>\r\n"
+	                   "<BODY><P>Server is busy, please retry later.\r\n"
+	                   "</BODY></HTML>\r\n";
+	char buf[1024];
+	int len = 0;
+
+
+	/* 请求体未读取，需关闭连接；Retry-After提示客户端稍后重试 */
+	conn->keep_alive = 0;
+	httpd_stats_status(conn, 503);
+	len = httpd_response_header_format(buf, sizeof(buf), "503 Service Unavailable", "text/html",
+	                                   strlen(body), NULL, NULL);
+	len += snprintf(buf + len, sizeof(buf) - len, "Retry-After: %d\r\nConnection: close\r\n\r\n",
+	                (g_httpd_config.cgi_wait_timeout > 0) ? g_httpd_config.cgi_wait_timeout : 1);
+	httpd_conn_send(conn, buf, len);
+	httpd_conn_send(conn, body, strlen(body));
+
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_hex_value
+ * 功  能:    十六进制字符转换为数值
+ * 输  入:    c: 字符
+ * 输  出:    无
+ * 返回值:    0~15，不是十六进制字符时返回-1
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_hex_value(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    c = (char)tolower((unsigned char)c);
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_mime_compare
+ * 功  能:    bsearch比较函数: 扩展名与MIME类型表项比较
+ * 输  入:    key:  扩展名(小写)
+ *            item: MIME类型表项
+ * 输  出:    无
+ * 返回值:    <0、0、>0
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_mime_compare(const void *key, const void *item)
+{
+    return strcmp((const char *)key, ((const httpd_mime_t *)item)->ext);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_mime_lookup
+ * 功  能:    按文件扩展名(不区分大小写)在MIME类型表中二分查找
+ * 输  入:    path: 文件路径
+ * 输  出:    无
+ * 返回值:    MIME类型表项，没有扩展名或未知扩展名时返回NULL
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static const httpd_mime_t *httpd_mime_lookup(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    char key[8];
+    size_t i = 0;
+
+    if ((NULL == ext) || (NULL != strchr(ext, '/')))
+    {
+        return NULL;
+    }
+
+    for (ext++; '\0' != ext[i]; i++)
+    {
+        if (i + 1 >= sizeof(key))
+        {
+            return NULL;
+        }
+        key[i] = (char)tolower((unsigned char)ext[i]);
+    }
+    key[i] = '\0';
+
+    return (const httpd_mime_t *)bsearch(key, g_httpd_mime_types,
+                                         sizeof(g_httpd_mime_types) / sizeof(g_httpd_mime_types[0]),
+                                         sizeof(g_httpd_mime_types[0]), httpd_mime_compare);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_path_resolve
+ * 功  能:    将请求URL路径解析为文件路径: 解码%XX，去掉空段和"."段，".."段
+ *            回退上一段，回退到根目录之外时拒绝；以'/'结尾时加上首页文件名
+ * 输  入:    uri:  请求URL路径(以'/'开头，不含查询参数)
+ *            len:  URL路径长度
+ *            size: 文件路径缓冲区大小(不小于len加上根目录和首页文件名的长度)
+ * 输  出:    path: 文件路径(以HTTPD_DOC_ROOT开头)
+ * 返回值:    0: 成功  -1: 编码错误或路径越出根目录
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_path_resolve(const char *uri, size_t len, char *path, size_t size)
+{
+    const char *end = uri + len;
+    size_t root = sizeof(HTTPD_DOC_ROOT) - 1;
+    size_t out = root;
+    size_t seg = 0;
+    int dir = 1;
+    int hi = 0;
+    int lo = 0;
+    char c = 0;
+
+    memcpy(path, HTTPD_DOC_ROOT, root);
+
+    while (uri < end)
+    {
+        /* 每段前先写'/'，段结束时检查是否为"."或".." */
+        path[out++] = '/';
+        seg = out;
+        for (; (uri < end) && ('/' != *uri); uri++)
+        {
+            c = *uri;
+            if ('%' == c)
+            {
+                if ((end - uri < 3) ||
+                    ((hi = httpd_hex_value(uri[1])) < 0) || ((lo = httpd_hex_value(uri[2])) < 0))
+                {
+                    return -1;
+                }
+                c = (char)((hi << 4) | lo);
+                uri += 2;
+                /* 解码后的'/'和'\0'会改变路径含义 */
+                if (('\0' == c) || ('/' == c))
+                {
+                    return -1;
+                }
+            }
+            if (out + 1 >= size)
+            {
+                return -1;
+            }
+            path[out++] = c;
+        }
+        if (uri < end)
+        {
+            uri++;  /* 跳过'/' */
+        }
+
+        /* 空段和"."段去掉，".."段回退到上一段 */
+        dir = 1;
+        if ((out == seg) || ((out - seg == 1) && ('.' == path[seg])))
+        {
+            out = seg - 1;
+        }
+        else if ((out - seg == 2) && ('.' == path[seg]) && ('.' == path[seg + 1]))
+        {
+            if (seg - 1 == root)
+            {
+                return -1;
+            }
+            for (out = seg - 2; '/' != path[out]; out--)
+            {
+            }
+        }
+        else
+        {
+            dir = 0;
+        }
+    }
+
+    /* 请求目录时返回首页 */
+    if (dir || ('/' == end[-1]))
+    {
+        if (out + sizeof("/" HTTPD_INDEX_FILE) > size)
+        {
+            return -1;
+        }
+        memcpy(path + out, "/" HTTPD_INDEX_FILE, sizeof("/" HTTPD_INDEX_FILE) - 1);
+        out += sizeof("/" HTTPD_INDEX_FILE) - 1;
+    }
+    path[out] = '\0';
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_path_lookup
+ * 功  能:    将请求URL路径解析为文件路径并获取文件属性。结果按URL路径缓存在
+ *            本线程的路径缓存中(直接映射，冲突时覆盖)，有效期内的请求不再
+ *            解析路径和调用stat；URL路径过长时不缓存
+ * 输  入:    conn: 客户端连接
+ * 输  出:    conn->http_data.req_line_data.path: 文件路径
+ *            conn->http_data.file_stat:          文件属性
+ *            conn->content_type:                 MIME类型
+ * 返回值:    0: 成功  -1: URL路径非法  >0: stat的错误码
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_path_lookup(httpd_conn_t *conn)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    http_request_line_data_t *req_line_data = &h_data->req_line_data;
+    httpd_reactor_t *reactor = conn->reactor;
+    httpd_path_entry_t *entry = NULL;
+    const httpd_mime_t *mime = NULL;
+    const char *uri = req_line_data->uri.data;
+    size_t uri_len = req_line_data->uri.len;
+    size_t len = 0;
+    unsigned int hash = 2166136261u;
+    size_t i = 0;
+    int err = 0;
+
+    if (uri_len < HTTPD_PATH_CACHE_KEY)
+    {
+        for (i = 0; i < uri_len; i++)
+        {
+            hash ^= (unsigned char)uri[i];
+            hash *= 16777619u;
+        }
+        entry = &reactor->paths[hash & (HTTPD_PATH_CACHE_SIZE - 1)];
+
+        if ((entry->expire > reactor->now) && (entry->hash == hash) &&
+            (entry->uri_len == uri_len) && (0 == memcmp(entry->uri, uri, uri_len)))
+        {
+            memcpy(req_line_data->path, entry->path, strlen(entry->path) + 1);
+            h_data->file_stat = entry->st;
+            conn->content_type = entry->content_type;
+            return entry->err;
+        }
+    }
+
+    if (httpd_path_resolve(uri, uri_len, req_line_data->path, sizeof(req_line_data->path)) < 0)
+    {
+        return -1;
+    }
+
+    /* 请求的目录不以'/'结尾时同样返回其首页 */
+    err = (0 == stat(req_line_data->path, &h_data->file_stat)) ? 0 : errno;
+    len = strlen(req_line_data->path);
+    if ((0 == err) && S_ISDIR(h_data->file_stat.st_mode) &&
+        (len + sizeof("/" HTTPD_INDEX_FILE) <= sizeof(req_line_data->path)))
+    {
+        memcpy(req_line_data->path + len, "/" HTTPD_INDEX_FILE, sizeof("/" HTTPD_INDEX_FILE));
+        len += sizeof("/" HTTPD_INDEX_FILE) - 1;
+        err = (0 == stat(req_line_data->path, &h_data->file_stat)) ? 0 : errno;
+    }
+
+    mime = httpd_mime_lookup(req_line_data->path);
+    conn->content_type = (NULL != mime) ? mime->type : "application/octet-stream";
+
+    if ((NULL != entry) && (len < sizeof(entry->path)))
+    {
+        entry->expire = reactor->now + HTTPD_PATH_CACHE_TTL;
+        entry->hash = hash;
+        entry->err = err;
+        entry->content_type = conn->content_type;
+        entry->st = h_data->file_stat;
+        entry->uri_len = uri_len;
+        memcpy(entry->uri, uri, uri_len);
+        memcpy(entry->path, req_line_data->path, len + 1);
+    }
+
+    return err;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_error_deal
+ * 功  能:    检查并处理HTTP请求错误
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计stat耗时
+ *            2026-10-16 changzehai(DTT) 请求资源路径经路径缓存解析及检查
+ *            2026-10-16 changzehai(DTT) 接受chunked编码的POST请求，检查请求体长度上限
+ ****************************************************************************/
+static int  httpd_request_error_deal(httpd_conn_t *conn)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    long long start = 0;
+    int ret = 0;
+
+    /* 检查请求方法是否正确 */
+    if ((0 != strcasecmp(h_data->req_line_data.method, "GET")) && 
+        (0 != strcasecmp(h_data->req_line_data.method, "POST")))
+    {
+        httpd_request_method_error(conn);
+        return -1;
+    }
+
+    /* 检查请求资源路径是否正确: 越出根目录的路径按格式错误处理 */
+    start = httpd_monotonic_ns();
+    ret = httpd_path_lookup(conn);
+    httpd_stats_record(conn->reactor, HTTPD_STAGE_STAT, httpd_monotonic_ns() - start);
+    if (ret < 0)
+    {
+        httpd_request_bad_error(conn);
+        return -1;
+    }
+    if (ret > 0)
+    {
+        httpd_request_path_error(conn);
+        return -1;
+    }
+
+#ifdef DEBUG
+    /* 如果需要执行CGI程序，需要检查请求的CGI脚步是否具有可执行权限 */
+    if (1 == h_data->req_line_data.cgi)
+    {
+        if ((h_data->file_stat.st_mode & S_IXUSR) ||
+            (h_data->file_stat.st_mode & S_IXGRP) ||
+            (h_data->file_stat.st_mode & S_IXOTH))
+        {
+            httpd_request_cannot_execute_error(conn);
+            return -1;
+        }
+    }
+#endif
+
+    /* 如果是POST请求，需检查Content_length长度是否正确，chunked编码的请求体
+       不需要Content_length */
+    if ((0 == strcasecmp(h_data->req_line_data.method, "POST")) &&
+        (h_data->content_length < 0) && !h_data->chunked)
+    {
+        httpd_request_bad_error(conn);
+        return -1;
+    }
+
+    /* 请求体长度超过上限时不再接收；chunked编码的请求体在接收过程中检查 */
+    if ((g_httpd_config.body_max > 0) && (h_data->content_length > g_httpd_config.body_max))
+    {
+        httpd_request_entity_too_large_error(conn);
+        return -1;
+    }
+
+   
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_response_header_format
+ * 功  能:    生成回复报文头，不含Connection及结尾空行(两者随请求变化，缓存的
+ *            报文头发送时再补上)
+ * 输  入:    buf:            输出缓冲区
+ *            size:           缓冲区大小
+ *            status:         状态码及描述，如"200 OK"
+ *            content_type:   回复报文体类型
+ *            content_length: 回复报文体长度，<0表示没有报文体(304)
+ *            st:             静态文件属性，用于生成ETag和Last-Modified，可为NULL
+ *            encoding:       Content-Encoding，""表示未编码但需要Vary，NULL表示不协商
+ * 输  出:    buf: 回复报文头
+ * 返回值:    报文头长度
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_response_header_format(char *buf, size_t size, const char *status,
+                                        const char *content_type, long content_length,
+                                        const struct stat *st, const char *encoding)
+{
+    char etag[HTTPD_ETAG_SIZE];
+    char date[64];
+    int len = 0;
+
+    len = snprintf(buf, size, "HTTP/1.1 %s\r\n" SERVER_STRING, status);
+
+    if (content_length >= 0)
+    {
+        len += snprintf(buf + len, size - len,
+                        "Content-Type: %s\r\n"
+                        "Content-Length: %ld\r\n",
+                        content_type, content_length);
+    }
+
+    /* 内容协商 */
+    if (NULL != encoding)
+    {
+        if ('\0' != encoding[0])
+        {
+            len += snprintf(buf + len, size - len, "Content-Encoding: %s\r\n", encoding);
+        }
+        len += snprintf(buf + len, size - len, "Vary: Accept-Encoding\r\n");
+    }
+
+    /* 缓存验证器 */
+    if (NULL != st)
+    {
+        httpd_file_etag(st, encoding, etag, sizeof(etag));
+        httpd_http_date(st->st_mtime, date, sizeof(date));
+        len += snprintf(buf + len, size - len,
+                        "Accept-Ranges: bytes\r\n"
+                        "ETag: %s\r\n"
+                        "Last-Modified: %s\r\n",
+                        etag, date);
+    }
+
+    return len;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_response_header
+ * 功  能:    发送回复报文头
+ * 输  入:    conn:           客户端连接
+ *            status:         状态码及描述，如"200 OK"
+ *            content_length: 回复报文体长度，<0表示没有报文体
+ *            st:             静态文件属性，可为NULL
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 改为HTTP/1.1，增加Content-Length、Connection
+ *            及静态文件的ETag、Last-Modified、Content-Encoding
+ *            2026-10-16 changzehai(DTT) 统计回复状态码
+ ****************************************************************************/
+static void httpd_response_header(httpd_conn_t *conn, const char *status, long content_length,
+                                  const struct stat *st)
+{
+	char buf[1024];
+
+	httpd_stats_status(conn, atoi(status));
+
+	/* 发送HTTP头 */
+	httpd_response_header_format(buf, sizeof(buf), status, (NULL != st) ? conn->content_type : "text/html",
+	                             content_length, st, (NULL != st) ? conn->encoding : NULL);
+	httpd_conn_send(conn, buf, strlen(buf));
+	sprintf(buf, "Connection: %s\r\n", conn->keep_alive ? "keep-alive" : "close");
+	httpd_conn_send(conn, buf, strlen(buf));
+	strcpy(buf, "\r\n");
+	httpd_conn_send(conn, buf, strlen(buf));
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_file_etag
+ * 功  能:    根据文件的inode、大小和修改时间生成强ETag，压缩后的内容加上编码
+ *            后缀，与未压缩的内容区分
+ * 输  入:    st:       文件属性
+ *            encoding: Content-Encoding，可为NULL
+ *            size:     缓冲区大小
+ * 输  出:    buf:      带双引号的ETag
+ * 返回值:    ETag长度
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_file_etag(const struct stat *st, const char *encoding, char *buf, size_t size)
+{
+    int has_enc = (NULL != encoding) && ('\0' != encoding[0]);
+
+    return snprintf(buf, size, "\"%lx-%lx-%lx%03lx%s%s\"",
+                    (unsigned long)st->st_ino, (unsigned long)st->st_size,
+                    (unsigned long)st->st_mtim.tv_sec, (unsigned long)(st->st_mtim.tv_nsec / 1000000),
+                    has_enc ? "-" : "", has_enc ? encoding : "");
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_http_date
+ * 功  能:    生成HTTP日期(IMF-fixdate)，如"Sun, 06 Nov 1994 08:49:37 GMT"
+ * 输  入:    t:    时间
+ *            size: 缓冲区大小
+ * 输  出:    buf:  HTTP日期
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_http_date(time_t t, char *buf, size_t size)
+{
+    static const char *wdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct tm tm;
+
+    /* 不使用strftime，避免受locale影响 */
+    gmtime_r(&t, &tm);
+    snprintf(buf, size, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+             wdays[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900,
+             tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_http_date_parse
+ * 功  能:    解析HTTP日期(IMF-fixdate)
+ * 输  入:    str: HTTP日期
+ * 输  出:    无
+ * 返回值:    时间  0: 格式错误
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static time_t httpd_http_date_parse(const httpd_str_t *str)
+{
+    static const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char buf[64];
+    char mon[4];
+    const char *p = NULL;
+    struct tm tm;
+
+    if (str->len >= sizeof(buf))
+    {
+        return 0;
+    }
+    memcpy(buf, str->data, str->len);
+    buf[str->len] = '\0';
+
+    memset(&tm, 0x00, sizeof(tm));
+    if (6 != sscanf(buf, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT",
+                    &tm.tm_mday, mon, &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec))
+    {
+        return 0;
+    }
+
+    mon[3] = '\0';
+    p = strstr(months, mon);
+    if ((NULL == p) || (0 != (p - months) % 3))
+    {
+        return 0;
+    }
+    tm.tm_mon = (p - months) / 3;
+    tm.tm_year -= 1900;
+
+    return timegm(&tm);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_not_modified
+ * 功  能:    判断静态文件自客户端缓存以来是否未修改: 有If-None-Match时只比较
+ *            ETag，否则比较If-Modified-Since与文件修改时间
+ * 输  入:    conn: 客户端连接
+ *            st:   文件属性
+ * 输  出:    无
+ * 返回值:    1: 未修改，可回复304  0: 需要回复完整内容
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 从请求头视图读取If-None-Match
+ ****************************************************************************/
+static int httpd_request_not_modified(httpd_conn_t *conn, const struct stat *st)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    const char *if_none_match = httpd_request_header(h_data, HTTPD_HDR_IF_NONE_MATCH);
+    char etag[HTTPD_ETAG_SIZE];
+    const char *p = NULL;
+    const char *end = NULL;
+    size_t etag_len = 0;
+
+    if ((NULL != if_none_match) && ('\0' != if_none_match[0]))
+    {
+        etag_len = httpd_file_etag(st, conn->encoding, etag, sizeof(etag));
+
+        /* If-None-Match: "a", W/"b", ... 使用弱比较 */
+        p = if_none_match;
+        while ('\0' != *p)
+        {
+            while ((' ' == *p) || (',' == *p) || ('\t' == *p))
+            {
+                p++;
+            }
+            if ('*' == *p)
+            {
+                return 1;
+            }
+            if (0 == strncmp(p, "W/", 2))
+            {
+                p += 2;
+            }
+
+            end = p;
+            while (('\0' != *end) && (',' != *end) && (' ' != *end) && ('\t' != *end))
+            {
+                end++;
+            }
+
+            if (((size_t)(end - p) == etag_len) && (0 == strncmp(p, etag, etag_len)))
+            {
+                return 1;
+            }
+            p = end;
+        }
+
+        return 0;
+    }
+
+    if ((0 != h_data->if_modified_since) && (st->st_mtime <= h_data->if_modified_since))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_send_file
+ * 功  能:    返回静态请求文件给客户端
+ * 输  入:    conn:     客户端连接
+ *            filename: 静态文件路径
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 只打开文件，文件内容由httpd_conn_flush
+ *            在socket可写时用sendfile发送；按文件大小填写Content-Length；
+ *            小文件从内存缓存发送；客户端缓存有效时回复304；支持Range请求；
+ *            按Accept-Encoding发送预压缩文件或缓存的gzip压缩内容
+ *            2026-10-16 changzehai(DTT) 统计回复状态码
+ ****************************************************************************/
+static void httpd_send_file(httpd_conn_t *conn, const char *filename)
+{
+    struct stat st;
+    struct stat sidecar_st;
+    char sidecar[HTTPD_PATH_SIZE + 4];
+    int encoding = HTTPD_ENC_IDENTITY;
+    int ret = 0;
+
+    /* 选择内容编码: 有.br/.gz预压缩文件时直接发送该文件 */
+    conn->encoding = httpd_file_compressible(filename) ? "" : NULL;
+    encoding = httpd_encoding_select(conn, filename, sidecar, sizeof(sidecar), &sidecar_st);
+    if ('\0' != sidecar[0])
+    {
+        conn->encoding = (HTTPD_ENC_BR == encoding) ? "br" : "gzip";
+        conn->http_data.file_stat = sidecar_st;
+        filename = sidecar;
+    }
+    else if (HTTPD_ENC_GZIP == encoding)
+    {
+        conn->encoding = "gzip";
+    }
+
+    /* 客户端缓存仍然有效，回复不带报文体的304 */
+    if (httpd_request_not_modified(conn, &conn->http_data.file_stat))
+    {
+        httpd_response_header(conn, "304 Not Modified", -1, &conn->http_data.file_stat);
+        return;
+    }
+
+    /* 断点续传、分段下载(只针对未编码的内容) */
+    ret = (HTTPD_ENC_IDENTITY == encoding) ? httpd_range_parse(conn, &conn->http_data.file_stat) : 0;
+    if (ret < 0)
+    {
+        httpd_response_range_error(conn, &conn->http_data.file_stat);
+        return;
+    }
+
+    /* 小文件优先从缓存发送，整个回复只需一次writev */
+    conn->cache_entry = (ret > 0) ? NULL : httpd_cache_lookup(filename, &conn->http_data.file_stat, encoding);
+    if ((0 == ret) && (NULL == conn->cache_entry))
+    {
+        conn->cache_entry = httpd_cache_load(filename, &conn->http_data.file_stat, conn->content_type, encoding,
+                                             (HTTPD_ENC_GZIP == encoding) && ('\0' == sidecar[0]));
+    }
+    if (NULL != conn->cache_entry)
+    {
+        conn->cache_sent = 0;
+        httpd_stats_status(conn, 200);
+        return;
+    }
+
+    /* 压缩失败时发送未压缩的文件 */
+    if ((HTTPD_ENC_IDENTITY != encoding) && ('\0' == sidecar[0]))
+    {
+        conn->encoding = "";
+    }
+
+    /* 打开文件 */
+    conn->file_fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if ((conn->file_fd < 0) || (fstat(conn->file_fd, &st) < 0) || !S_ISREG(st.st_mode))
+    {
+        if (conn->file_fd >= 0)
+        {
+            close(conn->file_fd);
+            conn->file_fd = -1;
+        }
+
+        /* 如果文件不存在，则返回not_found */
+        httpd_request_path_error(conn);
+        return;
+    }
+
+    /* 打开文件后重新解析，区间以实际发送的文件大小为准 */
+    if ((ret > 0) && (httpd_range_parse(conn, &st) > 0))
+    {
+        httpd_send_file_range(conn, &st);
+        return;
+    }
+    conn->range_num = 0;
+
+    conn->file_offset = 0;
+    conn->file_left = st.st_size;
+
+    /* 发送回复报文头 */
+    httpd_response_header(conn, "200 OK", (long)st.st_size, &st);
+}
+
+
+/*****************************************************************************
+ * 函  数:    httpd_range_parse
+ * 功  能:    解析Range请求头(bytes=a-b, c-, -n)，If-Range不匹配时忽略Range；
+ *            超出文件大小的区间被截断，完全不满足的区间被丢弃
+ * 输  入:    conn: 客户端连接
+ *            st:   文件属性
+ * 输  出:    conn->ranges/range_num: 请求的文件区间
+ * 返回值:    1: 回复部分内容  0: 回复完整文件  -1: 区间都不满足，回复416
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 从请求头视图读取Range和If-Range
+ ****************************************************************************/
+static int httpd_range_parse(httpd_conn_t *conn, const struct stat *st)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    const char *if_range = httpd_request_header(h_data, HTTPD_HDR_IF_RANGE);
+    char etag[HTTPD_ETAG_SIZE];
+    httpd_str_t date;
+    const char *p = httpd_request_header(h_data, HTTPD_HDR_RANGE);
+    char *end = NULL;
+    off_t size = st->st_size;
+    off_t first = 0;
+    off_t last = 0;
+    int num = 0;
+
+    conn->range_num = 0;
+    conn->range_idx = 0;
+
+    /* 只支持bytes单位，其他单位或格式错误时忽略Range */
+    if ((NULL == p) || (0 != strncmp(p, "bytes=", 6)))
+    {
+        return 0;
+    }
+    p += 6;
+
+    /* If-Range: ETag只做强比较，日期必须与文件修改时间完全相同 */
+    if ((NULL != if_range) && ('\0' != if_range[0]))
+    {
+        if ('"' == if_range[0])
+        {
+            httpd_file_etag(st, conn->encoding, etag, sizeof(etag));
+            if (0 != strcmp(if_range, etag))
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            date.data = if_range;
+            date.len = strlen(if_range);
+            if (httpd_http_date_parse(&date) != st->st_mtime)
+            {
+                return 0;
+            }
+        }
+    }
+
+    for (;;)
+    {
+        while ((' ' == *p) || ('\t' == *p))
+        {
+            p++;
+        }
+
+        if ('-' == *p)
+        {
+            /* 后缀区间: 最后n个字节 */
+            p++;
+            if (!isdigit((unsigned char)*p))
+            {
+                return 0;
+            }
+            last = strtoll(p, &end, 10);
+            p = end;
+            first = (last < size) ? (size - last) : 0;
+            last = (last > 0) ? (size - 1) : -1;
+        }
+        else if (isdigit((unsigned char)*p))
+        {
+            first = strtoll(p, &end, 10);
+            p = end;
+            if ('-' != *p)
+            {
+                return 0;
+            }
+            p++;
+            if (isdigit((unsigned char)*p))
+            {
+                last = strtoll(p, &end, 10);
+                p = end;
+                if (last < first)
+                {
+                    return 0;
+                }
+            }
+            else
+            {
+                last = size - 1;
+            }
+            if (last >= size)
+            {
+                last = size - 1;
+            }
+        }
+        else
+        {
+            return 0;
+        }
+
+        /* 丢弃不满足的区间；区间过多时按完整文件回复，防止大量小区间消耗资源 */
+        if ((first < size) && (first <= last))
+        {
+            if (HTTPD_RANGE_MAX == num)
+            {
+                return 0;
+            }
+            conn->ranges[num].first = first;
+            conn->ranges[num].last = last;
+            num++;
+        }
+
+        while ((' ' == *p) || ('\t' == *p))
+        {
+            p++;
+        }
+        if ('\0' == *p)
+        {
+            break;
+        }
+        if (',' != *p)
+        {
+            return 0;
+        }
+        p++;
+    }
+
+    if (0 == num)
+    {
+        return -1;
+    }
+
+    conn->range_num = num;
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_range_part_header
+ * 功  能:    生成multipart/byteranges中一个区间的报文头
+ * 输  入:    range:    文件区间
+ *            size:     文件大小
+ *            buf_size: 缓冲区大小
+ * 输  出:    buf:      区间报文头
+ * 返回值:    报文头长度
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_range_part_header(const httpd_range_t *range, off_t size, const char *content_type,
+                                   char *buf, size_t buf_size)
+{
+    return snprintf(buf, buf_size,
+                    "\r\n--" HTTPD_RANGE_BOUNDARY "\r\n"
+                    "Content-Type: %s\r\n"
+                    "Content-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                    content_type, (long long)range->first, (long long)range->last, (long long)size);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_send_file_range
+ * 功  能:    回复206部分内容: 单个区间直接用sendfile从偏移处发送；多个区间按
+ *            multipart/byteranges发送，区间之间的分隔报文头由httpd_range_next生成
+ * 输  入:    conn: 客户端连接(文件已打开，区间已解析)
+ *            st:   文件属性
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计回复状态码
+ ****************************************************************************/
+static void httpd_send_file_range(httpd_conn_t *conn, const struct stat *st)
+{
+    httpd_range_t *range = &conn->ranges[0];
+    char buf[1024];
+    char part[256];
+    long content_length = 0;
+    int len = 0;
+    int i = 0;
+
+    if (1 == conn->range_num)
+    {
+        len = httpd_response_header_format(buf, sizeof(buf), "206 Partial Content", conn->content_type,
+                                           (long)(range->last - range->first + 1), st, conn->encoding);
+        len += snprintf(buf + len, sizeof(buf) - len, "Content-Range: bytes %lld-%lld/%lld\r\n",
+                        (long long)range->first, (long long)range->last, (long long)st->st_size);
+    }
+    else
+    {
+        /* 预先计算整个multipart报文体的长度 */
+        for (i = 0; i < conn->range_num; i++)
+        {
+            content_length += httpd_range_part_header(&conn->ranges[i], st->st_size, conn->content_type,
+                                                      part, sizeof(part));
+            content_length += conn->ranges[i].last - conn->ranges[i].first + 1;
+        }
+        content_length += strlen("\r\n--" HTTPD_RANGE_BOUNDARY "--\r\n");
+
+        len = httpd_response_header_format(buf, sizeof(buf), "206 Partial Content",
+                                           "multipart/byteranges; boundary=" HTTPD_RANGE_BOUNDARY,
+                                           content_length, st, conn->encoding);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "Connection: %s\r\n\r\n",
+                    conn->keep_alive ? "keep-alive" : "close");
+    httpd_conn_send(conn, buf, len);
+    httpd_stats_status(conn, 206);
+
+    if (conn->range_num > 1)
+    {
+        len = httpd_range_part_header(range, st->st_size, conn->content_type, part, sizeof(part));
+        httpd_conn_send(conn, part, len);
+    }
+
+    /* 后续区间的分隔报文头使用与本次相同的文件大小 */
+    conn->http_data.file_stat = *st;
+    conn->range_idx = 0;
+    conn->file_offset = range->first;
+    conn->file_left = range->last - range->first + 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_range_next
+ * 功  能:    当前区间发送完毕后，为multipart/byteranges回复准备下一个区间；
+ *            最后一个区间之后放入结束分隔符
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 还有区间需要从文件发送  0: 文件内容已全部发送
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_range_next(httpd_conn_t *conn)
+{
+    httpd_range_t *range = NULL;
+    char part[256];
+    int len = 0;
+
+    if (conn->range_num <= 1)
+    {
+        return 0;
+    }
+
+    conn->range_idx++;
+    if (conn->range_idx >= conn->range_num)
+    {
+        httpd_conn_send(conn, "\r\n--" HTTPD_RANGE_BOUNDARY "--\r\n",
+                        strlen("\r\n--" HTTPD_RANGE_BOUNDARY "--\r\n"));
+        conn->range_num = 0;
+        return 0;
+    }
+
+    range = &conn->ranges[conn->range_idx];
+    len = httpd_range_part_header(range, conn->http_data.file_stat.st_size, conn->content_type,
+                                  part, sizeof(part));
+    httpd_conn_send(conn, part, len);
+    conn->file_offset = range->first;
+    conn->file_left = range->last - range->first + 1;
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_response_range_error
+ * 功  能:    请求的区间都超出文件范围时回复416
+ * 输  入:    conn: 客户端连接
+ *            st:   文件属性
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计回复状态码
+ ****************************************************************************/
+static void httpd_response_range_error(httpd_conn_t *conn, const struct stat *st)
+{
+    char buf[1024];
+    int len = 0;
+
+    len = httpd_response_header_format(buf, sizeof(buf), "416 Range Not Satisfiable", "text/html", 0,
+                                       NULL, NULL);
+    len += snprintf(buf + len, sizeof(buf) - len,
+                    "Content-Range: bytes */%lld\r\n"
+                    "Connection: %s\r\n\r\n",
+                    (long long)st->st_size, conn->keep_alive ? "keep-alive" : "close");
+    httpd_conn_send(conn, buf, len);
+    httpd_stats_status(conn, 416);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_accept_encoding_parse
+ * 功  能:    解析Accept-Encoding请求头，q=0的编码视为不接受
+ * 输  入:    value: Accept-Encoding请求头的值
+ * 输  出:    无
+ * 返回值:    客户端接受的编码(HTTPD_ENC_*位掩码)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_accept_encoding_parse(const httpd_str_t *value)
+{
+    const char *p = value->data;
+    const char *end = value->data + value->len;
+    const char *name = NULL;
+    size_t name_len = 0;
+    int mask = 0;
+    int accept = 0;
+
+    while (p < end)
+    {
+        while ((p < end) && ((' ' == *p) || ('\t' == *p) || (',' == *p)))
+        {
+            p++;
+        }
+
+        name = p;
+        while ((p < end) && (',' != *p) && (';' != *p) && (' ' != *p) && ('\t' != *p))
+        {
+            p++;
+        }
+        name_len = p - name;
+
+        /* q=0表示明确拒绝该编码 */
+        accept = 1;
+        while ((p < end) && (',' != *p))
+        {
+            if (('q' == *p) && (p + 1 < end) && ('=' == p[1]))
+            {
+                accept = 0;
+                for (p += 2; (p < end) && (',' != *p); p++)
+                {
+                    if (('1' <= *p) && ('9' >= *p))
+                    {
+                        accept = 1;
+                    }
+                }
+                break;
+            }
+            p++;
+        }
+
+        if (!accept || (0 == name_len))
+        {
+            continue;
+        }
+        if ((4 == name_len) && (0 == strncasecmp(name, "gzip", 4)))
+        {
+            mask |= HTTPD_ENC_GZIP;
+        }
+        else if ((2 == name_len) && (0 == strncasecmp(name, "br", 2)))
+        {
+            mask |= HTTPD_ENC_BR;
+        }
+        else if ((1 == name_len) && ('*' == *name))
+        {
+            mask |= HTTPD_ENC_GZIP | HTTPD_ENC_BR;
+        }
+    }
+
+    return mask;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_connection_parse
+ * 功  能:    解析Connection请求头: 值为逗号分隔的选项列表(如"close, TE")，
+ *            逐个选项不区分大小写比较，有close时以close为准
+ * 输  入:    value: Connection请求头的值
+ * 输  出:    无
+ * 返回值:    0: 未指定  1: keep-alive  2: close
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_connection_parse(const httpd_str_t *value)
+{
+    const char *p = value->data;
+    const char *end = value->data + value->len;
+    const char *name = NULL;
+    size_t name_len = 0;
+    int connection = 0;
+
+    while (p < end)
+    {
+        while ((p < end) && ((' ' == *p) || ('\t' == *p) || (',' == *p)))
+        {
+            p++;
+        }
+
+        name = p;
+        while ((p < end) && (',' != *p))
+        {
+            p++;
+        }
+
+        /* 去掉选项末尾的空白 */
+        for (name_len = p - name; (name_len > 0) && ((' ' == name[name_len - 1]) || ('\t' == name[name_len - 1]));
+             name_len--)
+        {
+        }
+
+        if ((5 == name_len) && (0 == strncasecmp(name, "close", 5)))
+        {
+            return 2;
+        }
+        if ((10 == name_len) && (0 == strncasecmp(name, "keep-alive", 10)))
+        {
+            connection = 1;
+        }
+    }
+
+    return connection;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_file_compressible
+ * 功  能:    根据扩展名判断静态文件是否为适合压缩的文本
+ * 输  入:    path: 文件路径
+ * 输  出:    无
+ * 返回值:    1: 适合压缩  0: 不适合
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 改为查MIME类型表
+ ****************************************************************************/
+static int httpd_file_compressible(const char *path)
+{
+    const httpd_mime_t *mime = httpd_mime_lookup(path);
+
+    return (NULL != mime) && mime->compress;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_encoding_select
+ * 功  能:    选择静态文件的内容编码: 优先使用不早于原文件的.br、.gz预压缩文件，
+ *            否则对适合压缩的小文件压缩一次并缓存gzip内容。Range请求不编码
+ * 输  入:    conn: 客户端连接
+ *            path: 静态文件路径
+ *            size: sidecar缓冲区大小
+ * 输  出:    sidecar: 预压缩文件路径，没有时为空字符串
+ *            st:      预压缩文件属性
+ * 返回值:    内容编码HTTPD_ENC_*
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_encoding_select(httpd_conn_t *conn, const char *path, char *sidecar,
+                                 size_t size, struct stat *st)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    static const struct
+    {
+        int encoding;
+        const char *suffix;
+    } sidecars[] = {{HTTPD_ENC_BR, ".br"}, {HTTPD_ENC_GZIP, ".gz"}};
+    int i = 0;
+
+    sidecar[0] = '\0';
+
+    if ((0 == h_data->accept_encoding) || (NULL != httpd_request_header(h_data, HTTPD_HDR_RANGE)))
+    {
+        return HTTPD_ENC_IDENTITY;
+    }
+
+    for (i = 0; i < (int)(sizeof(sidecars) / sizeof(sidecars[0])); i++)
+    {
+        if (!(h_data->accept_encoding & sidecars[i].encoding) ||
+            (snprintf(sidecar, size, "%s%s", path, sidecars[i].suffix) >= (int)size))
+        {
+            continue;
+        }
+
+        /* 预压缩文件比原文件旧时说明未重新生成，不使用 */
+        if ((0 == stat(sidecar, st)) && S_ISREG(st->st_mode) &&
+            (st->st_mtime >= h_data->file_stat.st_mtime))
+        {
+            /* 存在预压缩文件的资源同样需要Vary */
+            if (NULL == conn->encoding)
+            {
+                conn->encoding = "";
+            }
+            return sidecars[i].encoding;
+        }
+    }
+    sidecar[0] = '\0';
+
+    /* 压缩后的内容只保存在缓存中，不能缓存的文件不压缩 */
+    if ((h_data->accept_encoding & HTTPD_ENC_GZIP) && (NULL != conn->encoding) &&
+        (h_data->file_stat.st_size >= HTTPD_GZIP_MIN_SIZE) &&
+        ((size_t)h_data->file_stat.st_size <= g_httpd_cache.budget / 8))
+    {
+        return HTTPD_ENC_GZIP;
+    }
+
+    return HTTPD_ENC_IDENTITY;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_gzip
+ * 功  能:    将数据压缩为gzip格式(只在加入缓存时压缩一次，使用最高压缩级别)
+ * 输  入:    in:      原始数据
+ *            in_len:  原始数据长度
+ * 输  出:    out:     压缩后的数据(malloc分配，由调用者释放)
+ *            out_len: 压缩后的数据长度
+ * 返回值:    0: 成功  -1: 失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_gzip(const char *in, size_t in_len, char **out, size_t *out_len)
+{
+    z_stream zs;
+    size_t bound = 0;
+
+    memset(&zs, 0x00, sizeof(zs));
+    /* windowBits加16生成gzip头和尾 */
+    if (Z_OK != deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY))
+    {
+        return -1;
+    }
+
+    bound = deflateBound(&zs, in_len);
+    *out = (char *)malloc(bound);
+    if (NULL == *out)
+    {
+        deflateEnd(&zs);
+        return -1;
+    }
+
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = in_len;
+    zs.next_out = (Bytef *)*out;
+    zs.avail_out = bound;
+    if (Z_STREAM_END != deflate(&zs, Z_FINISH))
+    {
+        deflateEnd(&zs);
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+
+    *out_len = zs.total_out;
+    deflateEnd(&zs);
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cache_init
+ * 功  能:    初始化静态文件缓存
+ * 输  入:    budget: 缓存容量(字节)，0表示不缓存
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_cache_init(size_t budget)
+{
+    memset(&g_httpd_cache, 0x00, sizeof(g_httpd_cache));
+    pthread_mutex_init(&g_httpd_cache.lock, NULL);
+    g_httpd_cache.budget = budget;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cache_hash
+ * 功  能:    计算文件路径的哈希值(FNV-1a)
+ * 输  入:    path: 文件路径
+ * 输  出:    无
+ * 返回值:    哈希值
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static unsigned int httpd_cache_hash(const char *path)
+{
+    unsigned int hash = 2166136261u;
+
+    while ('\0' != *path)
+    {
+        hash ^= (unsigned char)*path++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cache_lookup
+ * 功  能:    查找静态文件缓存。文件的设备号、inode、大小或修改时间与缓存时
+ *            不一致说明文件已被修改，缓存项作废
+ * 输  入:    path:     文件路径
+ *            st:       文件当前属性
+ *            encoding: 内容编码HTTPD_ENC_*
+ * 输  出:    无
+ * 返回值:    命中的缓存项(已增加引用，用完需httpd_cache_release)  NULL: 未命中
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 同一文件的不同编码分别缓存
+ ****************************************************************************/
+static httpd_cache_entry_t *httpd_cache_lookup(const char *path, const struct stat *st, int encoding)
+{
+    httpd_cache_entry_t *entry = NULL;
+    unsigned int hash = 0;
+
+    if (0 == g_httpd_cache.budget)
+    {
+        return NULL;
+    }
+
+    hash = httpd_cache_hash(path);
+
+    pthread_mutex_lock(&g_httpd_cache.lock);
+
+    for (entry = g_httpd_cache.buckets[hash % HTTPD_CACHE_BUCKETS]; NULL != entry; entry = entry->hash_next)
+    {
+        if ((entry->hash == hash) && (entry->encoding == encoding) && (0 == strcmp(entry->path, path)))
+        {
+            break;
+        }
+    }
+
+    if (NULL != entry)
+    {
+        if ((entry->dev != st->st_dev) || (entry->ino != st->st_ino) ||
+            (entry->size != st->st_size) ||
+            (entry->mtime.tv_sec != st->st_mtim.tv_sec) ||
+            (entry->mtime.tv_nsec != st->st_mtim.tv_nsec))
+        {
+            /* 文件已修改 */
+            httpd_cache_unlink(entry);
+            entry = NULL;
+        }
+        else
+        {
+            /* 移到LRU链表头 */
+            if (g_httpd_cache.lru_head != entry)
+            {
+                entry->lru_prev->lru_next = entry->lru_next;
+                if (NULL != entry->lru_next)
+                {
+                    entry->lru_next->lru_prev = entry->lru_prev;
+                }
+                else
+                {
+                    g_httpd_cache.lru_tail = entry->lru_prev;
+                }
+
+                entry->lru_prev = NULL;
+                entry->lru_next = g_httpd_cache.lru_head;
+                g_httpd_cache.lru_head->lru_prev = entry;
+                g_httpd_cache.lru_head = entry;
+            }
+
+            atomic_fetch_add(&entry->refs, 1);
+        }
+    }
+
+    pthread_mutex_unlock(&g_httpd_cache.lock);
+
+    return entry;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cache_load
+ * 功  能:    读取静态文件并生成回复报文头，加入缓存。超过容量时淘汰最久未使用
+ *            的缓存项；单个文件超过容量的1/8时不缓存
+ * 输  入:    path:     文件路径
+ *            st:       文件属性
+ *            content_type: 原始文件的MIME类型
+ *            encoding: 内容编码HTTPD_ENC_*，缓存键的一部分
+ *            compress: 是否将文件内容压缩为gzip后缓存
+ * 输  出:    无
+ * 返回值:    缓存项(已增加引用，用完需httpd_cache_release)  NULL: 不缓存或失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 支持缓存预压缩文件及压缩后的内容
+ ****************************************************************************/
+static httpd_cache_entry_t *httpd_cache_load(const char *path, const struct stat *st,
+                                             const char *content_type, int encoding, int compress)
+{
+    static const char *encodings[] = {"", "gzip", "br"};
+    httpd_cache_entry_t *entry = NULL;
+    httpd_cache_entry_t *old = NULL;
+    char *gz = NULL;
+    size_t gz_len = 0;
+    size_t cost = 0;
+    ssize_t n = 0;
+    size_t done = 0;
+    int fd = -1;
+    unsigned int bucket = 0;
+
+    if ((0 == g_httpd_cache.budget) || !S_ISREG(st->st_mode) ||
+        ((size_t)st->st_size > g_httpd_cache.budget / 8) ||
+        (strlen(path) >= sizeof(entry->path)))
+    {
+        return NULL;
+    }
+
+    entry = (httpd_cache_entry_t *)calloc(1, sizeof(httpd_cache_entry_t));
+    if (NULL == entry)
+    {
+        return NULL;
+    }
+
+    entry->body = (char *)malloc((st->st_size > 0) ? st->st_size : 1);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if ((NULL == entry->body) || (fd < 0))
+    {
+        goto fail;
+    }
+
+    /* 读取整个文件 */
+    while (done < (size_t)st->st_size)
+    {
+        n = read(fd, entry->body + done, st->st_size - done);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            goto fail;
+        }
+        if (0 == n)
+        {
+            /* 文件在读取过程中被截短，不缓存 */
+            goto fail;
+        }
+        done += n;
+    }
+    close(fd);
+    fd = -1;
+
+    entry->body_len = st->st_size;
+    if (compress)
+    {
+        if (httpd_gzip(entry->body, entry->body_len, &gz, &gz_len) < 0)
+        {
+            goto fail;
+        }
+        free(entry->body);
+        entry->body = gz;
+        entry->body_len = gz_len;
+    }
+
+    strcpy(entry->path, path);
+    entry->encoding = encoding;
+    entry->hash = httpd_cache_hash(path);
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->size = st->st_size;
+    entry->mtime = st->st_mtim;
+    entry->header_len = httpd_response_header_format(entry->header, sizeof(entry->header),
+                                                     "200 OK", content_type, (long)entry->body_len, st,
+                                                     ((HTTPD_ENC_IDENTITY != encoding) || httpd_file_compressible(path)) ?
+                                                     encodings[encoding] : NULL);
+    atomic_init(&entry->refs, 2); /* 缓存本身和调用者各持有一个引用 */
+    cost = sizeof(httpd_cache_entry_t) + entry->body_len;
+    bucket = entry->hash % HTTPD_CACHE_BUCKETS;
+
+    pthread_mutex_lock(&g_httpd_cache.lock);
+
+    /* 其他线程可能已加入同一文件 */
+    for (old = g_httpd_cache.buckets[bucket]; NULL != old; old = old->hash_next)
+    {
+        if ((old->hash == entry->hash) && (old->encoding == encoding) && (0 == strcmp(old->path, path)))
+        {
+            httpd_cache_unlink(old);
+            break;
+        }
+    }
+
+    /* 淘汰最久未使用的缓存项直到容量足够 */
+    while ((NULL != g_httpd_cache.lru_tail) && (g_httpd_cache.used + cost > g_httpd_cache.budget))
+    {
+        httpd_cache_unlink(g_httpd_cache.lru_tail);
+    }
+
+    entry->hash_next = g_httpd_cache.buckets[bucket];
+    g_httpd_cache.buckets[bucket] = entry;
+
+    entry->lru_prev = NULL;
+    entry->lru_next = g_httpd_cache.lru_head;
+    if (NULL != g_httpd_cache.lru_head)
+    {
+        g_httpd_cache.lru_head->lru_prev = entry;
+    }
+    else
+    {
+        g_httpd_cache.lru_tail = entry;
+    }
+    g_httpd_cache.lru_head = entry;
+    g_httpd_cache.used += cost;
+
+    pthread_mutex_unlock(&g_httpd_cache.lock);
+
+    return entry;
+
+fail:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    free(entry->body);
+    free(entry);
+    return NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cache_unlink
+ * 功  能:    将缓存项移出哈希表和LRU链表并释放缓存持有的引用，正在发送该
+ *            缓存项的连接仍可继续使用，最后一个引用释放时才释放内存。
+ *            调用者需持有缓存锁
+ * 输  入:    entry: 缓存项
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_cache_unlink(httpd_cache_entry_t *entry)
+{
+    httpd_cache_entry_t **pp = NULL;
+
+    pp = &g_httpd_cache.buckets[entry->hash % HTTPD_CACHE_BUCKETS];
+    while (*pp != entry)
+    {
+        pp = &(*pp)->hash_next;
+    }
+    *pp = entry->hash_next;
+
+    if (NULL != entry->lru_prev)
+    {
+        entry->lru_prev->lru_next = entry->lru_next;
+    }
+    else
+    {
+        g_httpd_cache.lru_head = entry->lru_next;
+    }
+
+    if (NULL != entry->lru_next)
+    {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+    else
+    {
+        g_httpd_cache.lru_tail = entry->lru_prev;
+    }
+
+    g_httpd_cache.used -= sizeof(httpd_cache_entry_t) + entry->body_len;
+    httpd_cache_release(entry);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cache_release
+ * 功  能:    释放缓存项引用，引用计数为0时释放内存
+ * 输  入:    entry: 缓存项
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_cache_release(httpd_cache_entry_t *entry)
+{
+    if (1 == atomic_fetch_sub(&entry->refs, 1))
+    {
+        free(entry->body);
+        free(entry);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_execute_cgi
+ * 功  能:    执行CGI程序处理HTTP请求
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 管道改为非阻塞并加入epoll，数据转发由
+ *            httpd_cgi_transfer完成；改用posix_spawn启动CGI程序并传入完整的
+ *            CGI/1.1环境变量
+ *            2026-10-16 changzehai(DTT) 统计回复状态码
+ *            2026-10-16 changzehai(DTT) CGI程序单独成为进程组
+ *            2026-10-16 changzehai(DTT) 回复头改由CGI报文头生成
+ *            2026-10-16 changzehai(DTT) 请求体转发改由httpd_cgi_start设置
+ ****************************************************************************/
+static void httpd_execute_cgi(httpd_conn_t *conn)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigdefault;
+    struct epoll_event ev;
+    char env_buf[HTTPD_CGI_ENV_SIZE];
+    char *envp[HTTPD_CGI_ENV_MAX + 1];
+    char *argv[2];
+    pid_t pid;
+    int cgi_output[2]; 
+    int cgi_input[2];
+    int ret = 0;
+
+
+    /* 创建父进程读子进程写的管道 */
+    if (pipe2(cgi_output, O_CLOEXEC) < 0) {
+        httpd_request_cannot_execute_error(conn);
+        return;
+     }
+
+    /* 创建子进程写父进程读的管道 */
+    if (pipe2(cgi_input, O_CLOEXEC) < 0) {
+        close(cgi_output[0]);
+        close(cgi_output[1]);
+        httpd_request_cannot_execute_error(conn);
+        return;
+    }
+
+    /* CGI标准需要将请求信息存储在环境变量中，然后和cgi脚本进行交互 */
+    httpd_cgi_env(conn, env_buf, sizeof(env_buf), envp, HTTPD_CGI_ENV_MAX);
+    argv[0] = h_data->req_line_data.path;
+    argv[1] = NULL;
+
+    /* 子进程标准输入输出重定向到管道(dup2会清除O_CLOEXEC)，恢复SIGPIPE的
+       默认处理。posix_spawn以vfork方式创建子进程，不复制服务器的页表，
+       启动开销与服务器内存大小无关。子进程单独成为进程组，执行超时时
+       可以连同其派生的进程一起结束 */
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, cgi_output[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, cgi_input[0], 0);
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    ret = posix_spawn(&pid, h_data->req_line_data.path, &actions, &attr, argv, envp);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (0 != ret) {
+        close(cgi_output[0]);
+        close(cgi_output[1]);
+        close(cgi_input[0]);
+        close(cgi_input[1]);
+        httpd_request_cannot_execute_error(conn);
+        return;
+    }
+
+    /* 父进程: 关闭了cgi_output中的写通道和cgi_input中的读通道 */
+    close(cgi_output[1]);
+    close(cgi_input[0]);
+
+    conn->cgi_pid = pid;
+    conn->cgi_out_ev.fd = cgi_output[0];
+    conn->cgi_in_ev.fd = cgi_input[1];
+    httpd_set_nonblocking(cgi_output[0]);
+    httpd_set_nonblocking(cgi_input[1]);
+
+    /* 加大管道容量，减少大请求体/大输出时的唤醒次数(失败时保持默认容量) */
+    fcntl(cgi_output[0], F_SETPIPE_SZ, HTTPD_CGI_PIPE_SIZE);
+    fcntl(cgi_input[1], F_SETPIPE_SZ, HTTPD_CGI_PIPE_SIZE);
+
+    /* 管道加入epoll，由CGI程序的读写事件驱动数据转发 */
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &conn->cgi_out_ev;
+    epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_ADD, cgi_output[0], &ev);
+    ev.events = EPOLLOUT | EPOLLET;
+    ev.data.ptr = &conn->cgi_in_ev;
+    epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_ADD, cgi_input[1], &ev);
+
+    /* 回复头由httpd_cgi_output根据CGI程序输出的报文头生成 */
+    conn->state = HTTPD_CONN_CGI;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_start
+ * 功  能:    启动CGI程序: 配置了FastCGI常驻进程的脚本交给FastCGI程序处理，
+ *            进程都忙时退回到每个请求启动一个CGI进程
+ * 输  入:    conn: 客户端连接(已占用CGI执行名额)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计各阶段耗时
+ *            2026-10-16 changzehai(DTT) 记录CGI程序执行截止时间
+ *            2026-10-16 changzehai(DTT) 分配CGI输出缓冲区，HTTP/1.1请求保持连接
+ *            2026-10-16 changzehai(DTT) 设置请求体转发，处理Expect: 100-continue
+ ****************************************************************************/
+static void httpd_cgi_start(httpd_conn_t *conn)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    httpd_fcgi_app_t *app = NULL;
+
+    conn->state = HTTPD_CONN_RESPONSE;
+    conn->response_start = 0;
+    conn->cgi_start = httpd_monotonic_ns();
+    conn->cgi_deadline = conn->reactor->now + g_httpd_config.cgi_timeout;
+
+    conn->cgi_out = (httpd_cgi_out_t *)httpd_arena_alloc(&conn->arena, sizeof(httpd_cgi_out_t));
+    if (NULL == conn->cgi_out)
+    {
+        httpd_request_cannot_execute_error(conn);
+        httpd_cgi_release(conn);
+        return;
+    }
+    memset(conn->cgi_out, 0x00, offsetof(httpd_cgi_out_t, buf));
+
+    /* HTTP/1.1回复按chunked编码发送，请求体全部转发给CGI程序，可以保持连接；
+       HTTP/1.0回复只能以关闭连接表示结束 */
+    conn->cgi_out->chunked = (11 == conn->http_data.req_line_data.http_version);
+    conn->keep_alive = conn->cgi_out->chunked && (2 != conn->http_data.connection) &&
+                       (conn->requests < g_httpd_config.keepalive_max);
+
+    /* 保持连接时回复的最后一段很小，关闭Nagle算法，避免与客户端的延迟确认
+       叠加造成约40ms的等待 */
+    if (conn->keep_alive && !conn->nodelay)
+    {
+        conn->nodelay = 1;
+        setsockopt(conn->ev.fd, IPPROTO_TCP, TCP_NODELAY, &conn->nodelay, sizeof(conn->nodelay));
+    }
+
+    /* 请求体(不论请求方法)全部转发给CGI程序，chunked编码的请求体边接收边解码 */
+    conn->body_left = (h_data->content_length > 0) ? h_data->content_length : 0;
+    conn->body_size = conn->body_left;
+    conn->body_chunked = h_data->chunked;
+    conn->chunk_state = HTTPD_CHUNK_LENGTH;
+
+    app = httpd_fcgi_lookup(h_data->req_line_data.path);
+    if ((NULL == app) || (0 != httpd_fcgi_execute(conn, app)))
+    {
+        /* 执行CGI程序处理HTTP请求，并将处理结果发送回客户端 */
+        httpd_execute_cgi(conn);
+    }
+    httpd_stats_record(conn->reactor, HTTPD_STAGE_CGI_SPAWN, httpd_monotonic_ns() - conn->cgi_start);
+
+    /* 启动失败，已回复500 */
+    if (HTTPD_CONN_CGI != conn->state)
+    {
+        httpd_cgi_release(conn);
+        return;
+    }
+
+    /* 客户端等待100 Continue后才发送请求体；CGI程序已启动，请求体可以边接收
+       边转发。已收到部分请求体时不再需要 */
+    if (h_data->expect_continue && (11 == h_data->req_line_data.http_version) &&
+        ((conn->body_left > 0) || conn->body_chunked) && (conn->rpos == conn->rlen))
+    {
+        httpd_conn_send(conn, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_acquire
+ * 功  能:    申请CGI执行名额: 全局及该脚本的运行数都未达上限时直接占用，否则
+ *            进入等待队列，等待队列已满时拒绝
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 已占用名额  0: 进入等待队列  -1: 拒绝(回复503)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 等待超时改由连接定时器处理
+ ****************************************************************************/
+static int httpd_cgi_acquire(httpd_conn_t *conn)
+{
+    httpd_cgi_limit_t *limit = &g_httpd_cgi_limit;
+    httpd_cgi_script_t *script = NULL;
+    const char *path = conn->http_data.req_line_data.path;
+    unsigned int bucket = httpd_cache_hash(path) % HTTPD_CGI_BUCKETS;
+    int ret = 0;
+
+    pthread_mutex_lock(&limit->lock);
+
+    /* 脚本运行计数在首次请求时创建，之后不释放 */
+    for (script = limit->scripts[bucket]; NULL != script; script = script->next)
+    {
+        if (0 == strcmp(script->path, path))
+        {
+            break;
+        }
+    }
+    if (NULL == script)
+    {
+        script = (httpd_cgi_script_t *)calloc(1, sizeof(httpd_cgi_script_t));
+        if (NULL == script)
+        {
+            pthread_mutex_unlock(&limit->lock);
+            return -1;
+        }
+        snprintf(script->path, sizeof(script->path), "%s", path);
+        script->next = limit->scripts[bucket];
+        limit->scripts[bucket] = script;
+    }
+    conn->cgi_script = script;
+
+    if (((0 == g_httpd_config.cgi_max) || (limit->running < g_httpd_config.cgi_max)) &&
+        ((0 == g_httpd_config.cgi_script_max) || (script->running < g_httpd_config.cgi_script_max)))
+    {
+        limit->running++;
+        script->running++;
+        conn->cgi_slot = 1;
+        ret = 1;
+    }
+    else if (limit->waiting < g_httpd_config.cgi_wait_max)
+    {
+        conn->cgi_wait = 1;
+        conn->cgi_wait_next = NULL;
+        conn->cgi_wait_prev = limit->wait_tail;
+        if (NULL != limit->wait_tail)
+        {
+            limit->wait_tail->cgi_wait_next = conn;
+        }
+        else
+        {
+            limit->wait_head = conn;
+        }
+        limit->wait_tail = conn;
+        limit->waiting++;
+        ret = 0;
+    }
+    else
+    {
+        ret = -1;
+    }
+
+    pthread_mutex_unlock(&limit->lock);
+
+    return ret;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_release
+ * 功  能:    CGI程序结束后释放执行名额，并分配给等待队列中的请求
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_cgi_release(httpd_conn_t *conn)
+{
+    if (!conn->cgi_slot)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&g_httpd_cgi_limit.lock);
+    g_httpd_cgi_limit.running--;
+    conn->cgi_script->running--;
+    conn->cgi_slot = 0;
+    httpd_cgi_grant();
+    pthread_mutex_unlock(&g_httpd_cgi_limit.lock);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_grant
+ * 功  能:    按到达顺序将空出的名额分配给等待队列中的请求(所在脚本已达上限的
+ *            跳过)，放入其所属工作线程的待启动链表并唤醒该线程。
+ *            调用者需持有CGI限流锁
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 待启动链表头改为原子变量
+ ****************************************************************************/
+static void httpd_cgi_grant(void)
+{
+    httpd_cgi_limit_t *limit = &g_httpd_cgi_limit;
+    httpd_conn_t *conn = NULL;
+    httpd_conn_t *next = NULL;
+    uint64_t one = 1;
+
+    for (conn = limit->wait_head;
+         (NULL != conn) && ((0 == g_httpd_config.cgi_max) || (limit->running < g_httpd_config.cgi_max));
+         conn = next)
+    {
+        next = conn->cgi_wait_next;
+        if ((0 != g_httpd_config.cgi_script_max) &&
+            (conn->cgi_script->running >= g_httpd_config.cgi_script_max))
+        {
+            continue;
+        }
+
+        /* 移出等待队列 */
+        if (NULL != conn->cgi_wait_prev)
+        {
+            conn->cgi_wait_prev->cgi_wait_next = conn->cgi_wait_next;
+        }
+        else
+        {
+            limit->wait_head = conn->cgi_wait_next;
+        }
+        if (NULL != conn->cgi_wait_next)
+        {
+            conn->cgi_wait_next->cgi_wait_prev = conn->cgi_wait_prev;
+        }
+        else
+        {
+            limit->wait_tail = conn->cgi_wait_prev;
+        }
+        limit->waiting--;
+
+        limit->running++;
+        conn->cgi_script->running++;
+        conn->cgi_slot = 1;
+        conn->cgi_wait = 2;
+
+        /* 连接只能由所属工作线程处理 */
+        conn->cgi_wait_prev = NULL;
+        conn->cgi_wait_next = atomic_load_explicit(&conn->reactor->cgi_ready, memory_order_relaxed);
+        if (NULL != conn->cgi_wait_next)
+        {
+            conn->cgi_wait_next->cgi_wait_prev = conn;
+        }
+        atomic_store_explicit(&conn->reactor->cgi_ready, conn, memory_order_relaxed);
+        if (write(conn->reactor->notify_ev.fd, &one, sizeof(one)) < 0)
+        {
+            /* eventfd计数已很大，线程必然会被唤醒 */
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_wait_cancel
+ * 功  能:    等待中的连接关闭时移出等待队列或待启动链表，已分配的名额归还
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 待启动链表头改为原子变量
+ ****************************************************************************/
+static void httpd_cgi_wait_cancel(httpd_conn_t *conn)
+{
+    httpd_cgi_limit_t *limit = &g_httpd_cgi_limit;
+
+    if (0 == conn->cgi_wait)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&limit->lock);
+
+    if (NULL != conn->cgi_wait_next)
+    {
+        conn->cgi_wait_next->cgi_wait_prev = conn->cgi_wait_prev;
+    }
+    if (1 == conn->cgi_wait)
+    {
+        if (NULL != conn->cgi_wait_prev)
+        {
+            conn->cgi_wait_prev->cgi_wait_next = conn->cgi_wait_next;
+        }
+        else
+        {
+            limit->wait_head = conn->cgi_wait_next;
+        }
+        if (NULL == conn->cgi_wait_next)
+        {
+            limit->wait_tail = conn->cgi_wait_prev;
+        }
+        limit->waiting--;
+    }
+    else
+    {
+        if (NULL != conn->cgi_wait_prev)
+        {
+            conn->cgi_wait_prev->cgi_wait_next = conn->cgi_wait_next;
+        }
+        else
+        {
+            atomic_store_explicit(&conn->reactor->cgi_ready, conn->cgi_wait_next, memory_order_relaxed);
+        }
+    }
+    conn->cgi_wait = 0;
+
+    pthread_mutex_unlock(&limit->lock);
+
+    httpd_cgi_release(conn);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_reactor_cgi_ready
+ * 功  能:    启动本线程中已分配到CGI执行名额的等待请求
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 不加锁检查待启动链表改为原子读取
+ ****************************************************************************/
+static void httpd_reactor_cgi_ready(httpd_reactor_t *reactor)
+{
+    httpd_conn_t *conn = NULL;
+    httpd_conn_t *next = NULL;
+
+    /* 不加锁的检查只用于跳过空链表，链表本身在锁内读取；漏掉的新连接会由
+       eventfd通知再次唤醒 */
+    if (NULL == atomic_load_explicit(&reactor->cgi_ready, memory_order_relaxed))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&g_httpd_cgi_limit.lock);
+    conn = atomic_load_explicit(&reactor->cgi_ready, memory_order_relaxed);
+    atomic_store_explicit(&reactor->cgi_ready, NULL, memory_order_relaxed);
+    for (next = conn; NULL != next; next = next->cgi_wait_next)
+    {
+        next->cgi_wait = 0;
+    }
+    pthread_mutex_unlock(&g_httpd_cgi_limit.lock);
+
+    for (; NULL != conn; conn = next)
+    {
+        next = conn->cgi_wait_next;
+        conn->cgi_wait_prev = NULL;
+        conn->cgi_wait_next = NULL;
+
+        httpd_cgi_start(conn);
+        httpd_conn_process(conn);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_env
+ * 功  能:    生成CGI/1.1环境变量("NAME=value"形式)，CGI和FastCGI共用
+ * 输  入:    conn: 客户端连接
+ *            size: 缓冲区大小
+ *            max:  环境变量最大个数
+ * 输  出:    buf:  环境变量字符串
+ *            envp: 指向buf中各环境变量的指针数组，以NULL结尾(需max+1个元素)
+ * 返回值:    环境变量个数
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 从请求头视图读取Host和Content-Type
+ *            2026-10-16 changzehai(DTT) CONTENT_LENGTH支持超过2GB的请求体
+ ****************************************************************************/
+static int httpd_cgi_env(httpd_conn_t *conn, char *buf, size_t size, char **envp, int max)
+{
+    http_request_data_t *h_data = &conn->http_data;
+    const char *host = httpd_request_header(h_data, HTTPD_HDR_HOST);
+    const char *content_type = httpd_request_header(h_data, HTTPD_HDR_CONTENT_TYPE);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    char remote_addr[INET_ADDRSTRLEN] = "";
+    char server_name[128];
+    const char *path = getenv("PATH");
+    const char *vars[HTTPD_CGI_ENV_MAX][2];
+    size_t used = 0;
+    int num = 0;
+    int len = 0;
+    int cnt = 0;
+    int i = 0;
+    char remote_port[8] = "";
+    char server_port[8];
+    char content_length[24];
+
+    if (0 == getpeername(conn->ev.fd, (struct sockaddr *)&addr, &addr_len))
+    {
+        inet_ntop(AF_INET, &addr.sin_addr, remote_addr, sizeof(remote_addr));
+        snprintf(remote_port, sizeof(remote_port), "%d", ntohs(addr.sin_port));
+    }
+
+    /* SERVER_NAME取Host请求头中的主机名 */
+    snprintf(server_name, sizeof(server_name), "%s", ((NULL != host) && ('\0' != host[0])) ? host : "localhost");
+    if ((NULL != strchr(server_name, ':')) && ('[' != server_name[0]))
+    {
+        *strchr(server_name, ':') = '\0';
+    }
+    snprintf(server_port, sizeof(server_port), "%d", g_httpd_config.port);
+    snprintf(content_length, sizeof(content_length), "%lld",
+             (h_data->content_length > 0) ? h_data->content_length : 0);
+
+    vars[cnt][0] = "GATEWAY_INTERFACE"; vars[cnt++][1] = "CGI/1.1";
+    vars[cnt][0] = "SERVER_SOFTWARE";   vars[cnt++][1] = "httpd/1.0.0";
+    vars[cnt][0] = "SERVER_NAME";       vars[cnt++][1] = server_name;
+    vars[cnt][0] = "SERVER_PORT";       vars[cnt++][1] = server_port;
+    vars[cnt][0] = "SERVER_PROTOCOL";
+    vars[cnt++][1] = (11 == h_data->req_line_data.http_version) ? "HTTP/1.1" : "HTTP/1.0";
+    vars[cnt][0] = "REQUEST_METHOD";    vars[cnt++][1] = h_data->req_line_data.method;
+    vars[cnt][0] = "SCRIPT_NAME";       vars[cnt++][1] = h_data->req_line_data.path + strlen(HTTPD_DOC_ROOT);
+    vars[cnt][0] = "SCRIPT_FILENAME";   vars[cnt++][1] = h_data->req_line_data.path;
+    vars[cnt][0] = "QUERY_STRING";      vars[cnt++][1] = h_data->req_line_data.query_string;
+    vars[cnt][0] = "REMOTE_ADDR";       vars[cnt++][1] = remote_addr;
+    vars[cnt][0] = "REMOTE_PORT";       vars[cnt++][1] = remote_port;
+    vars[cnt][0] = "PATH";              vars[cnt++][1] = (NULL != path) ? path : "/usr/local/bin:/usr/bin:/bin";
+    if (h_data->content_length >= 0)
+    {
+        vars[cnt][0] = "CONTENT_LENGTH"; vars[cnt++][1] = content_length;
+    }
+    if (NULL != content_type)
+    {
+        vars[cnt][0] = "CONTENT_TYPE";   vars[cnt++][1] = content_type;
+    }
+    if (NULL != host)
+    {
+        vars[cnt][0] = "HTTP_HOST";      vars[cnt++][1] = host;
+    }
+
+    for (i = 0; (i < cnt) && (num < max); i++)
+    {
+        len = snprintf(buf + used, size - used, "%s=%s", vars[i][0], vars[i][1]);
+        if ((len < 0) || ((size_t)len >= size - used))
+        {
+            break;
+        }
+        envp[num++] = buf + used;
+        used += len + 1;
+    }
+    envp[num] = NULL;
+
+    return num;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_chunk_parse
+ * 功  能:    解析接收缓冲区中chunked编码请求体的chunk长度行、chunk内容之后的
+ *            CRLF及trailer，chunk内容留在接收缓冲区(或socket)中由调用者转发
+ * 输  入:    conn: 客户端连接
+ * 输  出:    conn->body_left: 新chunk的长度
+ *            conn->body_chunked: 请求体结束时清0
+ * 返回值:    1: 已取得新chunk或请求体结束  0: 数据未到齐  -1: 格式错误
+ *            -2: 请求体超过长度上限
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_request_chunk_parse(httpd_conn_t *conn)
+{
+    char *line = NULL;
+    char *nl = NULL;
+    char *p = NULL;
+    long long size = 0;
+    int digit = 0;
+    int len = 0;
+
+    while (conn->rpos < conn->rlen)
+    {
+        line = conn->rbuf + conn->rpos;
+        nl = (char *)memchr(line, '\n', conn->rlen - conn->rpos);
+        if (NULL == nl)
+        {
+            /* 一行占满接收缓冲区仍未结束 */
+            return ((0 == conn->rpos) && ((int)sizeof(conn->rbuf) == conn->rlen)) ? -1 : 0;
+        }
+        conn->rpos = nl + 1 - conn->rbuf;
+        len = nl - line;
+        if ((len > 0) && ('\r' == line[len - 1]))
+        {
+            len--;
+        }
+
+        switch (conn->chunk_state)
+        {
+            case HTTPD_CHUNK_LENGTH:
+                /* 十六进制长度之后的chunk扩展(;name=value)忽略 */
+                size = 0;
+                for (p = line; (p < line + len) && ((digit = httpd_hex_value(*p)) >= 0); p++)
+                {
+                    if (size > (LLONG_MAX >> 4))
+                    {
+                        return -1;
+                    }
+                    size = (size << 4) | digit;
+                }
+                if ((p == line) || ((p < line + len) && (';' != *p) && (' ' != *p) && ('\t' != *p)))
+                {
+                    return -1;
+                }
+                if ((g_httpd_config.body_max > 0) && (conn->body_size + size > g_httpd_config.body_max))
+                {
+                    return -2;
+                }
+                if (0 == size)
+                {
+                    conn->chunk_state = HTTPD_CHUNK_TRAILER;
+                    break;
+                }
+                conn->body_left = size;
+                conn->body_size += size;
+                conn->chunk_state = HTTPD_CHUNK_DATA_END;
+                return 1;
+
+            case HTTPD_CHUNK_DATA_END:
+                if (0 != len)
+                {
+                    return -1;
+                }
+                conn->chunk_state = HTTPD_CHUNK_LENGTH;
+                break;
+
+            default:
+                /* trailer不转发给CGI程序，空行表示请求体结束 */
+                if (0 == len)
+                {
+                    conn->body_chunked = 0;
+                    return 1;
+                }
+                break;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_body_next
+ * 功  能:    chunked编码的请求体: 当前chunk已转发完时从接收缓冲区及socket
+ *            解析下一个chunk。chunk格式错误或请求体超过长度上限时，CGI回复头
+ *            未发送则回复400或413并停止转发请求体
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 有进展  0: 等待数据  -1: 出错，需关闭连接
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_request_body_next(httpd_conn_t *conn)
+{
+    httpd_cgi_out_t *out = conn->cgi_out;
+    int ret = 0;
+    int n = 0;
+
+    do
+    {
+        ret = httpd_request_chunk_parse(conn);
+        if (0 != ret)
+        {
+            break;
+        }
+
+        /* 接收缓冲区已解析完时从头接收，未解析完的行由httpd_conn_fill保留 */
+        if (conn->rpos == conn->rlen)
+        {
+            conn->rpos = 0;
+            conn->rlen = 0;
+        }
+        n = httpd_conn_fill(conn);
+    } while (n > 0);
+
+    if ((ret < 0) && !out->header_done)
+    {
+        /* 丢弃CGI程序的输出，回复400或413后关闭连接 */
+        out->header_done = 1;
+        out->error = 1;
+        out->chunked = 0;
+        out->len = 0;
+        if (-2 == ret)
+        {
+            httpd_request_entity_too_large_error(conn);
+        }
+        else
+        {
+            httpd_request_bad_error(conn);
+        }
+        conn->body_chunked = 0;
+        conn->body_left = 0;
+        return 1;
+    }
+
+    if (0 == ret)
+    {
+        return (0 == n) ? 0 : -1;
+    }
+
+    return (ret > 0) ? 1 : -1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_transfer
+ * 功  能:    在CGI程序和客户端之间转发数据: 请求体 客户端->CGI标准输入,
+ *            处理结果 CGI标准输出->客户端。接收缓冲区以外的请求体和CGI输出
+ *            用splice在socket和管道之间直接转发，不经过用户态
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: CGI处理结果发送完毕  0: 等待读写事件  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 增加splice零拷贝转发
+ *            2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ *            2026-10-16 changzehai(DTT) CGI输出先解析报文头，报文体按chunked编码发送
+ *            2026-10-16 changzehai(DTT) 转发chunked编码的请求体
+ *            2026-10-16 changzehai(DTT) 没有报文体的回复不从管道直接发送
+ ****************************************************************************/
+static int httpd_cgi_transfer(httpd_conn_t *conn)
+{
+    httpd_cgi_out_t *out = conn->cgi_out;
+    int progress = 0;
+    int avail = 0;
+    int n = 0;
+
+    do
+    {
+        progress = 0;
+
+        /* chunked编码的请求体: 当前chunk已写完，解析下一个chunk，chunk内容
+           与Content-Length请求体一样转发 */
+        if (conn->body_chunked && (0 == conn->body_left))
+        {
+            n = httpd_request_body_next(conn);
+            if (n < 0)
+            {
+                return -1;
+            }
+            progress = n;
+        }
+
+        /* 接收缓冲区中的请求体已写完，剩余请求体从socket直接转入CGI标准输入 */
+        if ((conn->body_left > 0) && (conn->rpos == conn->rlen) &&
+            (conn->cgi_in_ev.fd >= 0) && !conn->cgi_nosplice)
+        {
+            n = splice(conn->ev.fd, NULL, conn->cgi_in_ev.fd, NULL,
+                       (conn->body_left < HTTPD_CGI_PIPE_SIZE) ? (size_t)conn->body_left : HTTPD_CGI_PIPE_SIZE,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+            {
+                conn->body_left -= n;
+                progress = 1;
+            }
+            else if (0 == n)
+            {
+                /* 请求体未发完客户端就关闭了连接 */
+                return -1;
+            }
+            else if (EINVAL == errno)
+            {
+                conn->cgi_nosplice = 1;
+            }
+            else if (EPIPE == errno)
+            {
+                /* CGI程序不再读取标准输入，剩余请求体从socket读出后丢弃 */
+                close(conn->cgi_in_ev.fd);
+                conn->cgi_in_ev.fd = -1;
+            }
+        }
+        /* 接收缓冲区中的请求体已写完，从客户端读取更多请求体 */
+        else if ((conn->body_left > 0) && (conn->rpos == conn->rlen))
+        {
+            conn->rpos = 0;
+            conn->rlen = 0;
+            n = httpd_conn_fill(conn);
+            if (n > 0)
+            {
+                progress = 1;
+            }
+            else if (n < 0)
+            {
+                return -1;
+            }
+        }
+
+        /* 将接收缓冲区中的请求体写入CGI程序标准输入 */
+        if ((conn->body_left > 0) && (conn->rpos < conn->rlen))
+        {
+            n = conn->rlen - conn->rpos;
+            if (n > conn->body_left)
+            {
+                n = (int)conn->body_left;
+            }
+
+            if (conn->cgi_in_ev.fd >= 0)
+            {
+                n = write(conn->cgi_in_ev.fd, conn->rbuf + conn->rpos, n);
+                if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                {
+                    /* CGI程序不再读取标准输入，丢弃剩余请求体 */
+                    close(conn->cgi_in_ev.fd);
+                    conn->cgi_in_ev.fd = -1;
+                }
+            }
+
+            if (n > 0)
+            {
+                conn->rpos += n;
+                conn->body_left -= n;
+                progress = 1;
+            }
+        }
+
+        /* 请求体全部写入后关闭标准输入，CGI程序读到EOF */
+        if ((conn->cgi_in_ev.fd >= 0) && (0 == conn->body_left) && !conn->body_chunked)
+        {
+            close(conn->cgi_in_ev.fd);
+            conn->cgi_in_ev.fd = -1;
+        }
+	
+        /* 报文头之后的输出: 不使用chunked编码时从管道直接发送到socket；管道中已
+           积累一个chunk以上的输出时，发送chunk头后从管道直接发送；其余情况(包括
+           要丢弃的输出)读入CGI输出缓冲区，攒成较大的chunk再发送 */
+        if (!conn->cgi_eof && !out->error && (0 == out->chunk_left) && (0 == out->end))
+        {
+            if (out->header_done && !out->chunked && !out->nobody && (0 == out->len) &&
+                (0 == conn->wlen) && !conn->cgi_nosplice)
+            {
+                n = splice(conn->cgi_out_ev.fd, NULL, conn->ev.fd, NULL, HTTPD_CGI_PIPE_SIZE,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (n > 0)
+                {
+                    httpd_conn_sent(conn, n);
+                    progress = 1;
+                }
+                else if (0 == n)
+                {
+                    conn->cgi_eof = 1;
+                    progress = 1;
+                }
+                else if (EINVAL == errno)
+                {
+                    conn->cgi_nosplice = 1;
+                    progress = 1;
+                }
+                else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                {
+                    return -1;
+                }
+            }
+            else if (out->header_done && out->chunked && (0 == out->len) && (0 == conn->wlen) &&
+                     !conn->cgi_nosplice && (0 == ioctl(conn->cgi_out_ev.fd, FIONREAD, &avail)) && (avail >= HTTPD_CGI_CHUNK_SIZE))
+            {
+                out->chunk_left = (avail < HTTPD_CGI_PIPE_SIZE) ? avail : HTTPD_CGI_PIPE_SIZE;
+                conn->wlen = sprintf(conn->wbuf, "%x\r\n", out->chunk_left);
+                progress = 1;
+            }
+            else if (out->len < HTTPD_CGI_CHUNK_SIZE)
+            {
+                n = read(conn->cgi_out_ev.fd, out->buf + HTTPD_CGI_CHUNK_HEAD + out->len,
+                         HTTPD_CGI_CHUNK_SIZE - out->len);
+                if (n > 0)
+                {
+                    out->len += n;
+                    progress = 1;
+                }
+                else if (0 == n)
+                {
+                    conn->cgi_eof = 1;
+                    progress = 1;
+                }
+                else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                {
+                    conn->cgi_eof = 1;
+                }
+            }
+        }
+
+        /* chunk头已放入发送缓冲区，chunk内容从管道直接发送到socket，不能splice时
+           经发送缓冲区发送 */
+        if ((out->chunk_left > 0) && (0 == conn->wlen))
+        {
+            if (!conn->cgi_nosplice)
+            {
+                n = splice(conn->cgi_out_ev.fd, NULL, conn->ev.fd, NULL, out->chunk_left,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (n > 0)
+                {
+                    httpd_conn_sent(conn, n);
+                }
+            }
+            else
+            {
+                n = (out->chunk_left < (int)sizeof(conn->wbuf) - 2) ? out->chunk_left : (int)sizeof(conn->wbuf) - 2;
+                n = read(conn->cgi_out_ev.fd, conn->wbuf, n);
+                if (n > 0)
+                {
+                    conn->wlen = n;
+                }
+            }
+
+            if (n > 0)
+            {
+                out->chunk_left -= n;
+                if (0 == out->chunk_left)
+                {
+                    httpd_conn_send(conn, "\r\n", 2);
+                }
+                progress = 1;
+            }
+            else if ((n < 0) && (EINVAL == errno) && !conn->cgi_nosplice)
+            {
+                conn->cgi_nosplice = 1;
+                progress = 1;
+            }
+            else if ((0 == n) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+            {
+                /* 管道中的数据不会减少，chunk内容未发完就出错只能关闭连接 */
+                return -1;
+            }
+        }
+
+        /* 解析CGI报文头并发送给浏览器 */
+        n = httpd_cgi_output(conn);
+        if (n < 0)
+        {
+            return -1;
+        }
+        if (n > 0)
+        {
+            progress = 1;
+        }
+    } while (progress);
+
+    /* CGI程序输出结束且已全部发送 */
+    return httpd_cgi_done(conn);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_header_parse
+ * 功  能:    解析CGI输出缓冲区中的CGI报文头，转换为HTTP回复头放入发送缓冲区:
+ *            Status指定状态码，只有Location时回复302，其余报文头原样转发；
+ *            报文头之后已读入的数据留在缓冲区中作为报文体
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 解析完成  0: 报文头不完整  -1: 报文头格式错误或过长
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 回复头追加到发送缓冲区已有数据之后
+ *            2026-10-16 changzehai(DTT) 1xx/204/304回复不使用chunked编码，
+ *            丢弃报文体
+ ****************************************************************************/
+static int httpd_cgi_header_parse(httpd_conn_t *conn)
+{
+    httpd_cgi_out_t *out = conn->cgi_out;
+    char *data = out->buf + HTTPD_CGI_CHUNK_HEAD;
+    char *end = data + out->len;
+    char *line = NULL;
+    char *nl = NULL;
+    char *colon = NULL;
+    char *body = NULL;
+    const char *status = NULL;
+    int status_len = 0;
+    int line_len = 0;
+    int name_len = 0;
+    int location = 0;
+    int code = 0;
+    int len = 0;
+    int n = 0;
+
+    /* 查找报文头结束的空行，同时取出Status和Location */
+    for (line = data; line < end; line = nl + 1)
+    {
+        nl = (char *)memchr(line, '\n', end - line);
+        if (NULL == nl)
+        {
+            break;
+        }
+        line_len = nl - line;
+        if ((line_len > 0) && ('\r' == line[line_len - 1]))
+        {
+            line_len--;
+        }
+        if (0 == line_len)
+        {
+            body = nl + 1;
+            break;
+        }
+
+        colon = (char *)memchr(line, ':', line_len);
+        if (NULL == colon)
+        {
+            return -1;
+        }
+        name_len = colon - line;
+        if ((6 == name_len) && (0 == strncasecmp(line, "Status", 6)))
+        {
+            for (status = colon + 1; (' ' == *status) || ('\t' == *status); status++)
+            {
+            }
+            status_len = line + line_len - status;
+        }
+        else if ((8 == name_len) && (0 == strncasecmp(line, "Location", 8)))
+        {
+            location = 1;
+        }
+    }
+
+    /* 报文头超过缓冲区大小，或CGI程序未输出完整的报文头就结束 */
+    if (NULL == body)
+    {
+        return ((HTTPD_CGI_CHUNK_SIZE == out->len) || conn->cgi_eof) ? -1 : 0;
+    }
+
+    if (NULL == status)
+    {
+        status = location ? "302 Found" : "200 OK";
+        status_len = strlen(status);
+    }
+    else if ((status_len < 3) || !isdigit((unsigned char)status[0]) || !isdigit((unsigned char)status[1]) ||
+             !isdigit((unsigned char)status[2]) || ((status_len > 3) && (' ' != status[3])))
+    {
+        return -1;
+    }
+
+    /* 1xx/204/304回复不能有报文体和Transfer-Encoding(RFC 9110 6.4.1)，
+       回复头之后即结束，仍可保持连接 */
+    code = atoi(status);
+    if ((code < 200) || (204 == code) || (304 == code))
+    {
+        out->chunked = 0;
+        out->nobody = 1;
+    }
+
+    /* 发送缓冲区中可能还有未发完的100 Continue，回复头接在其后 */
+    len = conn->wlen;
+    n = snprintf(conn->wbuf + len, sizeof(conn->wbuf) - len, "HTTP/1.1 %.*s\r\n" SERVER_STRING,
+                 status_len, status);
+    if (n >= (int)sizeof(conn->wbuf) - len)
+    {
+        return -1;
+    }
+    len += n;
+
+    /* 其余报文头原样转发；回复长度及连接方式由服务器决定 */
+    for (line = data; line < body; line = nl + 1)
+    {
+        nl = (char *)memchr(line, '\n', body - line);
+        line_len = nl - line;
+        if ((line_len > 0) && ('\r' == line[line_len - 1]))
+        {
+            line_len--;
+        }
+        if (0 == line_len)
+        {
+            break;
+        }
+
+        name_len = (char *)memchr(line, ':', line_len) - line;
+        if (((6 == name_len) && (0 == strncasecmp(line, "Status", 6))) ||
+            ((10 == name_len) && (0 == strncasecmp(line, "Connection", 10))) ||
+            ((14 == name_len) && (0 == strncasecmp(line, "Content-Length", 14))) ||
+            ((17 == name_len) && (0 == strncasecmp(line, "Transfer-Encoding", 17))))
+        {
+            continue;
+        }
+
+        if (len + line_len + 2 > (int)sizeof(conn->wbuf))
+        {
+            return -1;
+        }
+        memcpy(conn->wbuf + len, line, line_len);
+        memcpy(conn->wbuf + len + line_len, "\r\n", 2);
+        len += line_len + 2;
+    }
+
+    n = snprintf(conn->wbuf + len, sizeof(conn->wbuf) - len, "%sConnection: %s\r\n\r\n",
+                 out->chunked ? "Transfer-Encoding: chunked\r\n" : "",
+                 conn->keep_alive ? "keep-alive" : "close");
+    if (n >= (int)sizeof(conn->wbuf) - len)
+    {
+        return -1;
+    }
+    conn->wlen = len + n;
+    httpd_stats_status(conn, code);
+
+    /* 报文头之后已读入的数据作为报文体 */
+    out->len = end - body;
+    memmove(data, body, out->len);
+    out->header_done = 1;
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_output
+ * 功  能:    处理CGI输出缓冲区并发送给浏览器: 解析CGI报文头；报文体攒满一个
+ *            chunk、CGI输出结束或缓冲时间达到HTTPD_CGI_FLUSH_MS时，在缓冲区
+ *            原地加上chunk头尾发送；输出结束后发送结束chunk。发送缓冲区中的
+ *            数据(HTTP回复头、chunk头)先于CGI输出缓冲区发送
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 有进展  0: 等待读写事件  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 丢弃没有报文体的回复的CGI输出
+ ****************************************************************************/
+static int httpd_cgi_output(httpd_conn_t *conn)
+{
+    httpd_cgi_out_t *out = conn->cgi_out;
+    char head[HTTPD_CGI_CHUNK_HEAD + 1];
+    struct iovec iov[2];
+    int progress = 0;
+    int n = 0;
+
+    /* CGI报文头转换为HTTP回复头，格式错误时回复500 */
+    if (!out->header_done && ((out->len > 0) || conn->cgi_eof))
+    {
+        n = httpd_cgi_header_parse(conn);
+        if (n < 0)
+        {
+            out->header_done = 1;
+            out->error = 1;
+            out->chunked = 0;
+            out->len = 0;
+            httpd_request_cannot_execute_error(conn);
+        }
+        progress = (0 != n);
+    }
+
+    /* 没有报文体的回复丢弃CGI程序在报文头之后的输出 */
+    if (out->nobody)
+    {
+        out->len = 0;
+    }
+
+    /* 报文体编码为一个chunk，不足一个chunk时等待更多输出，但不超过缓冲时间 */
+    if (out->header_done && (out->len > 0) && (0 == out->end))
+    {
+        if (!out->chunked)
+        {
+            out->pos = HTTPD_CGI_CHUNK_HEAD;
+            out->end = HTTPD_CGI_CHUNK_HEAD + out->len;
+        }
+        else if ((HTTPD_CGI_CHUNK_SIZE == out->len) || conn->cgi_eof ||
+                 ((0 != conn->cgi_flush_at) && (httpd_monotonic_ns() >= conn->cgi_flush_at)))
+        {
+            n = sprintf(head, "%x\r\n", out->len);
+            out->pos = HTTPD_CGI_CHUNK_HEAD - n;
+            memcpy(out->buf + out->pos, head, n);
+            out->end = HTTPD_CGI_CHUNK_HEAD + out->len;
+
+            /* CGI输出已结束时结束chunk随最后一个chunk一起发送 */
+            n = conn->cgi_eof ? 7 : 2;
+            memcpy(out->buf + out->end, "\r\n0\r\n\r\n", n);
+            out->end += n;
+            out->last = conn->cgi_eof;
+        }
+        else
+        {
+            httpd_cgi_flush_schedule(conn);
+        }
+
+        if (0 != out->end)
+        {
+            httpd_cgi_flush_cancel(conn);
+            progress = 1;
+        }
+    }
+
+    /* CGI输出结束且报文体已全部编码，放入结束chunk */
+    if (out->chunked && conn->cgi_eof && out->header_done && !out->last && (0 == out->len) &&
+        (0 == out->chunk_left) && (conn->wlen + 5 <= (int)sizeof(conn->wbuf)))
+    {
+        httpd_conn_send(conn, "0\r\n\r\n", 5);
+        out->last = 1;
+        progress = 1;
+    }
+
+    /* 发送缓冲区和编码好的chunk用一次writev发送，小回复只占一个TCP报文段；
+       chunk头之后紧跟从管道转发的chunk内容时合并发送 */
+    if (conn->wpos < conn->wlen)
+    {
+        if (out->pos < out->end)
+        {
+            iov[0].iov_base = conn->wbuf + conn->wpos;
+            iov[0].iov_len = conn->wlen - conn->wpos;
+            iov[1].iov_base = out->buf + out->pos;
+            iov[1].iov_len = out->end - out->pos;
+            n = writev(conn->ev.fd, iov, 2);
+        }
+        else
+        {
+            n = send(conn->ev.fd, conn->wbuf + conn->wpos, conn->wlen - conn->wpos,
+                     MSG_NOSIGNAL | ((out->chunk_left > 0) ? MSG_MORE : 0));
+        }
+    }
+    else if (out->pos < out->end)
+    {
+        n = send(conn->ev.fd, out->buf + out->pos, out->end - out->pos, MSG_NOSIGNAL);
+    }
+    else
+    {
+        return progress;
+    }
+
+    if (n < 0)
+    {
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? progress : -1;
+    }
+
+    httpd_conn_sent(conn, n);
+    if (n >= conn->wlen - conn->wpos)
+    {
+        n -= conn->wlen - conn->wpos;
+        conn->wpos = 0;
+        conn->wlen = 0;
+        out->pos += n;
+        if ((0 != out->end) && (out->pos == out->end))
+        {
+            out->pos = 0;
+            out->end = 0;
+            out->len = 0;
+        }
+    }
+    else
+    {
+        conn->wpos += n;
+    }
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_done
+ * 功  能:    判断CGI回复是否已全部发送。保持连接时还需等请求体全部读完，才能
+ *            确定下一个请求的起始位置
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 已发送完毕  0: 未完成
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) chunked编码的请求体需读到结束chunk
+ ****************************************************************************/
+static int httpd_cgi_done(httpd_conn_t *conn)
+{
+    httpd_cgi_out_t *out = conn->cgi_out;
+
+    if (!out->header_done || (0 != conn->wlen) || (0 != out->end))
+    {
+        return 0;
+    }
+
+    if (!out->error && !(conn->cgi_eof && (0 == out->len) && (0 == out->chunk_left) &&
+                         (out->last || !out->chunked)))
+    {
+        return 0;
+    }
+
+    return !conn->keep_alive || ((0 == conn->body_left) && !conn->body_chunked);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_flush_schedule
+ * 功  能:    缓冲的CGI输出不足一个chunk时加入本线程的定时发送链表，最迟
+ *            HTTPD_CGI_FLUSH_MS毫秒后发送
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_cgi_flush_schedule(httpd_conn_t *conn)
+{
+    httpd_reactor_t *reactor = conn->reactor;
+
+    if (0 != conn->cgi_flush_at)
+    {
+        return;
+    }
+
+    conn->cgi_flush_at = httpd_monotonic_ns() + HTTPD_CGI_FLUSH_MS * 1000000LL;
+    conn->cgi_flush_prev = NULL;
+    conn->cgi_flush_next = reactor->cgi_flush;
+    if (NULL != reactor->cgi_flush)
+    {
+        reactor->cgi_flush->cgi_flush_prev = conn;
+    }
+    reactor->cgi_flush = conn;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_cgi_flush_cancel
+ * 功  能:    将连接移出CGI输出定时发送链表
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_cgi_flush_cancel(httpd_conn_t *conn)
+{
+    if (0 == conn->cgi_flush_at)
+    {
+        return;
+    }
+
+    if (NULL != conn->cgi_flush_prev)
+    {
+        conn->cgi_flush_prev->cgi_flush_next = conn->cgi_flush_next;
+    }
+    else
+    {
+        conn->reactor->cgi_flush = conn->cgi_flush_next;
+    }
+    if (NULL != conn->cgi_flush_next)
+    {
+        conn->cgi_flush_next->cgi_flush_prev = conn->cgi_flush_prev;
+    }
+    conn->cgi_flush_prev = NULL;
+    conn->cgi_flush_next = NULL;
+    conn->cgi_flush_at = 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_reactor_cgi_flush
+ * 功  能:    发送本线程中缓冲时间已到的CGI输出
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_reactor_cgi_flush(httpd_reactor_t *reactor)
+{
+    httpd_conn_t *conn = NULL;
+    httpd_conn_t *next = NULL;
+    long long now = 0;
+
+    if (NULL == reactor->cgi_flush)
+    {
+        return;
+    }
+
+    /* 处理连接只会将其自身移出链表 */
+    now = httpd_monotonic_ns();
+    for (conn = reactor->cgi_flush; NULL != conn; conn = next)
+    {
+        next = conn->cgi_flush_next;
+        if (now >= conn->cgi_flush_at)
+        {
+            httpd_conn_process(conn);
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_config
+ * 功  能:    解析FastCGI程序配置"url[:进程数]"，如"/user.cgi:4"
+ * 输  入:    arg: 命令行参数
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 参数错误
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_fcgi_config(const char *arg)
+{
+    httpd_fcgi_app_t *app = NULL;
+    const char *colon = strrchr(arg, ':');
+    int url_len = (NULL != colon) ? (int)(colon - arg) : (int)strlen(arg);
+
+    if ((HTTPD_FCGI_MAX_APPS == g_httpd_fcgi_app_num) || ('/' != arg[0]))
+    {
+        return -1;
+    }
+
+    app = &g_httpd_fcgi_apps[g_httpd_fcgi_app_num];
+    if (snprintf(app->path, sizeof(app->path), HTTPD_DOC_ROOT "%.*s", url_len, arg) >= (int)sizeof(app->path))
+    {
+        return -1;
+    }
+
+    app->procs = (NULL != colon) ? atoi(colon + 1) : HTTPD_FCGI_PROCS;
+    if ((app->procs <= 0) || (app->procs > HTTPD_FCGI_MAX_PROCS))
+    {
+        return -1;
+    }
+
+    app->listen_fd = -1;
+    g_httpd_fcgi_app_num++;
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_startup
+ * 功  能:    为每个FastCGI程序创建Unix监听socket并启动配置数量的常驻进程。
+ *            socket文件放在权限为0700的私有目录中，socket本身为0600，其他
+ *            用户无法连接FastCGI程序伪造请求；服务器被终止时删除
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 抽象命名空间socket任何本地用户都可以
+ *            连接，改为私有目录中的socket文件
+ ****************************************************************************/
+static void httpd_fcgi_startup(void)
+{
+    httpd_fcgi_app_t *app = NULL;
+    struct sigaction sa;
+    int i = 0;
+    int j = 0;
+
+    if (0 == g_httpd_fcgi_app_num)
+    {
+        return;
+    }
+
+    /* mkdtemp创建的目录权限为0700 */
+    snprintf(g_httpd_fcgi_dir, sizeof(g_httpd_fcgi_dir), "/tmp/httpd-fcgi-XXXXXX");
+    if (NULL == mkdtemp(g_httpd_fcgi_dir))
+    {
+        httpd_error_exit("fcgi mkdtemp failed");
+    }
+
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_handler = httpd_fcgi_shutdown;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    for (i = 0; i < g_httpd_fcgi_app_num; i++)
+    {
+        app = &g_httpd_fcgi_apps[i];
+
+        memset(&app->addr, 0x00, sizeof(app->addr));
+        app->addr.sun_family = AF_UNIX;
+        snprintf(app->addr.sun_path, sizeof(app->addr.sun_path), "%s/%d.sock", g_httpd_fcgi_dir, i);
+        app->addr_len = sizeof(app->addr);
+
+        app->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (app->listen_fd < 0)
+        {
+            httpd_error_exit("fcgi socket failed");
+        }
+        if ((bind(app->listen_fd, (struct sockaddr *)&app->addr, app->addr_len) < 0) ||
+            (chmod(app->addr.sun_path, 0600) < 0))
+        {
+            httpd_error_exit("fcgi bind failed");
+        }
+        if (listen(app->listen_fd, HTTPD_FCGI_BACKLOG) < 0)
+        {
+            httpd_error_exit("fcgi listen failed");
+        }
+
+        for (j = 0; j < app->procs; j++)
+        {
+            app->pids[j] = httpd_fcgi_spawn(app);
+            app->spawned[j] = httpd_monotonic_time();
+            if (app->pids[j] <= 0)
+            {
+                app->pids[j] = 0;
+                atomic_fetch_add(&g_httpd_fcgi_dead, 1);
+            }
+        }
+
+        printf("fastcgi %s: %d processes\n", app->path, app->procs);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_shutdown
+ * 功  能:    SIGTERM/SIGINT处理: 结束FastCGI进程组，删除FastCGI监听socket
+ *            及其目录后按默认方式终止服务器(只调用异步信号安全的函数)
+ * 输  入:    sig: 信号
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) FastCGI进程改由posix_spawn启动后没有
+ *            PR_SET_PDEATHSIG，在此结束
+ ****************************************************************************/
+static void httpd_fcgi_shutdown(int sig)
+{
+    int i = 0;
+    int j = 0;
+
+    for (i = 0; i < g_httpd_fcgi_app_num; i++)
+    {
+        for (j = 0; j < g_httpd_fcgi_apps[i].procs; j++)
+        {
+            if (g_httpd_fcgi_apps[i].pids[j] > 0)
+            {
+                kill(-g_httpd_fcgi_apps[i].pids[j], SIGTERM);
+            }
+        }
+        unlink(g_httpd_fcgi_apps[i].addr.sun_path);
+    }
+    rmdir(g_httpd_fcgi_dir);
+
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_spawn
+ * 功  能:    启动一个FastCGI进程，按FastCGI规范监听socket作为进程的标准输入
+ * 输  入:    app: FastCGI程序
+ * 输  出:    无
+ * 返回值:    进程ID  -1: 失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 与CGI程序相同改用posix_spawn启动，
+ *            工作线程重启进程时不复制服务器的页表
+ ****************************************************************************/
+static pid_t httpd_fcgi_spawn(httpd_fcgi_app_t *app)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigdefault;
+    char *argv[2];
+    pid_t pid = -1;
+    int ret = 0;
+
+    argv[0] = app->path;
+    argv[1] = NULL;
+
+    /* 监听socket作为标准输入(dup2会清除O_CLOEXEC)，恢复SIGPIPE的默认处理；
+       进程单独成为进程组，服务器被终止时连同其派生的进程一起结束 */
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, app->listen_fd, 0);
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    ret = posix_spawn(&pid, app->path, &actions, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    return (0 == ret) ? pid : -1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_child_exit
+ * 功  能:    子进程退出时调用，若为FastCGI进程则标记为需要重启
+ * 输  入:    pid: 已退出的子进程ID
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_fcgi_child_exit(pid_t pid)
+{
+    int i = 0;
+    int j = 0;
+
+    if (0 == g_httpd_fcgi_app_num)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&g_httpd_fcgi_lock);
+    for (i = 0; i < g_httpd_fcgi_app_num; i++)
+    {
+        for (j = 0; j < g_httpd_fcgi_apps[i].procs; j++)
+        {
+            if (g_httpd_fcgi_apps[i].pids[j] == pid)
+            {
+                g_httpd_fcgi_apps[i].pids[j] = 0;
+                atomic_fetch_add(&g_httpd_fcgi_dead, 1);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_httpd_fcgi_lock);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_respawn
+ * 功  能:    重启已退出的FastCGI进程。同一进程1秒内最多重启一次，避免启动即
+ *            退出的程序占满CPU
+ * 输  入:    now: 当前时间
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_fcgi_respawn(time_t now)
+{
+    httpd_fcgi_app_t *app = NULL;
+    int i = 0;
+    int j = 0;
+
+    if ((0 == atomic_load(&g_httpd_fcgi_dead)) || (0 != pthread_mutex_trylock(&g_httpd_fcgi_lock)))
+    {
+        return;
+    }
+
+    for (i = 0; i < g_httpd_fcgi_app_num; i++)
+    {
+        app = &g_httpd_fcgi_apps[i];
+        for (j = 0; j < app->procs; j++)
+        {
+            if ((0 != app->pids[j]) || (now - app->spawned[j] < 1))
+            {
+                continue;
+            }
+
+            app->spawned[j] = now;
+            app->pids[j] = httpd_fcgi_spawn(app);
+            if (app->pids[j] > 0)
+            {
+                atomic_fetch_sub(&g_httpd_fcgi_dead, 1);
+            }
+            else
+            {
+                app->pids[j] = 0;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&g_httpd_fcgi_lock);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_lookup
+ * 功  能:    查找处理该脚本的FastCGI程序
+ * 输  入:    path: 脚本路径
+ * 输  出:    无
+ * 返回值:    FastCGI程序  NULL: 该脚本按CGI方式执行
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static httpd_fcgi_app_t *httpd_fcgi_lookup(const char *path)
+{
+    int i = 0;
+
+    for (i = 0; i < g_httpd_fcgi_app_num; i++)
+    {
+        if (0 == strcmp(g_httpd_fcgi_apps[i].path, path))
+        {
+            return &g_httpd_fcgi_apps[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_header
+ * 功  能:    生成FastCGI记录头(请求ID固定为1，每个连接只有一个请求)
+ * 输  入:    type:        记录类型
+ *            content_len: 记录内容长度
+ * 输  出:    buf:         记录头(FCGI_HEADER_LEN字节)
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_fcgi_header(char *buf, int type, int content_len)
+{
+    buf[0] = FCGI_VERSION_1;
+    buf[1] = (char)type;
+    buf[2] = 0;
+    buf[3] = 1;
+    buf[4] = (char)((content_len >> 8) & 0xff);
+    buf[5] = (char)(content_len & 0xff);
+    buf[6] = 0;
+    buf[7] = 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_param
+ * 功  能:    按FastCGI名值对格式编码一个参数
+ * 输  入:    size: 缓冲区剩余大小
+ *            env:  "NAME=value"形式的环境变量
+ * 输  出:    buf:  编码后的参数
+ * 返回值:    编码长度  0: 缓冲区不足
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 参数改为与CGI共用的环境变量字符串
+ ****************************************************************************/
+static int httpd_fcgi_param(char *buf, size_t size, const char *env)
+{
+    const char *value = strchr(env, '=') + 1;
+    size_t lens[2];
+    size_t len = 0;
+    int i = 0;
+
+    lens[0] = value - env - 1;
+    lens[1] = strlen(value);
+    if (lens[0] + lens[1] + 8 > size)
+    {
+        return 0;
+    }
+
+    /* 长度小于128用1字节，否则用最高位置1的4字节 */
+    for (i = 0; i < 2; i++)
+    {
+        if (lens[i] < 128)
+        {
+            buf[len++] = (char)lens[i];
+        }
+        else
+        {
+            buf[len++] = (char)(((lens[i] >> 24) & 0x7f) | 0x80);
+            buf[len++] = (char)((lens[i] >> 16) & 0xff);
+            buf[len++] = (char)((lens[i] >> 8) & 0xff);
+            buf[len++] = (char)(lens[i] & 0xff);
+        }
+    }
+    memcpy(buf + len, env, lens[0]);
+    len += lens[0];
+    memcpy(buf + len, value, lens[1]);
+    len += lens[1];
+
+    return (int)len;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_execute
+ * 功  能:    连接FastCGI程序并放入FCGI_BEGIN_REQUEST和FCGI_PARAMS记录，
+ *            之后的数据转发由httpd_fcgi_transfer完成
+ * 输  入:    conn: 客户端连接
+ *            app:  FastCGI程序
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 所有进程都忙或未运行，由调用者改用CGI方式执行
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 请求数据从连接内存池分配
+ *            2026-10-16 changzehai(DTT) 统计回复状态码
+ *            2026-10-16 changzehai(DTT) 回复头改由CGI报文头生成
+ *            2026-10-16 changzehai(DTT) 请求体转发改由httpd_cgi_start设置
+ ****************************************************************************/
+static int httpd_fcgi_execute(httpd_conn_t *conn, httpd_fcgi_app_t *app)
+{
+    httpd_fcgi_req_t *req = NULL;
+    struct epoll_event ev;
+    char env_buf[HTTPD_CGI_ENV_SIZE];
+    char *envp[HTTPD_CGI_ENV_MAX + 1];
+    char *params = NULL;
+    size_t room = 0;
+    int len = 0;
+    int fd = -1;
+    int i = 0;
+
+    /* 监听队列已满时connect立即返回EAGAIN */
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((fd < 0) || (connect(fd, (struct sockaddr *)&app->addr, app->addr_len) < 0))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    req = (httpd_fcgi_req_t *)httpd_arena_alloc(&conn->arena, sizeof(httpd_fcgi_req_t));
+    if (NULL == req)
+    {
+        close(fd);
+        return -1;
+    }
+    memset(req, 0x00, offsetof(httpd_fcgi_req_t, obuf));
+
+    /* FCGI_BEGIN_REQUEST: 角色为Responder，处理完后由FastCGI程序关闭连接 */
+    httpd_fcgi_header(req->obuf, FCGI_BEGIN_REQUEST, 8);
+    memset(req->obuf + FCGI_HEADER_LEN, 0x00, 8);
+    req->obuf[FCGI_HEADER_LEN + 1] = FCGI_RESPONDER;
+    req->olen = FCGI_HEADER_LEN + 8;
+
+    /* FCGI_PARAMS: CGI环境变量 */
+    params = req->obuf + req->olen + FCGI_HEADER_LEN;
+    room = sizeof(req->obuf) - req->olen - 2 * FCGI_HEADER_LEN;
+    httpd_cgi_env(conn, env_buf, sizeof(env_buf), envp, HTTPD_CGI_ENV_MAX);
+    for (i = 0; NULL != envp[i]; i++)
+    {
+        len += httpd_fcgi_param(params + len, room - len, envp[i]);
+    }
+    httpd_fcgi_header(req->obuf + req->olen, FCGI_PARAMS, len);
+    req->olen += FCGI_HEADER_LEN + len;
+
+    /* 空FCGI_PARAMS记录表示参数结束 */
+    httpd_fcgi_header(req->obuf + req->olen, FCGI_PARAMS, 0);
+    req->olen += FCGI_HEADER_LEN;
+
+    conn->fcgi = req;
+    conn->cgi_out_ev.fd = fd;
+    conn->cgi_out_ev.type = HTTPD_EV_FCGI;
+
+    /* 同一个socket收发，读写事件都由httpd_fcgi_transfer处理 */
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &conn->cgi_out_ev;
+    epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+
+    /* 与CGI方式相同，FastCGI程序输出的CGI报文头由httpd_cgi_output解析 */
+    conn->state = HTTPD_CONN_CGI;
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_transfer
+ * 功  能:    在FastCGI程序和客户端之间转发数据: 请求体封装成FCGI_STDIN记录
+ *            发给FastCGI程序，FCGI_STDOUT记录的内容发给客户端
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 处理结果发送完毕  0: 等待读写事件  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ *            2026-10-16 changzehai(DTT) 输出改由httpd_cgi_output按chunked编码发送
+ *            2026-10-16 changzehai(DTT) 转发chunked编码的请求体
+ ****************************************************************************/
+static int httpd_fcgi_transfer(httpd_conn_t *conn)
+{
+    httpd_fcgi_req_t *req = conn->fcgi;
+    int fd = conn->cgi_out_ev.fd;
+    int progress = 0;
+    int n = 0;
+
+    do
+    {
+        progress = 0;
+
+        /* chunked编码的请求体: 当前chunk已转发完，解析下一个chunk */
+        if (conn->body_chunked && (0 == conn->body_left))
+        {
+            n = httpd_request_body_next(conn);
+            if (n < 0)
+            {
+                return -1;
+            }
+            progress = n;
+        }
+
+        /* 接收缓冲区中的请求体已转发完，从客户端读取更多请求体 */
+        if ((conn->body_left > 0) && (conn->rpos == conn->rlen))
+        {
+            conn->rpos = 0;
+            conn->rlen = 0;
+            n = httpd_conn_fill(conn);
+            if (n > 0)
+            {
+                progress = 1;
+            }
+            else if (n < 0)
+            {
+                return -1;
+            }
+        }
+
+        /* 发送缓冲区已空，将请求体封装成FCGI_STDIN记录 */
+        if (req->opos == req->olen)
+        {
+            req->opos = 0;
+            req->olen = 0;
+
+            if ((conn->body_left > 0) && (conn->rpos < conn->rlen))
+            {
+                n = conn->rlen - conn->rpos;
+                if (n > conn->body_left)
+                {
+                    n = (int)conn->body_left;
+                }
+                if (n > (int)sizeof(req->obuf) - FCGI_HEADER_LEN)
+                {
+                    n = sizeof(req->obuf) - FCGI_HEADER_LEN;
+                }
+
+                httpd_fcgi_header(req->obuf, FCGI_STDIN, n);
+                memcpy(req->obuf + FCGI_HEADER_LEN, conn->rbuf + conn->rpos, n);
+                req->olen = FCGI_HEADER_LEN + n;
+                conn->rpos += n;
+                conn->body_left -= n;
+            }
+            else if ((0 == conn->body_left) && !conn->body_chunked && !req->stdin_done)
+            {
+                /* 空FCGI_STDIN记录表示请求体结束 */
+                httpd_fcgi_header(req->obuf, FCGI_STDIN, 0);
+                req->olen = FCGI_HEADER_LEN;
+                req->stdin_done = 1;
+            }
+        }
+
+        if (req->opos < req->olen)
+        {
+            n = send(fd, req->obuf + req->opos, req->olen - req->opos, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                req->opos += n;
+                progress = 1;
+            }
+            else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            {
+                /* FastCGI程序不再读取，丢弃剩余请求体 */
+                req->opos = req->olen;
+                req->stdin_done = 1;
+                conn->body_left = 0;
+                conn->body_chunked = 0;
+            }
+        }
+
+        /* 读取FastCGI程序发来的记录 */
+        if (!req->sock_eof)
+        {
+            if (req->ipos > 0)
+            {
+                memmove(req->ibuf, req->ibuf + req->ipos, req->ilen - req->ipos);
+                req->ilen -= req->ipos;
+                req->ipos = 0;
+            }
+
+            if (req->ilen < (int)sizeof(req->ibuf))
+            {
+                n = read(fd, req->ibuf + req->ilen, sizeof(req->ibuf) - req->ilen);
+                if (n > 0)
+                {
+                    req->ilen += n;
+                    progress = 1;
+                }
+                else if ((0 == n) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+                {
+                    req->sock_eof = 1;
+                    progress = 1;
+                }
+            }
+        }
+
+        httpd_fcgi_parse(conn);
+
+        /* 解析CGI报文头并发送给浏览器 */
+        n = httpd_cgi_output(conn);
+        if (n < 0)
+        {
+            return -1;
+        }
+        if (n > 0)
+        {
+            progress = 1;
+        }
+    } while (progress);
+
+    /* FCGI_END_REQUEST已收到(或FastCGI程序已断开)且处理结果已全部发送 */
+    return httpd_cgi_done(conn);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_fcgi_parse
+ * 功  能:    解析接收缓冲区中的FastCGI记录: FCGI_STDOUT内容放入CGI输出缓冲区，
+ *            FCGI_STDERR内容输出到服务器标准错误，收到FCGI_END_REQUEST表示
+ *            处理结束。CGI输出缓冲区已满时停止解析，等数据发出后继续
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) FCGI_STDOUT内容放入CGI输出缓冲区
+ ****************************************************************************/
+static void httpd_fcgi_parse(httpd_conn_t *conn)
+{
+    httpd_fcgi_req_t *req = conn->fcgi;
+    httpd_cgi_out_t *out = conn->cgi_out;
+    unsigned char *hdr = NULL;
+    int n = 0;
+
+    while (!conn->cgi_eof)
+    {
+        if ((0 == req->content_left) && (0 == req->padding_left))
+        {
+            /* 记录头不完整 */
+            if (req->ilen - req->ipos < FCGI_HEADER_LEN)
+            {
+                break;
+            }
+
+            hdr = (unsigned char *)req->ibuf + req->ipos;
+            req->type = hdr[1];
+            req->content_left = (hdr[4] << 8) | hdr[5];
+            req->padding_left = hdr[6];
+            req->ipos += FCGI_HEADER_LEN;
+
+            if (FCGI_END_REQUEST == req->type)
+            {
+                conn->cgi_eof = 1;
+                break;
+            }
+            continue;
+        }
+
+        n = req->ilen - req->ipos;
+        if (0 == n)
+        {
+            break;
+        }
+
+        if (req->content_left > 0)
+        {
+            if (n > req->content_left)
+            {
+                n = req->content_left;
+            }
+
+            if (FCGI_STDOUT == req->type)
+            {
+                /* CGI输出缓冲区正在发送时不能追加 */
+                if (n > HTTPD_CGI_CHUNK_SIZE - out->len)
+                {
+                    n = HTTPD_CGI_CHUNK_SIZE - out->len;
+                }
+                if ((0 == n) || (0 != out->end))
+                {
+                    break;
+                }
+                memcpy(out->buf + HTTPD_CGI_CHUNK_HEAD + out->len, req->ibuf + req->ipos, n);
+                out->len += n;
+            }
+            else if (FCGI_STDERR == req->type)
+            {
+                fwrite(req->ibuf + req->ipos, 1, n, stderr);
+            }
+
+            req->content_left -= n;
+        }
+        else
+        {
+            if (n > req->padding_left)
+            {
+                n = req->padding_left;
+            }
+            req->padding_left -= n;
+        }
+        req->ipos += n;
+    }
+
+    /* FastCGI程序未发送FCGI_END_REQUEST就断开，剩余数据已无法解析 */
+    if (req->sock_eof && !conn->cgi_eof &&
+        ((req->ipos == req->ilen) || ((0 == req->content_left) && (0 == req->padding_left))))
+    {
+        conn->cgi_eof = 1;
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_send
+ * 功  能:    将数据放入连接发送缓冲区，由httpd_conn_flush发送
+ * 输  入:    conn: 客户端连接
+ *            buf:  数据
+ *            len:  数据长度
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_conn_send(httpd_conn_t *conn, const char *buf, size_t len)
+{
+    if (len > sizeof(conn->wbuf) - conn->wlen)
+    {
+        len = sizeof(conn->wbuf) - conn->wlen;
+    }
+
+    memcpy(conn->wbuf + conn->wlen, buf, len);
+    conn->wlen += len;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_flush
+ * 功  能:    发送连接缓冲区中的回复数据，缓冲区发完后在内核中直接发送静态文件；
+ *            命中缓存的回复直接从缓存项发送
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 全部发送完毕  0: socket发送缓冲区已满  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 多区间回复时交替发送分隔报文头和文件区间
+ *            2026-10-16 changzehai(DTT) 使用io_uring时文件内容由io_uring发送
+ *            2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ ****************************************************************************/
+static int httpd_conn_flush(httpd_conn_t *conn)
+{
+    int n = 0;
+    int flags = 0;
+
+    if (NULL != conn->cache_entry)
+    {
+        return httpd_conn_send_cached(conn);
+    }
+
+    for (;;)
+    {
+        /* 后面还有文件数据时，报文头与文件开头合并成同一个TCP报文段 */
+        flags = MSG_NOSIGNAL;
+        if (conn->file_fd >= 0)
+        {
+            flags |= MSG_MORE;
+        }
+
+        while (conn->wpos < conn->wlen)
+        {
+            n = send(conn->ev.fd, conn->wbuf + conn->wpos, conn->wlen - conn->wpos, flags);
+            if (n < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+            }
+            conn->wpos += n;
+            httpd_conn_sent(conn, n);
+        }
+
+        conn->wpos = 0;
+        conn->wlen = 0;
+
+        if (conn->file_fd < 0)
+        {
+            return 1;
+        }
+
+#ifdef HTTPD_IO_URING
+        n = (NULL != conn->reactor->uring) ? httpd_uring_send_file(conn) : httpd_conn_sendfile(conn);
+#else
+        n = httpd_conn_sendfile(conn);
+#endif
+        if (n <= 0)
+        {
+            return n;
+        }
+
+        /* 当前区间发送完毕，还有下一个区间时继续发送其分隔报文头 */
+        if (!httpd_range_next(conn))
+        {
+            close(conn->file_fd);
+            conn->file_fd = -1;
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_send_cached
+ * 功  能:    用writev发送缓存的回复: 预生成的报文头 + Connection头 + 文件内容，
+ *            一次系统调用完成整个回复
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 发送完毕  0: socket发送缓冲区已满  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ ****************************************************************************/
+static int httpd_conn_send_cached(httpd_conn_t *conn)
+{
+    httpd_cache_entry_t *entry = conn->cache_entry;
+    const char *connection = conn->keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    struct iovec iov[3];
+    size_t skip = 0;
+    size_t total = 0;
+    ssize_t n = 0;
+    int cnt = 0;
+    int i = 0;
+
+    iov[0].iov_base = entry->header;
+    iov[0].iov_len = entry->header_len;
+    iov[1].iov_base = (void *)connection;
+    iov[1].iov_len = strlen(connection);
+    iov[2].iov_base = entry->body;
+    iov[2].iov_len = entry->body_len;
+    total = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+
+    while (conn->cache_sent < total)
+    {
+        /* 跳过已发送的部分 */
+        skip = conn->cache_sent;
+        for (i = 0, cnt = 0; i < 3; i++)
+        {
+            if (skip >= iov[i].iov_len)
+            {
+                skip -= iov[i].iov_len;
+                continue;
+            }
+            iov[cnt].iov_base = (char *)iov[i].iov_base + skip;
+            iov[cnt].iov_len = iov[i].iov_len - skip;
+            skip = 0;
+            cnt++;
+        }
+
+        n = writev(conn->ev.fd, iov, cnt);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+        }
+        conn->cache_sent += n;
+        httpd_conn_sent(conn, n);
+
+        /* 恢复完整的iovec，下一轮重新计算偏移 */
+        iov[0].iov_base = entry->header;
+        iov[0].iov_len = entry->header_len;
+        iov[1].iov_base = (void *)connection;
+        iov[1].iov_len = strlen(connection);
+        iov[2].iov_base = entry->body;
+        iov[2].iov_len = entry->body_len;
+    }
+
+    httpd_cache_release(entry);
+    conn->cache_entry = NULL;
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_sendfile
+ * 功  能:    用sendfile将静态文件从页缓存直接发送到socket，不经过用户态拷贝；
+ *            文件系统不支持sendfile时改用splice
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 文件发送完毕  0: socket发送缓冲区已满  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ ****************************************************************************/
+static int httpd_conn_sendfile(httpd_conn_t *conn)
+{
+    ssize_t n = 0;
+    size_t count = 0;
+
+    if (conn->splice_len > 0)
+    {
+        return httpd_conn_splice_file(conn);
+    }
+
+    while (conn->file_left > 0)
+    {
+        count = (conn->file_left < HTTPD_SENDFILE_CHUNK) ? (size_t)conn->file_left : HTTPD_SENDFILE_CHUNK;
+        n = sendfile(conn->ev.fd, conn->file_fd, &conn->file_offset, count);
+        if (n > 0)
+        {
+            conn->file_left -= n;
+            httpd_conn_sent(conn, n);
+        }
+        else if (0 == n)
+        {
+            /* 文件在发送过程中被截短，已无法满足Content-Length */
+            return -1;
+        }
+        else if ((EINVAL == errno) || (ENOSYS == errno))
+        {
+            return httpd_conn_splice_file(conn);
+        }
+        else if (EINTR != errno)
+        {
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+        }
+    }
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_splice_file
+ * 功  能:    经管道用splice发送静态文件: 文件->管道->socket，数据只在内核中移动
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 文件发送完毕  0: socket发送缓冲区已满  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ ****************************************************************************/
+static int httpd_conn_splice_file(httpd_conn_t *conn)
+{
+    ssize_t n = 0;
+    size_t count = 0;
+
+    if ((conn->splice_pipe[0] < 0) &&
+        (pipe2(conn->splice_pipe, O_NONBLOCK | O_CLOEXEC) < 0))
+    {
+        conn->splice_pipe[0] = -1;
+        conn->splice_pipe[1] = -1;
+        return -1;
+    }
+
+    while ((conn->file_left > 0) || (conn->splice_len > 0))
+    {
+        /* 管道已空，从文件读入下一段 */
+        if (0 == conn->splice_len)
+        {
+            count = (conn->file_left < HTTPD_SENDFILE_CHUNK) ? (size_t)conn->file_left : HTTPD_SENDFILE_CHUNK;
+            n = splice(conn->file_fd, &conn->file_offset, conn->splice_pipe[1], NULL,
+                       count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n <= 0)
+            {
+                if ((n < 0) && (EINTR == errno))
+                {
+                    continue;
+                }
+                return -1;
+            }
+            conn->splice_len = n;
+            conn->file_left -= n;
+        }
+
+        n = splice(conn->splice_pipe[0], NULL, conn->ev.fd, NULL, conn->splice_len,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK | ((conn->file_left > 0) ? SPLICE_F_MORE : 0));
+        if (n > 0)
+        {
+            conn->splice_len -= n;
+            httpd_conn_sent(conn, n);
+        }
+        else if ((n < 0) && (EINTR != errno))
+        {
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+        }
+    }
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_request_process
+ * 功  能:    处理解析完成的HTTP请求，准备回复数据并切换连接处理阶段
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无  
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计请求数，处理服务器状态页请求
+ *            2026-10-16 changzehai(DTT) 去掉请求调试输出，记录访问日志的开始时间
+ *            2026-10-16 changzehai(DTT) chunked编码的请求体未读取时关闭连接
+ ****************************************************************************/
+static void httpd_request_process(httpd_conn_t *conn)
+{
+    http_request_data_t *h_data = &conn->http_data;
+
+    conn->state = HTTPD_CONN_RESPONSE;
+    conn->requests++;
+    conn->response_start = httpd_monotonic_ns();
+    conn->request_start = conn->response_start;
+    HTTPD_STAT_ADD(conn->reactor->stats.requests, 1);
+
+    /* HTTP/1.1默认保持连接，HTTP/1.0需客户端明确要求；请求体未被读取时
+       无法确定下一个请求的起始位置，需关闭连接 */
+    if (11 == h_data->req_line_data.http_version)
+    {
+        conn->keep_alive = (2 != h_data->connection);
+    }
+    else
+    {
+        conn->keep_alive = (1 == h_data->connection);
+    }
+
+    if ((h_data->content_length > 0) || h_data->chunked || (conn->requests >= g_httpd_config.keepalive_max))
+    {
+        conn->keep_alive = 0;
+    }
+
+    /* 服务器状态页不对应文件，不需要检查请求资源 */
+    if ((0 == strcasecmp(h_data->req_line_data.method, "GET")) &&
+        (sizeof(HTTPD_STATUS_PATH) - 1 == h_data->req_line_data.uri.len) &&
+        (0 == memcmp(h_data->req_line_data.uri.data, HTTPD_STATUS_PATH, sizeof(HTTPD_STATUS_PATH) - 1)))
+    {
+        httpd_server_status(conn);
+        return;
+    }
+
+    /* HTTP请求错误处理 */
+    if (-1 == httpd_request_error_deal(conn))
+    {
+        return;
+    }
+
+    /* 处理客户端请求，并将处理结果返回给客户端 */
+    if (0 == h_data->req_line_data.cgi) /* 不带参数的GET请求，不需要执行CGI程序，直接返回请求的资源文件 */
+    {
+        /* 发送所请求的资源文件给客户端 */
+        httpd_send_file(conn, h_data->req_line_data.path);
+    }
+    else 
+    {
+        /* 限制同时运行的CGI程序数，名额已满时排队等待，队列也满时回复503，
+           避免突发的CGI请求创建大量进程拖垮服务器 */
+        switch (httpd_cgi_acquire(conn))
+        {
+            case 1:
+                httpd_cgi_start(conn);
+                break;
+            case 0:
+                conn->state = HTTPD_CONN_CGI_WAIT;
+                break;
+            default:
+                httpd_request_unavailable_error(conn);
+                break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_process
+ * 功  能:    驱动客户端连接状态机: 请求行解析->请求头解析->回复/CGI->关闭，
+ *            每个阶段处理到数据未到齐或socket不可写(EAGAIN)为止；持久连接
+ *            回复完成后回到请求行解析
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 统计各阶段耗时
+ *            2026-10-16 changzehai(DTT) 请求完成时记录访问日志
+ *            2026-10-16 changzehai(DTT) 超时由时间轮按阶段处理
+ *            2026-10-16 changzehai(DTT) CGI回复完成后保持连接
+ ****************************************************************************/
+static void httpd_conn_process(httpd_conn_t *conn)
+{
+    long long start = 0;
+    int ret = 0;
+    int n = 0;
+    char c = 0;
+
+    while (HTTPD_CONN_CLOSE != conn->state)
+    {
+        switch (conn->state)
+        {
+            case HTTPD_CONN_REQUEST_LINE:
+                /* 解析耗时在多次读事件间累计，不含等待数据的时间 */
+                start = httpd_monotonic_ns();
+                ret = httpd_request_line_analyze(conn);
+                conn->parse_ns += httpd_monotonic_ns() - start;
+                if (ret > 0)
+                {
+                    httpd_stats_record(conn->reactor, HTTPD_STAGE_REQUEST_LINE, conn->parse_ns);
+                    conn->parse_ns = 0;
+                    conn->state = HTTPD_CONN_REQUEST_HEADER;
+                }
+                break;
+
+            case HTTPD_CONN_REQUEST_HEADER:
+                start = httpd_monotonic_ns();
+                ret = httpd_request_header_analyze(conn);
+                conn->parse_ns += httpd_monotonic_ns() - start;
+                if (ret > 0)
+                {
+                    httpd_stats_record(conn->reactor, HTTPD_STAGE_REQUEST_HEADER, conn->parse_ns);
+                    conn->parse_ns = 0;
+                    httpd_request_process(conn);
+                }
+                break;
+
+            case HTTPD_CONN_RESPONSE:
+                ret = httpd_conn_flush(conn);
+                if (ret > 0)
+                {
+                    if (0 != conn->response_start)
+                    {
+                        httpd_stats_record(conn->reactor, HTTPD_STAGE_STATIC_SEND,
+                                           httpd_monotonic_ns() - conn->response_start);
+                        conn->response_start = 0;
+                    }
+                    httpd_access_log(conn);
+
+                    /* 持久连接继续处理下一个(可能已流水线发送的)请求 */
+                    if (conn->keep_alive)
+                    {
+                        httpd_conn_reset(conn);
+                    }
+                    else
+                    {
+                        conn->state = HTTPD_CONN_CLOSE;
+                    }
+                }
+                break;
+
+            case HTTPD_CONN_CGI_WAIT:
+                /* 等待CGI执行名额期间只检查客户端是否已断开 */
+                n = recv(conn->ev.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+                ret = ((0 == n) || ((n < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno) &&
+                                    (EINTR != errno))) ? -1 : 0;
+                break;
+
+            case HTTPD_CONN_CGI:
+                ret = (NULL != conn->fcgi) ? httpd_fcgi_transfer(conn) : httpd_cgi_transfer(conn);
+                if (ret > 0)
+                {
+                    httpd_stats_record(conn->reactor, HTTPD_STAGE_CGI_DONE, httpd_monotonic_ns() - conn->cgi_start);
+                    httpd_access_log(conn);
+                    httpd_cgi_release(conn);
+
+                    /* chunked编码的回复已确定结束位置，可以继续处理下一个请求 */
+                    if (conn->keep_alive)
+                    {
+                        httpd_conn_reset(conn);
+                    }
+                    else
+                    {
+                        conn->state = HTTPD_CONN_CLOSE;
+                    }
+                }
+                break;
+
+            default:
+                ret = -1;
+                break;
+        }
+
+        if ((-2 == ret) || (-3 == ret))
+        {
+            /* 格式错误的请求同样记录访问日志 */
+            conn->request_start = httpd_monotonic_ns();
+        }
+
+        if (-2 == ret)
+        {
+            /* 请求行或请求头过长 */
+            httpd_request_too_large_error(conn);
+            conn->state = HTTPD_CONN_RESPONSE;
+        }
+        else if (-3 == ret)
+        {
+            /* 请求行或请求头格式错误 */
+            httpd_request_bad_error(conn);
+            conn->state = HTTPD_CONN_RESPONSE;
+        }
+        else if (ret < 0)
+        {
+            conn->state = HTTPD_CONN_CLOSE;
+        }
+        else if (0 == ret)
+        {
+            /* 等待下一次读写事件，按当前阶段设置超时 */
+            httpd_conn_timer_update(conn);
+            return;
+        }
+    }
+    
+    httpd_conn_close(conn);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_close
+ * 功  能:    关闭客户端连接及其CGI管道，连接内存在本轮事件处理完后释放
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 取消尚未完成的io_uring请求
+ *            2026-10-16 changzehai(DTT) FastCGI请求数据随连接对象回收
+ *            2026-10-16 changzehai(DTT) 统计关闭的连接数
+ *            2026-10-16 changzehai(DTT) 回复未完成时记录访问日志
+ *            2026-10-16 changzehai(DTT) 关闭时删除超时定时器
+ *            2026-10-16 changzehai(DTT) 更新准入控制的连接数
+ *            2026-10-16 changzehai(DTT) 移出CGI输出定时发送链表
+ *            2026-10-16 changzehai(DTT) 向CGI进程组发送SIGTERM
+ ****************************************************************************/
+static void httpd_conn_close(httpd_conn_t *conn)
+{
+    if (conn->ev.fd < 0)
+    {
+        return;
+    }
+
+    /* 关闭文件描述符会自动将其从epoll中移除 */
+    if (conn->file_fd >= 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+    }
+
+    if (NULL != conn->cache_entry)
+    {
+        httpd_cache_release(conn->cache_entry);
+        conn->cache_entry = NULL;
+    }
+
+    if (conn->splice_pipe[0] >= 0)
+    {
+        close(conn->splice_pipe[0]);
+        close(conn->splice_pipe[1]);
+        conn->splice_pipe[0] = -1;
+        conn->splice_pipe[1] = -1;
+    }
+
+    if (conn->cgi_in_ev.fd >= 0)
+    {
+        close(conn->cgi_in_ev.fd);
+        conn->cgi_in_ev.fd = -1;
+    }
+
+    if (conn->cgi_out_ev.fd >= 0)
+    {
+        close(conn->cgi_out_ev.fd);
+        conn->cgi_out_ev.fd = -1;
+    }
+
+    /* 回复未完成时连接被关闭，也记录访问日志 */
+    if (0 != conn->request_start)
+    {
+        httpd_access_log(conn);
+    }
+
+    /* FastCGI请求数据及CGI输出缓冲区在连接内存池中，随连接对象回收 */
+    conn->fcgi = NULL;
+    conn->cgi_out = NULL;
+    httpd_cgi_flush_cancel(conn);
+
+    /* 归还CGI执行名额 */
+    httpd_cgi_wait_cancel(conn);
+    httpd_cgi_release(conn);
+
+    /* 客户端提前断开时结束仍在运行的CGI程序及其派生的进程(与超时处理相同) */
+    if ((conn->cgi_pid > 0) && !conn->cgi_eof)
+    {
+        kill(-conn->cgi_pid, SIGTERM);
+    }
+
+    httpd_timer_del(&conn->timer);
+
+#ifdef HTTPD_IO_URING
+    httpd_uring_cancel(conn);
+#endif
+
+    close(conn->ev.fd);
+    conn->ev.fd = -1;
+    conn->state = HTTPD_CONN_CLOSE;
+    HTTPD_STAT_ADD(conn->reactor->stats.closed, 1);
+    atomic_fetch_sub_explicit(&g_httpd_admission.active, 1, memory_order_relaxed);
+
+    conn->next = conn->reactor->closed;
+    conn->reactor->closed = conn;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_reset
+ * 功  能:    复位连接的请求数据，准备处理同一连接上的下一个请求
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 请求头数组不再清零
+ *            2026-10-16 changzehai(DTT) 复位连接内存池
+ *            2026-10-16 changzehai(DTT) 复位耗时统计数据
+ *            2026-10-16 changzehai(DTT) 复位访问日志数据
+ *            2026-10-16 changzehai(DTT) 下一个请求重新设置超时
+ *            2026-10-16 changzehai(DTT) 复位CGI请求数据
+ *            2026-10-16 changzehai(DTT) 复位chunked请求体数据
+ *            2026-10-16 changzehai(DTT) 更正CGI程序回收方式的注释
+ ****************************************************************************/
+static void httpd_conn_reset(httpd_conn_t *conn)
+{
+    /* 请求头数组按header_num使用，不需要清零 */
+    memset(&conn->http_data, 0x00, offsetof(http_request_data_t, headers));
+    conn->http_data.content_length = -1;
+    conn->state = HTTPD_CONN_REQUEST_LINE;
+    conn->wpos = 0;
+    conn->wlen = 0;
+    conn->body_left = 0;
+    conn->body_chunked = 0;
+    conn->body_size = 0;
+    conn->range_num = 0;
+    conn->range_idx = 0;
+    conn->encoding = NULL;
+    conn->parse_ns = 0;
+    conn->response_start = 0;
+    conn->request_start = 0;
+    conn->sent = 0;
+    conn->status = 0;
+    conn->timeout = HTTPD_TIMEOUT_NONE; /* 下一个请求的各阶段重新计时 */
+
+    /* CGI请求结束后关闭管道(FastCGI连接)，CGI程序由工作线程事件循环中的
+       waitpid(-1, NULL, WNOHANG)回收 */
+    if (conn->cgi_in_ev.fd >= 0)
+    {
+        close(conn->cgi_in_ev.fd);
+        conn->cgi_in_ev.fd = -1;
+    }
+    if (conn->cgi_out_ev.fd >= 0)
+    {
+        close(conn->cgi_out_ev.fd);
+        conn->cgi_out_ev.fd = -1;
+    }
+    conn->cgi_out_ev.type = HTTPD_EV_CGI_OUTPUT;
+    conn->cgi_pid = -1;
+    conn->cgi_eof = 0;
+    conn->fcgi = NULL;
+    conn->cgi_out = NULL;
+    httpd_cgi_flush_cancel(conn);
+    httpd_arena_reset(&conn->arena);
+
+    /* 流水线请求中已接收的后续请求移到接收缓冲区头部 */
+    memmove(conn->rbuf, conn->rbuf + conn->rpos, conn->rlen - conn->rpos);
+    conn->rlen -= conn->rpos;
+    conn->rpos = 0;
+    conn->keep_alive = 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_arena_alloc
+ * 功  能:    从连接内存池分配内存: 在当前内存块中顺序分配，不够时使用后面
+ *            保留的内存块，都不够时才新建内存块
+ * 输  入:    arena: 连接内存池
+ *            size:  分配大小
+ * 输  出:    无
+ * 返回值:    分配的内存(按max_align_t对齐，不清零)，失败时返回NULL
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void *httpd_arena_alloc(httpd_arena_t *arena, size_t size)
+{
+    httpd_arena_chunk_t *chunk = (NULL != arena->cur) ? arena->cur : arena->head;
+    httpd_arena_chunk_t **tail = &arena->head;
+    size_t chunk_size = 0;
+
+    size = (size + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+
+    for (; NULL != chunk; chunk = chunk->next)
+    {
+        if (chunk->size - chunk->used >= size)
+        {
+            arena->cur = chunk;
+            chunk->used += size;
+            return chunk->data + chunk->used - size;
+        }
+    }
+
+    chunk_size = (size > HTTPD_ARENA_CHUNK) ? size : HTTPD_ARENA_CHUNK;
+    chunk = (httpd_arena_chunk_t *)malloc(sizeof(httpd_arena_chunk_t) + chunk_size);
+    if (NULL == chunk)
+    {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = chunk_size;
+    chunk->used = size;
+
+    while (NULL != *tail)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = chunk;
+    arena->cur = chunk;
+    arena->total += chunk_size;
+
+    return chunk->data;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_arena_reset
+ * 功  能:    复位连接内存池，之前分配的内存全部作废，内存块保留
+ * 输  入:    arena: 连接内存池
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_arena_reset(httpd_arena_t *arena)
+{
+    httpd_arena_chunk_t *chunk = NULL;
+
+    for (chunk = arena->head; NULL != chunk; chunk = chunk->next)
+    {
+        chunk->used = 0;
+    }
+    arena->cur = arena->head;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_arena_release
+ * 功  能:    复位连接内存池，内存块总大小超过保留上限时全部释放，避免偶尔
+ *            的大请求使空闲连接对象长期占用内存
+ * 输  入:    arena: 连接内存池
+ *            keep:  保留上限，0表示全部释放
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_arena_release(httpd_arena_t *arena, size_t keep)
+{
+    httpd_arena_chunk_t *chunk = NULL;
+
+    if (arena->total <= keep)
+    {
+        httpd_arena_reset(arena);
+        return;
+    }
+
+    while (NULL != arena->head)
+    {
+        chunk = arena->head;
+        arena->head = chunk->next;
+        free(chunk);
+    }
+    arena->cur = NULL;
+    arena->total = 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_alloc
+ * 功  能:    取一个连接对象: 优先复用本线程回收的连接对象(连同其内存池)，
+ *            没有时才分配新的。只清零连接状态，不清零收发缓冲区
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    连接对象，失败时返回NULL
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static httpd_conn_t *httpd_conn_alloc(httpd_reactor_t *reactor)
+{
+    httpd_conn_t *conn = reactor->conn_pool;
+
+    if (NULL != conn)
+    {
+        reactor->conn_pool = conn->next;
+        reactor->conn_pool_num--;
+    }
+    else
+    {
+        conn = (httpd_conn_t *)malloc(sizeof(httpd_conn_t));
+        if (NULL == conn)
+        {
+            return NULL;
+        }
+        memset(&conn->arena, 0x00, sizeof(conn->arena));
+    }
+
+    memset(conn, 0x00, offsetof(httpd_conn_t, arena));
+    conn->reactor = reactor;
+
+    return conn;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_recycle
+ * 功  能:    回收连接对象到本线程的空闲连接对象链表，链表已满时释放
+ * 输  入:    conn: 已关闭的连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_conn_recycle(httpd_conn_t *conn)
+{
+    httpd_reactor_t *reactor = conn->reactor;
+
+    if (reactor->conn_pool_num >= HTTPD_CONN_POOL_MAX)
+    {
+        httpd_arena_release(&conn->arena, 0);
+        free(conn);
+        return;
+    }
+
+    httpd_arena_release(&conn->arena, HTTPD_ARENA_KEEP);
+    conn->next = reactor->conn_pool;
+    reactor->conn_pool = conn;
+    reactor->conn_pool_num++;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_timer_init
+ * 功  能:    初始化时间轮，各槽链表头指向自身
+ * 输  入:    wheel: 时间轮
+ *            now:   当前时间(单调时钟秒)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_timer_init(httpd_timer_wheel_t *wheel, time_t now)
+{
+    int level = 0;
+    int slot = 0;
+
+    wheel->now = now;
+    for (level = 0; level < HTTPD_TIMER_LEVELS; level++)
+    {
+        for (slot = 0; slot < HTTPD_TIMER_SLOTS; slot++)
+        {
+            wheel->slots[level][slot].prev = &wheel->slots[level][slot];
+            wheel->slots[level][slot].next = &wheel->slots[level][slot];
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_timer_add
+ * 功  能:    加入定时器: 已到期的定时器在下一秒处理，超出时间轮范围的按最长
+ *            定时处理
+ * 输  入:    wheel:  时间轮
+ *            timer:  定时器(未加入时间轮)
+ *            expire: 到期时间(单调时钟秒)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 放入槽的处理移到httpd_timer_link
+ ****************************************************************************/
+static void httpd_timer_add(httpd_timer_wheel_t *wheel, httpd_timer_t *timer, time_t expire)
+{
+    time_t max = ((time_t)1 << (HTTPD_TIMER_BITS * HTTPD_TIMER_LEVELS)) - 1;
+
+    if (expire <= wheel->now)
+    {
+        expire = wheel->now + 1;
+    }
+    else if (expire - wheel->now > max)
+    {
+        expire = wheel->now + max;
+    }
+
+    timer->expire = expire;
+    httpd_timer_link(wheel, timer);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_timer_link
+ * 功  能:    按到期时间将定时器放入时间轮的槽: 层为到期时间与当前时间不同
+ *            的最高6位组，槽为到期时间在该层的位数。下放时定时器与当前时间
+ *            在该层及以上都相同，只会落入更低的层，不会回到正在下放的槽
+ * 输  入:    wheel: 时间轮
+ *            timer: 定时器(未加入时间轮，expire不早于wheel->now)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_timer_link(httpd_timer_wheel_t *wheel, httpd_timer_t *timer)
+{
+    httpd_timer_t *head = NULL;
+    time_t diff = timer->expire ^ wheel->now;
+    int level = 0;
+
+    while ((level < HTTPD_TIMER_LEVELS - 1) && (0 != (diff >> (HTTPD_TIMER_BITS * (level + 1)))))
+    {
+        level++;
+    }
+
+    head = &wheel->slots[level][(timer->expire >> (HTTPD_TIMER_BITS * level)) & (HTTPD_TIMER_SLOTS - 1)];
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_timer_del
+ * 功  能:    删除定时器，未加入时间轮时不做处理
+ * 输  入:    timer: 定时器
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_timer_del(httpd_timer_t *timer)
+{
+    if (NULL == timer->next)
+    {
+        return;
+    }
+
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_timer_advance
+ * 功  能:    将时间轮逐秒推进到本轮事件循环的时间: 低层转完一圈时把高层对应
+ *            槽中的定时器下放，再处理第0层当前槽中到期的连接
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 先推进当前时间再下放，避免下放的定时器
+ *            回到正在下放的槽中造成死循环
+ ****************************************************************************/
+static void httpd_timer_advance(httpd_reactor_t *reactor)
+{
+    httpd_timer_wheel_t *wheel = &reactor->timers;
+    httpd_timer_t *head = NULL;
+    httpd_timer_t *timer = NULL;
+    time_t tick = 0;
+    int level = 0;
+
+    while (wheel->now < reactor->now)
+    {
+        tick = wheel->now + 1;
+
+        /* 找出本秒需要下放的最高层(低层索引都回到0的层) */
+        for (level = 0; (level < HTTPD_TIMER_LEVELS - 1) &&
+                        (0 == ((tick >> (HTTPD_TIMER_BITS * level)) & (HTTPD_TIMER_SLOTS - 1))); level++)
+        {
+        }
+
+        /* 先推进到tick再从高到低下放，定时器按与tick不同的最高位组落入更低的层，
+           到期时间为tick的定时器落入第0层当前槽 */
+        wheel->now = tick;
+        for (; level > 0; level--)
+        {
+            head = &wheel->slots[level][(tick >> (HTTPD_TIMER_BITS * level)) & (HTTPD_TIMER_SLOTS - 1)];
+            while (head->next != head)
+            {
+                timer = head->next;
+                httpd_timer_del(timer);
+                httpd_timer_link(wheel, timer);
+            }
+        }
+
+        head = &wheel->slots[0][tick & (HTTPD_TIMER_SLOTS - 1)];
+        while (head->next != head)
+        {
+            timer = head->next;
+            httpd_timer_del(timer);
+            httpd_conn_timeout((httpd_conn_t *)((char *)timer - offsetof(httpd_conn_t, timer)));
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_timer_update
+ * 功  能:    按连接当前阶段设置超时定时器，连接等待下一次读写事件前调用:
+ *            请求行及请求头从第一个字节起计总时间，慢速发送请求头的连接无法
+ *            续期；请求体及回复发送在有进展时续期；CGI执行从启动起计总时间
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) chunked编码的请求体按已转发字节数续期
+ ****************************************************************************/
+static void httpd_conn_timer_update(httpd_conn_t *conn)
+{
+    time_t now = conn->reactor->now;
+    time_t expire = conn->timer.expire;
+    long long mark = conn->timeout_mark;
+    int timeout = HTTPD_TIMEOUT_NONE;
+
+    switch (conn->state)
+    {
+        case HTTPD_CONN_REQUEST_LINE:
+        case HTTPD_CONN_REQUEST_HEADER:
+            /* 处理过请求且尚未收到下一个请求的数据时为空闲持久连接 */
+            timeout = ((conn->requests > 0) && (0 == conn->rlen)) ? HTTPD_TIMEOUT_IDLE : HTTPD_TIMEOUT_HEADER;
+            if (timeout != conn->timeout)
+            {
+                expire = now + ((HTTPD_TIMEOUT_IDLE == timeout) ? g_httpd_config.keepalive_timeout
+                                                                : g_httpd_config.header_timeout);
+            }
+            break;
+
+        case HTTPD_CONN_CGI_WAIT:
+            timeout = HTTPD_TIMEOUT_CGI_WAIT;
+            if (timeout != conn->timeout)
+            {
+                expire = now + g_httpd_config.cgi_wait_timeout;
+            }
+            break;
+
+        case HTTPD_CONN_CGI:
+            if ((conn->body_left > 0) || conn->body_chunked)
+            {
+                /* 请求体未收完时按无数据到达超时，但不超过CGI执行截止时间 */
+                timeout = HTTPD_TIMEOUT_BODY;
+                mark = conn->body_size - conn->body_left;
+                if ((timeout != conn->timeout) || (mark != conn->timeout_mark))
+                {
+                    expire = now + g_httpd_config.body_timeout;
+                    if (expire > conn->cgi_deadline)
+                    {
+                        expire = conn->cgi_deadline;
+                    }
+                }
+            }
+            else
+            {
+                timeout = HTTPD_TIMEOUT_CGI;
+                expire = conn->cgi_deadline;
+            }
+            break;
+
+        case HTTPD_CONN_RESPONSE:
+            timeout = HTTPD_TIMEOUT_SEND;
+            mark = conn->sent;
+            if ((timeout != conn->timeout) || (mark != conn->timeout_mark))
+            {
+                expire = now + g_httpd_config.send_timeout;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if ((timeout == conn->timeout) && (expire == conn->timer.expire) && (NULL != conn->timer.next))
+    {
+        conn->timeout_mark = mark;
+        return;
+    }
+
+    httpd_timer_del(&conn->timer);
+    conn->timeout = timeout;
+    conn->timeout_mark = mark;
+    if (HTTPD_TIMEOUT_NONE != timeout)
+    {
+        httpd_timer_add(&conn->reactor->timers, &conn->timer, expire);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_timeout
+ * 功  能:    处理超时的连接: 等待CGI执行名额超时回复503，CGI程序执行超时
+ *            强制结束程序，其余阶段超时直接关闭连接
+ * 输  入:    conn: 客户端连接(定时器已移出时间轮)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_conn_timeout(httpd_conn_t *conn)
+{
+    if (HTTPD_TIMEOUT_CGI_WAIT == conn->timeout)
+    {
+        httpd_cgi_wait_cancel(conn);
+        httpd_request_unavailable_error(conn);
+        conn->state = HTTPD_CONN_RESPONSE;
+        httpd_conn_process(conn);
+        return;
+    }
+
+    /* CGI程序是独立的进程组，连同其派生的进程一起结束 */
+    if (((HTTPD_TIMEOUT_CGI == conn->timeout) || (HTTPD_TIMEOUT_BODY == conn->timeout)) &&
+        (conn->cgi_pid > 0) && !conn->cgi_eof)
+    {
+        kill(-conn->cgi_pid, SIGKILL);
+    }
+
+    HTTPD_STAT_ADD(conn->reactor->stats.timeouts, 1);
+    httpd_conn_close(conn);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_monotonic_time
+ * 功  能:    获取单调时钟秒数，不受系统时间调整影响
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    单调时钟秒数
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static time_t httpd_monotonic_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_monotonic_ns
+ * 功  能:    获取单调时钟纳秒数，用于统计各阶段耗时
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    单调时钟纳秒数
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static long long httpd_monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_hist_index
+ * 功  能:    计算耗时所在的直方图桶: 小于2^4的值每个值一个桶，之后每个2的幂
+ *            区间均分为2^4个桶(HDR直方图的对数-线性分桶，相对误差约6%)
+ * 输  入:    ns: 耗时(纳秒)
+ * 输  出:    无
+ * 返回值:    桶下标
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_hist_index(unsigned long ns)
+{
+    int msb = 0;
+    int shift = 0;
+
+    if (ns < (1UL << HTTPD_HIST_SUB_BITS))
+    {
+        return (int)ns;
+    }
+
+    msb = 63 - __builtin_clzl(ns);
+    if (msb >= HTTPD_HIST_MAX_BITS)
+    {
+        return HTTPD_HIST_BUCKETS - 1;
+    }
+
+    shift = msb - HTTPD_HIST_SUB_BITS;
+    return ((shift + 1) << HTTPD_HIST_SUB_BITS) +
+           (int)((ns >> shift) & ((1UL << HTTPD_HIST_SUB_BITS) - 1));
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_hist_upper
+ * 功  能:    计算直方图桶的上界
+ * 输  入:    idx: 桶下标
+ * 输  出:    无
+ * 返回值:    桶内耗时的上界(纳秒，不含)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static unsigned long httpd_hist_upper(int idx)
+{
+    int shift = (idx >> HTTPD_HIST_SUB_BITS) - 1;
+    unsigned long sub = idx & ((1UL << HTTPD_HIST_SUB_BITS) - 1);
+
+    if (shift < 0)
+    {
+        return (unsigned long)idx + 1;
+    }
+
+    return (((1UL << HTTPD_HIST_SUB_BITS) + sub + 1) << shift);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_stats_record
+ * 功  能:    记录一次阶段耗时。统计数据只由所属工作线程写入，不需要原子的
+ *            读-改-写操作
+ * 输  入:    reactor: 反应堆
+ *            stage:   阶段HTTPD_STAGE_*
+ *            ns:      耗时(纳秒)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_stats_record(httpd_reactor_t *reactor, int stage, long long ns)
+{
+    httpd_hist_t *hist = &reactor->stats.hist[stage];
+    unsigned long value = (ns > 0) ? (unsigned long)ns : 0;
+
+    HTTPD_STAT_ADD(hist->count, 1);
+    HTTPD_STAT_ADD(hist->sum, value);
+    HTTPD_STAT_ADD(hist->buckets[httpd_hist_index(value)], 1);
+    if (value > atomic_load_explicit(&hist->max, memory_order_relaxed))
+    {
+        atomic_store_explicit(&hist->max, value, memory_order_relaxed);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_stats_status
+ * 功  能:    按状态码统计回复数
+ * 输  入:    conn:   客户端连接
+ *            status: 状态码
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 记录回复状态码用于访问日志
+ ****************************************************************************/
+static void httpd_stats_status(httpd_conn_t *conn, int status)
+{
+    conn->status = status;
+    if ((status >= 100) && (status < 600))
+    {
+        HTTPD_STAT_ADD(conn->reactor->stats.status[status - 100], 1);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_stats_snapshot
+ * 功  能:    汇总所有工作线程的统计数据
+ * 输  入:    无
+ * 输  出:    snap: 统计数据汇总
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 汇总访问日志丢弃数
+ *            2026-10-16 changzehai(DTT) 统计超时关闭的连接数
+ *            2026-10-16 changzehai(DTT) 统计拒绝的连接数及暂停accept次数
+ ****************************************************************************/
+static void httpd_stats_snapshot(httpd_stats_snapshot_t *snap)
+{
+    httpd_stats_t *stats = NULL;
+    int w = 0;
+    int i = 0;
+    int j = 0;
+
+#define HTTPD_STAT_GET(counter)  atomic_load_explicit(&(counter), memory_order_relaxed)
+    memset(snap, 0x00, sizeof(*snap));
+    for (w = 0; w < g_httpd_config.worker_num; w++)
+    {
+        stats = &g_httpd_workers[w].reactor.stats;
+        snap->accepted += HTTPD_STAT_GET(stats->accepted);
+        snap->closed += HTTPD_STAT_GET(stats->closed);
+        snap->timeouts += HTTPD_STAT_GET(stats->timeouts);
+        snap->requests += HTTPD_STAT_GET(stats->requests);
+        snap->bytes_sent += HTTPD_STAT_GET(stats->bytes_sent);
+        if (NULL != g_httpd_workers[w].reactor.log)
+        {
+            snap->log_dropped += HTTPD_STAT_GET(g_httpd_workers[w].reactor.log->dropped);
+        }
+        for (i = 0; i < 500; i++)
+        {
+            snap->status[i] += HTTPD_STAT_GET(stats->status[i]);
+        }
+
+        for (i = 0; i < HTTPD_STAGE_NUM; i++)
+        {
+            snap->count[i] += HTTPD_STAT_GET(stats->hist[i].count);
+            snap->sum[i] += HTTPD_STAT_GET(stats->hist[i].sum);
+            if (HTTPD_STAT_GET(stats->hist[i].max) > snap->max[i])
+            {
+                snap->max[i] = HTTPD_STAT_GET(stats->hist[i].max);
+            }
+            for (j = 0; j < HTTPD_HIST_BUCKETS; j++)
+            {
+                snap->buckets[i][j] += HTTPD_STAT_GET(stats->hist[i].buckets[j]);
+            }
+        }
+    }
+    snap->rejected = HTTPD_STAT_GET(g_httpd_admission.rejected);
+    snap->accept_paused = HTTPD_STAT_GET(g_httpd_admission.paused);
+#undef HTTPD_STAT_GET
+
+    /* 各线程的计数不是同一时刻读取的，关闭数可能暂时多于接受数 */
+    if (snap->closed > snap->accepted)
+    {
+        snap->closed = snap->accepted;
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_hist_percentile
+ * 功  能:    从直方图计算百分位耗时
+ * 输  入:    snap:  统计数据汇总
+ *            stage: 阶段HTTPD_STAGE_*
+ *            q:     百分位(0~1)
+ * 输  出:    无
+ * 返回值:    耗时(纳秒，取所在桶的上界，不超过最大值)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static unsigned long httpd_hist_percentile(const httpd_stats_snapshot_t *snap, int stage, double q)
+{
+    unsigned long target = (unsigned long)(q * snap->count[stage] + 0.999999);
+    unsigned long cum = 0;
+    unsigned long upper = 0;
+    int i = 0;
+
+    if (0 == snap->count[stage])
+    {
+        return 0;
+    }
+
+    for (i = 0; i < HTTPD_HIST_BUCKETS; i++)
+    {
+        cum += snap->buckets[stage][i];
+        if ((cum >= target) && (cum > 0))
+        {
+            break;
+        }
+    }
+
+    upper = httpd_hist_upper((i < HTTPD_HIST_BUCKETS) ? i : HTTPD_HIST_BUCKETS - 1);
+    return (upper < snap->max[stage]) ? upper : snap->max[stage];
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_status_text
+ * 功  能:    生成文本格式的服务器状态
+ * 输  入:    snap: 统计数据汇总
+ *            size: 缓冲区大小
+ * 输  出:    buf:  状态页内容
+ * 返回值:    内容长度
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 输出访问日志丢弃数
+ *            2026-10-16 changzehai(DTT) 统计超时关闭的连接数
+ *            2026-10-16 changzehai(DTT) 统计拒绝的连接数及暂停accept次数
+ ****************************************************************************/
+static size_t httpd_status_text(const httpd_stats_snapshot_t *snap, char *buf, size_t size)
+{
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    size_t len = 0;
+    int i = 0;
+    int j = 0;
+
+#define HTTPD_STATUS_PRINT(...) \
+    len += snprintf(buf + len, (len < size) ? size - len : 0, __VA_ARGS__)
+    HTTPD_STATUS_PRINT("uptime_seconds: %ld\n", (long)(httpd_monotonic_time() - g_httpd_start_time));
+    HTTPD_STATUS_PRINT("workers: %d\n", g_httpd_config.worker_num);
+    HTTPD_STATUS_PRINT("connections_accepted: %lu\n", snap->accepted);
+    HTTPD_STATUS_PRINT("connections_active: %lu\n", snap->accepted - snap->closed);
+    HTTPD_STATUS_PRINT("connections_timed_out: %lu\n", snap->timeouts);
+    HTTPD_STATUS_PRINT("connections_limit: %d\n", g_httpd_admission.limit);
+    HTTPD_STATUS_PRINT("connections_rejected: %lu\n", snap->rejected);
+    HTTPD_STATUS_PRINT("accept_paused: %lu\n", snap->accept_paused);
+    HTTPD_STATUS_PRINT("requests: %lu\n", snap->requests);
+    HTTPD_STATUS_PRINT("bytes_sent: %lu\n", snap->bytes_sent);
+    HTTPD_STATUS_PRINT("access_log_dropped: %lu\n", snap->log_dropped);
+    HTTPD_STATUS_PRINT("responses:");
+    for (i = 0; i < 500; i++)
+    {
+        if (0 != snap->status[i])
+        {
+            HTTPD_STATUS_PRINT(" %d=%lu", i + 100, snap->status[i]);
+        }
+    }
+
+    HTTPD_STATUS_PRINT("\n\n%-16s %10s %10s %10s %10s %10s %10s %10s\n", "stage(us)", "count",
+                       "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (i = 0; i < HTTPD_STAGE_NUM; i++)
+    {
+        HTTPD_STATUS_PRINT("%-16s %10lu %10.1f", g_httpd_stage_names[i], snap->count[i],
+                           (0 != snap->count[i]) ? snap->sum[i] / 1000.0 / snap->count[i] : 0.0);
+        for (j = 0; j < (int)(sizeof(quantiles) / sizeof(quantiles[0])); j++)
+        {
+            HTTPD_STATUS_PRINT(" %10.1f", httpd_hist_percentile(snap, i, quantiles[j]) / 1000.0);
+        }
+        HTTPD_STATUS_PRINT(" %10.1f\n", snap->max[i] / 1000.0);
+    }
+#undef HTTPD_STATUS_PRINT
+
+    return (len < size) ? len : size - 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_status_prometheus
+ * 功  能:    生成Prometheus文本格式的服务器状态，阶段耗时按固定边界输出为
+ *            histogram(边界按直方图桶上界近似)
+ * 输  入:    snap: 统计数据汇总
+ *            size: 缓冲区大小
+ * 输  出:    buf:  状态页内容
+ * 返回值:    内容长度
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 输出访问日志丢弃数
+ *            2026-10-16 changzehai(DTT) 统计超时关闭的连接数
+ *            2026-10-16 changzehai(DTT) 统计拒绝的连接数及暂停accept次数
+ ****************************************************************************/
+static size_t httpd_status_prometheus(const httpd_stats_snapshot_t *snap, char *buf, size_t size)
+{
+    static const double bounds[] = {1e-6, 5e-6, 1e-5, 5e-5, 1e-4, 5e-4, 1e-3, 5e-3, 1e-2,
+                                    5e-2, 0.1, 0.5, 1, 5, 10};
+    unsigned long cum = 0;
+    size_t len = 0;
+    int i = 0;
+    int j = 0;
+    int b = 0;
+
+#define HTTPD_STATUS_PRINT(...) \
+    len += snprintf(buf + len, (len < size) ? size - len : 0, __VA_ARGS__)
+    HTTPD_STATUS_PRINT("# TYPE httpd_uptime_seconds gauge\nhttpd_uptime_seconds %ld\n",
+                       (long)(httpd_monotonic_time() - g_httpd_start_time));
+    HTTPD_STATUS_PRINT("# TYPE httpd_workers gauge\nhttpd_workers %d\n", g_httpd_config.worker_num);
+    HTTPD_STATUS_PRINT("# TYPE httpd_connections_accepted_total counter\n"
+                       "httpd_connections_accepted_total %lu\n", snap->accepted);
+    HTTPD_STATUS_PRINT("# TYPE httpd_connections_active gauge\nhttpd_connections_active %lu\n",
+                       snap->accepted - snap->closed);
+    HTTPD_STATUS_PRINT("# TYPE httpd_connections_timed_out_total counter\n"
+                       "httpd_connections_timed_out_total %lu\n", snap->timeouts);
+    HTTPD_STATUS_PRINT("# TYPE httpd_connections_limit gauge\nhttpd_connections_limit %d\n",
+                       g_httpd_admission.limit);
+    HTTPD_STATUS_PRINT("# TYPE httpd_connections_rejected_total counter\n"
+                       "httpd_connections_rejected_total %lu\n", snap->rejected);
+    HTTPD_STATUS_PRINT("# TYPE httpd_accept_paused_total counter\nhttpd_accept_paused_total %lu\n",
+                       snap->accept_paused);
+    HTTPD_STATUS_PRINT("# TYPE httpd_requests_total counter\nhttpd_requests_total %lu\n", snap->requests);
+    HTTPD_STATUS_PRINT("# TYPE httpd_sent_bytes_total counter\nhttpd_sent_bytes_total %lu\n",
+                       snap->bytes_sent);
+    HTTPD_STATUS_PRINT("# TYPE httpd_access_log_dropped_total counter\nhttpd_access_log_dropped_total %lu\n",
+                       snap->log_dropped);
+
+    HTTPD_STATUS_PRINT("# TYPE httpd_responses_total counter\n");
+    for (i = 0; i < 500; i++)
+    {
+        if (0 != snap->status[i])
+        {
+            HTTPD_STATUS_PRINT("httpd_responses_total{code=\"%d\"} %lu\n", i + 100, snap->status[i]);
+        }
+    }
+
+    HTTPD_STATUS_PRINT("# HELP httpd_stage_duration_seconds Time spent in each request processing stage.\n"
+                       "# TYPE httpd_stage_duration_seconds histogram\n");
+    for (i = 0; i < HTTPD_STAGE_NUM; i++)
+    {
+        cum = 0;
+        j = 0;
+        for (b = 0; b < (int)(sizeof(bounds) / sizeof(bounds[0])); b++)
+        {
+            while ((j < HTTPD_HIST_BUCKETS) && (httpd_hist_upper(j) <= (unsigned long)(bounds[b] * 1e9)))
+            {
+                cum += snap->buckets[i][j];
+                j++;
+            }
+            HTTPD_STATUS_PRINT("httpd_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %lu\n",
+                               g_httpd_stage_names[i], bounds[b], cum);
+        }
+        HTTPD_STATUS_PRINT("httpd_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n"
+                           "httpd_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n"
+                           "httpd_stage_duration_seconds_count{stage=\"%s\"} %lu\n",
+                           g_httpd_stage_names[i], snap->count[i],
+                           g_httpd_stage_names[i], snap->sum[i] / 1e9,
+                           g_httpd_stage_names[i], snap->count[i]);
+    }
+#undef HTTPD_STATUS_PRINT
+
+    return (len < size) ? len : size - 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_server_status
+ * 功  能:    回复服务器状态页(GET /server-status，带?format=prometheus时输出
+ *            Prometheus格式)。回复内容放在不加入缓存的缓存项中，复用缓存回复
+ *            的发送流程，发送完后随缓存项释放
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_server_status(httpd_conn_t *conn)
+{
+    int prometheus = (0 == strcmp(conn->http_data.req_line_data.query_string, "format=prometheus"));
+    httpd_stats_snapshot_t *snap = NULL;
+    httpd_cache_entry_t *entry = NULL;
+
+    snap = (httpd_stats_snapshot_t *)httpd_arena_alloc(&conn->arena, sizeof(httpd_stats_snapshot_t));
+    entry = (httpd_cache_entry_t *)calloc(1, sizeof(httpd_cache_entry_t));
+    if ((NULL == snap) || (NULL == entry) || (NULL == (entry->body = (char *)malloc(HTTPD_STATUS_SIZE))))
+    {
+        free(entry);
+        httpd_request_unavailable_error(conn);
+        return;
+    }
+
+    httpd_stats_snapshot(snap);
+    entry->body_len = prometheus ? httpd_status_prometheus(snap, entry->body, HTTPD_STATUS_SIZE) :
+                                   httpd_status_text(snap, entry->body, HTTPD_STATUS_SIZE);
+    entry->header_len = httpd_response_header_format(entry->header, sizeof(entry->header), "200 OK",
+                                                     prometheus ? "text/plain; version=0.0.4" : "text/plain",
+                                                     (long)entry->body_len, NULL, NULL);
+    atomic_init(&entry->refs, 1);
+
+    httpd_stats_status(conn, 200);
+    conn->cache_entry = entry;
+    conn->cache_sent = 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_conn_sent
+ * 功  能:    记录发送给客户端的字节数(服务器统计及本次回复的访问日志)
+ * 输  入:    conn: 客户端连接
+ *            n:    本次发送的字节数
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_conn_sent(httpd_conn_t *conn, ssize_t n)
+{
+    HTTPD_STAT_ADD(conn->reactor->stats.bytes_sent, n);
+    conn->sent += n;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_escape
+ * 功  能:    转义访问日志中来自客户端的字段: Combined格式中双引号、反斜杠
+ *            转义为\"、\\，控制字符转义为\xHH；JSON格式按JSON字符串转义
+ * 输  入:    src:  原字符串
+ *            len:  原字符串长度
+ *            size: 输出缓冲区大小
+ * 输  出:    dst:  转义后的字符串(空间不足时截断，以'\0'结尾)
+ * 返回值:    转义后的长度
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static size_t httpd_log_escape(char *dst, size_t size, const char *src, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char c = 0;
+    size_t n = 0;
+    size_t i = 0;
+
+    for (i = 0; (i < len) && (n + 7 < size); i++)
+    {
+        c = (unsigned char)src[i];
+        if (('"' == c) || ('\\' == c))
+        {
+            dst[n++] = '\\';
+            dst[n++] = c;
+        }
+        else if ((c < 0x20) || (0x7f == c))
+        {
+            if (g_httpd_log.json)
+            {
+                memcpy(dst + n, "\\u00", 4);
+                n += 4;
+            }
+            else
+            {
+                dst[n++] = '\\';
+                dst[n++] = 'x';
+            }
+            dst[n++] = hex[c >> 4];
+            dst[n++] = hex[c & 0x0f];
+        }
+        else
+        {
+            dst[n++] = c;
+        }
+    }
+    dst[n] = '\0';
+
+    return n;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_push
+ * 功  能:    将一条访问日志写入本线程的环形缓冲区(单生产者，无锁)，缓冲区满时
+ *            丢弃并计数；写入后缓冲区超过一半时唤醒日志线程
+ * 输  入:    ring: 访问日志环形缓冲区
+ *            line: 日志
+ *            len:  日志长度
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_log_push(httpd_log_ring_t *ring, const char *line, size_t len)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t off = head & (HTTPD_LOG_RING_SIZE - 1);
+    size_t first = 0;
+    uint64_t one = 1;
+
+    if (HTTPD_LOG_RING_SIZE - (head - tail) < len)
+    {
+        HTTPD_STAT_ADD(ring->dropped, 1);
+        return;
+    }
+
+    first = (len < HTTPD_LOG_RING_SIZE - off) ? len : HTTPD_LOG_RING_SIZE - off;
+    memcpy(ring->buf + off, line, first);
+    memcpy(ring->buf, line + first, len - first);
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+
+    if ((head - tail < HTTPD_LOG_RING_SIZE / 2) && (head + len - tail >= HTTPD_LOG_RING_SIZE / 2))
+    {
+        if (write(g_httpd_log.event_fd, &one, sizeof(one)) < 0)
+        {
+            /* 计数溢出时日志线程本来就会被唤醒，忽略 */
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_access_log
+ * 功  能:    记录一条访问日志(Combined Log Format末尾加处理耗时微秒数，或
+ *            JSON)，请求结束或连接中途关闭时调用。日志在本线程格式化后写入
+ *            环形缓冲区，由日志线程批量写文件，不阻塞工作线程
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_access_log(httpd_conn_t *conn)
+{
+    httpd_reactor_t *reactor = conn->reactor;
+    http_request_line_data_t *line = &conn->http_data.req_line_data;
+    const char *method = (NULL != line->method) ? line->method : "-";
+    const char *query = (NULL != line->query_string) ? line->query_string : "";
+    const char *referer = httpd_request_header(&conn->http_data, HTTPD_HDR_REFERER);
+    const char *agent = httpd_request_header(&conn->http_data, HTTPD_HDR_USER_AGENT);
+    char uri[1024];
+    char args[1024];
+    char ref[512];
+    char ua[512];
+    char buf[HTTPD_LOG_LINE_SIZE];
+    long long duration = (httpd_monotonic_ns() - conn->request_start) / 1000;
+    struct tm tm;
+    time_t now = 0;
+    int len = 0;
+
+    conn->request_start = 0;
+    if (NULL == reactor->log)
+    {
+        return;
+    }
+
+    /* 时间字符串每秒生成一次 */
+    now = time(NULL);
+    if (now != reactor->log_time)
+    {
+        localtime_r(&now, &tm);
+        strftime(reactor->log_date, sizeof(reactor->log_date),
+                 g_httpd_log.json ? "%Y-%m-%dT%H:%M:%S%z" : "%d/%b/%Y:%H:%M:%S %z", &tm);
+        reactor->log_time = now;
+    }
+
+    if (0 == line->uri.len)
+    {
+        strcpy(uri, "-");
+    }
+    else
+    {
+        httpd_log_escape(uri, sizeof(uri), line->uri.data, line->uri.len);
+    }
+    httpd_log_escape(args, sizeof(args), query, strlen(query));
+    httpd_log_escape(ref, sizeof(ref), (NULL != referer) ? referer : "", (NULL != referer) ? strlen(referer) : 0);
+    httpd_log_escape(ua, sizeof(ua), (NULL != agent) ? agent : "", (NULL != agent) ? strlen(agent) : 0);
+
+    if (g_httpd_log.json)
+    {
+        len = snprintf(buf, sizeof(buf),
+                       "{\"time\":\"%s\",\"remote\":\"%s\",\"method\":\"%s\",\"uri\":\"%s\",\"query\":\"%s\","
+                       "\"protocol\":\"HTTP/%d.%d\",\"status\":%d,\"bytes\":%lld,\"referer\":\"%s\","
+                       "\"user_agent\":\"%s\",\"duration_us\":%lld}\n",
+                       reactor->log_date, conn->remote, method, uri, args,
+                       line->http_version / 10, line->http_version % 10, conn->status, conn->sent,
+                       ref, ua, duration);
+    }
+    else
+    {
+        len = snprintf(buf, sizeof(buf),
+                       "%s - - [%s] \"%s %s%s%s HTTP/%d.%d\" %d %lld \"%s\" \"%s\" %lld\n",
+                       ('\0' != conn->remote[0]) ? conn->remote : "-", reactor->log_date, method, uri,
+                       ('\0' != args[0]) ? "?" : "", args, line->http_version / 10,
+                       line->http_version % 10, conn->status, conn->sent,
+                       ('\0' != ref[0]) ? ref : "-", ('\0' != ua[0]) ? ua : "-", duration);
+    }
+
+    /* 超长的日志截断，保留换行 */
+    if (len >= (int)sizeof(buf))
+    {
+        len = sizeof(buf) - 1;
+        buf[len - 1] = '\n';
+    }
+
+    httpd_log_push(reactor->log, buf, len);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_sighup
+ * 功  能:    SIGHUP信号处理: 通知日志线程重新打开日志文件(配合logrotate)
+ * 输  入:    sig: 信号
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_log_sighup(int sig)
+{
+    (void)sig;
+    g_httpd_log.reopen = 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_open
+ * 功  能:    打开访问日志文件，"-"表示标准输出
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    日志文件描述符，失败时返回-1
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_log_open(void)
+{
+    if (0 == strcmp(g_httpd_log.path, "-"))
+    {
+        return STDOUT_FILENO;
+    }
+
+    return open(g_httpd_log.path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_flush
+ * 功  能:    将所有工作线程环形缓冲区中的日志用writev一次写入日志文件(每个
+ *            缓冲区最多两段)，写完后释放缓冲区空间
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_log_flush(void)
+{
+    struct iovec iov[HTTPD_LOG_IOV_MAX];
+    size_t heads[HTTPD_LOG_IOV_MAX / 2];
+    httpd_log_ring_t *ring = NULL;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t off = 0;
+    ssize_t n = 0;
+    int start = 0;
+    int cnt = 0;
+    int w = 0;
+    int i = 0;
+
+    for (start = 0; start < g_httpd_config.worker_num; start += HTTPD_LOG_IOV_MAX / 2)
+    {
+        cnt = 0;
+        for (w = start; (w < g_httpd_config.worker_num) && (w < start + HTTPD_LOG_IOV_MAX / 2); w++)
+        {
+            ring = g_httpd_workers[w].reactor.log;
+            head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            heads[w - start] = head;
+            if (head == tail)
+            {
+                continue;
+            }
+
+            off = tail & (HTTPD_LOG_RING_SIZE - 1);
+            iov[cnt].iov_base = ring->buf + off;
+            iov[cnt].iov_len = (head - tail < HTTPD_LOG_RING_SIZE - off) ? head - tail : HTTPD_LOG_RING_SIZE - off;
+            cnt++;
+            if (iov[cnt - 1].iov_len < head - tail)
+            {
+                iov[cnt].iov_base = ring->buf;
+                iov[cnt].iov_len = head - tail - iov[cnt - 1].iov_len;
+                cnt++;
+            }
+        }
+
+        /* 处理部分写入，写入失败时丢弃本批日志 */
+        i = 0;
+        while (i < cnt)
+        {
+            n = writev(g_httpd_log.fd, iov + i, cnt - i);
+            if (n < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                break;
+            }
+            while ((i < cnt) && ((size_t)n >= iov[i].iov_len))
+            {
+                n -= iov[i].iov_len;
+                i++;
+            }
+            if (i < cnt)
+            {
+                iov[i].iov_base = (char *)iov[i].iov_base + n;
+                iov[i].iov_len -= n;
+            }
+        }
+
+        for (w = start; (w < g_httpd_config.worker_num) && (w < start + HTTPD_LOG_IOV_MAX / 2); w++)
+        {
+            atomic_store_explicit(&g_httpd_workers[w].reactor.log->tail, heads[w - start], memory_order_release);
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_run
+ * 功  能:    日志线程: 定时或被唤醒后批量写出各工作线程的访问日志，收到
+ *            SIGHUP后重新打开日志文件
+ * 输  入:    arg: 未使用
+ * 输  出:    无
+ * 返回值:    NULL
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void *httpd_log_run(void *arg)
+{
+    struct pollfd pfd;
+    uint64_t value = 0;
+    int fd = -1;
+
+    (void)arg;
+    prctl(PR_SET_NAME, "httpd-log");
+
+    pfd.fd = g_httpd_log.event_fd;
+    pfd.events = POLLIN;
+
+    while (1)
+    {
+        if (poll(&pfd, 1, HTTPD_LOG_FLUSH_MS) > 0)
+        {
+            if (read(g_httpd_log.event_fd, &value, sizeof(value)) < 0)
+            {
+                /* eventfd为非阻塞，已被读空 */
+            }
+        }
+
+        httpd_log_flush();
+
+        /* 先写完旧文件中的日志再切换，轮转后的日志不会写入旧文件 */
+        if (g_httpd_log.reopen)
+        {
+            g_httpd_log.reopen = 0;
+            if (STDOUT_FILENO != g_httpd_log.fd)
+            {
+                fd = httpd_log_open();
+                if (fd < 0)
+                {
+                    perror("reopen access log failed");
+                }
+                else
+                {
+                    close(g_httpd_log.fd);
+                    g_httpd_log.fd = fd;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_log_startup
+ * 功  能:    打开访问日志，安装SIGHUP处理，为每个工作线程创建日志环形缓冲区
+ *            并启动日志线程(需在工作线程池创建之后、工作线程处理请求之前调用)
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_log_startup(void)
+{
+    struct sigaction sa;
+    pthread_t tid;
+    int i = 0;
+
+    g_httpd_log.fd = httpd_log_open();
+    if (g_httpd_log.fd < 0)
+    {
+        httpd_error_exit("open access log failed");
+    }
+
+    g_httpd_log.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_httpd_log.event_fd < 0)
+    {
+        httpd_error_exit("eventfd failed");
+    }
+
+    for (i = 0; i < g_httpd_config.worker_num; i++)
+    {
+        g_httpd_workers[i].reactor.log = (httpd_log_ring_t *)calloc(1, sizeof(httpd_log_ring_t));
+        if (NULL == g_httpd_workers[i].reactor.log)
+        {
+            httpd_error_exit("calloc failed");
+        }
+    }
+
+    /* SA_RESTART: 工作线程中被信号打断的系统调用自动重启 */
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_handler = httpd_log_sighup;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, NULL);
+
+    if (pthread_create(&tid, NULL, httpd_log_run, NULL) != 0)
+    {
+        httpd_error_exit("pthread_create failed");
+    }
+    pthread_detach(tid);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_accept_client_request
+ * 功  能:    处理客户端请求: 为新连接创建连接对象并加入epoll
+ * 输  入:    reactor:  反应堆
+ *            client:   客户端socket
+ *            accepted: accept时间(纳秒)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2020-04-12 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 请求处理改由连接状态机完成
+ *            2026-10-16 changzehai(DTT) 复用本线程回收的连接对象
+ *            2026-10-16 changzehai(DTT) 统计accept到接管连接的耗时
+ *            2026-10-16 changzehai(DTT) 记录访问日志时获取客户端IP
+ *            2026-10-16 changzehai(DTT) 超时由时间轮按阶段处理
+ *            2026-10-16 changzehai(DTT) 更新准入控制的连接数
+ ****************************************************************************/
+static void httpd_accept_client_request(httpd_reactor_t *reactor, int client, long long accepted)
+{
+    httpd_conn_t *conn = NULL;
+    struct epoll_event ev;
+    struct sockaddr_in addr;
+    socklen_t addr_len = 0;
+
+
+    conn = httpd_conn_alloc(reactor);
+    if (NULL == conn)
+    {
+        perror("malloc failed");
+        close(client);
+        atomic_fetch_sub_explicit(&g_httpd_admission.active, 1, memory_order_relaxed);
+        return;
+    }
+
+    conn->ev.fd = client;
+    conn->ev.type = HTTPD_EV_CLIENT;
+    conn->ev.conn = conn;
+    conn->cgi_in_ev.fd = -1;
+    conn->cgi_in_ev.type = HTTPD_EV_CGI_INPUT;
+    conn->cgi_in_ev.conn = conn;
+    conn->cgi_out_ev.fd = -1;
+    conn->cgi_out_ev.type = HTTPD_EV_CGI_OUTPUT;
+    conn->cgi_out_ev.conn = conn;
+    conn->state = HTTPD_CONN_REQUEST_LINE;
+    conn->file_fd = -1;
+    conn->splice_pipe[0] = -1;
+    conn->splice_pipe[1] = -1;
+    conn->cgi_pid = -1;
+    conn->http_data.content_length = -1;
+
+    /* 边沿触发，同时关注读写事件 */
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &conn->ev;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client, &ev) < 0)
+    {
+        perror("epoll_ctl failed");
+        close(client);
+        atomic_fetch_sub_explicit(&g_httpd_admission.active, 1, memory_order_relaxed);
+        httpd_conn_recycle(conn);
+        return;
+    }
+
+    HTTPD_STAT_ADD(reactor->stats.accepted, 1);
+    if (NULL != reactor->log)
+    {
+        addr_len = sizeof(addr);
+        if (0 == getpeername(client, (struct sockaddr *)&addr, &addr_len))
+        {
+            inet_ntop(AF_INET, &addr.sin_addr, conn->remote, sizeof(conn->remote));
+        }
+    }
+    httpd_stats_record(reactor, HTTPD_STAGE_ACCEPT, httpd_monotonic_ns() - accepted);
+
+    /* 从连接建立起计接收请求头的超时 */
+    httpd_conn_timer_update(conn);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_ring_init
+ * 功  能:    初始化有界无锁多生产者多消费者(MPMC)环形队列
+ * 输  入:    ring: 环形队列
+ *            size: 队列长度(向上取整为2的幂)
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_ring_init(httpd_ring_t *ring, size_t size)
+{
+    size_t cap = 2;
+    size_t i = 0;
+
+    while (cap < size)
+    {
+        cap <<= 1;
+    }
+
+    ring->cells = (httpd_ring_cell_t *)calloc(cap, sizeof(httpd_ring_cell_t));
+    if (NULL == ring->cells)
+    {
+        return -1;
+    }
+
+    /* 每个单元的序号初始化为其下标，表示可写 */
+    for (i = 0; i < cap; i++)
+    {
+        atomic_init(&ring->cells[i].seq, i);
+    }
+
+    ring->mask = cap - 1;
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_ring_push
+ * 功  能:    将文件描述符放入环形队列
+ * 输  入:    ring:     环形队列
+ *            fd:       文件描述符
+ *            accepted: accept时间(纳秒)
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 队列已满
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 随文件描述符传递accept时间
+ ****************************************************************************/
+static int httpd_ring_push(httpd_ring_t *ring, int fd, long long accepted)
+{
+    httpd_ring_cell_t *cell = NULL;
+    size_t pos = 0;
+    size_t seq = 0;
+    intptr_t diff = 0;
+
+    pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    while (1)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (0 == diff)
+        {
+            /* 单元可写，抢占写位置 */
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->fd = fd;
+    cell->accepted = accepted;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_ring_pop
+ * 功  能:    从环形队列取出文件描述符
+ * 输  入:    ring:     环形队列
+ * 输  出:    accepted: accept时间(纳秒)
+ * 返回值:    >=0: 文件描述符  -1: 队列为空
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 随文件描述符取出accept时间
+ ****************************************************************************/
+static int httpd_ring_pop(httpd_ring_t *ring, long long *accepted)
+{
+    httpd_ring_cell_t *cell = NULL;
+    size_t pos = 0;
+    size_t seq = 0;
+    intptr_t diff = 0;
+    int fd = -1;
+
+    pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    while (1)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (0 == diff)
+        {
+            /* 单元有数据，抢占读位置 */
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    fd = cell->fd;
+    *accepted = cell->accepted;
+    /* 单元序号前进一圈，表示可再次写入 */
+    atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+
+    return fd;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_ring_empty
+ * 功  能:    判断环形队列是否为空(仅作为提示，结果可能立即过时)
+ * 输  入:    ring: 环形队列
+ * 输  出:    无
+ * 返回值:    1: 空  0: 非空
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_ring_empty(httpd_ring_t *ring)
+{
+    return (atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed) >=
+            atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed));
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_worker_notify
+ * 功  能:    唤醒工作线程处理其队列中的新连接
+ * 输  入:    worker: 工作线程
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_worker_notify(httpd_worker_t *worker)
+{
+    uint64_t one = 1;
+
+    if (write(worker->reactor.notify_ev.fd, &one, sizeof(one)) < 0)
+    {
+        /* eventfd计数已满时工作线程必然处于待唤醒状态，忽略即可 */
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_worker_take_connections
+ * 功  能:    取出本线程队列中的新连接并接管，本队列为空时从其他工作线程的
+ *            队列中窃取连接
+ * 输  入:    worker: 工作线程
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 传递accept时间用于耗时统计
+ ****************************************************************************/
+static void httpd_worker_take_connections(httpd_worker_t *worker)
+{
+    httpd_worker_t *victim = NULL;
+    long long accepted = 0;
+    int client = -1;
+    int i = 0;
+    int n = 0;
+
+    while ((client = httpd_ring_pop(&worker->queue, &accepted)) >= 0)
+    {
+        httpd_accept_client_request(&worker->reactor, client, accepted);
+    }
+
+    /* 工作窃取: 其他线程忙于处理事件来不及取走的连接由本线程处理 */
+    for (i = 1; i < g_httpd_config.worker_num; i++)
+    {
+        victim = &g_httpd_workers[(worker->id + i) % g_httpd_config.worker_num];
+
+        for (n = 0; (n < HTTPD_STEAL_BATCH) && !httpd_ring_empty(&victim->queue); n++)
+        {
+            client = httpd_ring_pop(&victim->queue, &accepted);
+            if (client < 0)
+            {
+                break;
+            }
+            httpd_accept_client_request(&worker->reactor, client, accepted);
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_worker_run
+ * 功  能:    工作线程: 运行本线程的epoll事件循环，处理分配给本线程的连接
+ * 输  入:    arg: 工作线程数据
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 处理io_uring完成事件
+ *            2026-10-16 changzehai(DTT) 关闭的连接对象回收复用
+ *            2026-10-16 changzehai(DTT) 超时由时间轮按阶段处理
+ *            2026-10-16 changzehai(DTT) 暂停accept期间缩短等待时间
+ *            2026-10-16 changzehai(DTT) 定时发送缓冲的CGI输出
+ ****************************************************************************/
+static void *httpd_worker_run(void *arg)
+{
+    httpd_worker_t *worker = (httpd_worker_t *)arg;
+    httpd_reactor_t *reactor = &worker->reactor;
+    struct epoll_event events[HTTPD_MAX_EVENTS];
+    httpd_event_t *hev = NULL;
+    httpd_conn_t *conn = NULL;
+    uint64_t count = 0;
+    pid_t pid = 0;
+    int timeout = 0;
+    int n = 0;
+    int i = 0;
+
+    while (1)
+    {
+#ifdef HTTPD_IO_URING
+        /* 本轮填写的io_uring请求一次系统调用提交 */
+        if (NULL != reactor->uring)
+        {
+            httpd_uring_submit(reactor->uring, 0);
+        }
+#endif
+
+        /* 暂停accept期间或有缓冲的CGI输出时缩短等待时间，以便及时处理 */
+        timeout = (0 != reactor->accept_resume) ? HTTPD_ACCEPT_PAUSE_MS : 1000;
+        if ((NULL != reactor->cgi_flush) && (timeout > HTTPD_CGI_FLUSH_MS))
+        {
+            timeout = HTTPD_CGI_FLUSH_MS;
+        }
+        n = epoll_wait(reactor->epoll_fd, events, HTTPD_MAX_EVENTS, timeout);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            httpd_error_exit("epoll_wait failed");
+        }
+
+        reactor->now = httpd_monotonic_time();
+
+        for (i = 0; i < n; i++)
+        {
+            hev = (httpd_event_t *)events[i].data.ptr;
+            if (HTTPD_EV_NOTIFY == hev->type)
+            {
+                while (read(hev->fd, &count, sizeof(count)) > 0)
+                {
+                }
+            }
+            else if (HTTPD_EV_LISTEN == hev->type)
+            {
+                httpd_reactor_accept(reactor);
+            }
+#ifdef HTTPD_IO_URING
+            else if (HTTPD_EV_URING == hev->type)
+            {
+                while (read(hev->fd, &count, sizeof(count)) > 0)
+                {
+                }
+                httpd_reactor_uring_complete(reactor);
+            }
+#endif
+            else if (hev->conn->ev.fd >= 0) /* 跳过本轮已关闭的连接 */
+            {
+                httpd_conn_process(hev->conn);
+            }
+        }
+
+        /* 接管分配给本线程的新连接 */
+        httpd_worker_take_connections(worker);
+
+        /* 启动已分配到名额的CGI请求 */
+        httpd_reactor_cgi_ready(reactor);
+
+        /* 发送缓冲时间已到的CGI输出 */
+        httpd_reactor_cgi_flush(reactor);
+
+        /* 处理各阶段超时的连接 */
+        httpd_timer_advance(reactor);
+
+        /* 暂停时间已到，恢复accept */
+        if ((0 != reactor->accept_resume) && (httpd_monotonic_ns() >= reactor->accept_resume))
+        {
+            httpd_reactor_accept_resume(reactor);
+        }
+
+        /* 释放本轮关闭的连接 */
+        while (NULL != reactor->closed)
+        {
+            conn = reactor->closed;
+            reactor->closed = conn->next;
+#ifdef HTTPD_IO_URING
+            /* 仍有未完成的io_uring请求时，由最后一个完成事件释放 */
+            if (conn->uring_ops > 0)
+            {
+                conn->uring_detached = 1;
+                continue;
+            }
+#endif
+            httpd_conn_recycle(conn);
+        }
+
+        /* 回收已退出的CGI子进程，重启意外退出的FastCGI进程 */
+        while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+        {
+            httpd_fcgi_child_exit(pid);
+        }
+        httpd_fcgi_respawn(reactor->now);
+    }
+
+    return NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_worker_pin_cpu
+ * 功  能:    将工作线程绑定到进程可用CPU中的第(编号 % 可用CPU数)个
+ * 输  入:    worker: 工作线程
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_worker_pin_cpu(httpd_worker_t *worker)
+{
+    cpu_set_t allowed;
+    cpu_set_t set;
+    int target = 0;
+    int cpu = 0;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+    {
+        return;
+    }
+
+    target = worker->id % CPU_COUNT(&allowed);
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &allowed) && (0 == target--))
+        {
+            break;
+        }
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (0 != pthread_setaffinity_np(worker->tid, sizeof(set), &set))
+    {
+        fprintf(stderr, "worker %d: pin to cpu %d failed\n", worker->id, cpu);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_reactor_accept
+ * 功  能:    accept本线程监听socket上的新连接(SO_REUSEPORT模式)。监听socket为
+ *            水平触发，每次最多accept HTTPD_ACCEPT_BATCH个，剩余的下一轮继续
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 记录accept时间
+ *            2026-10-16 changzehai(DTT) 超过连接数上限时回复503，文件描述符耗尽时暂停accept
+ ****************************************************************************/
+static void httpd_reactor_accept(httpd_reactor_t *reactor)
+{
+    int client_sock = -1;
+    int n = 0;
+
+    for (n = 0; n < HTTPD_ACCEPT_BATCH; n++)
+    {
+        client_sock = accept4(reactor->listen_ev.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_sock < 0)
+        {
+            if ((EINTR == errno) || (ECONNABORTED == errno))
+            {
+                continue;
+            }
+            if (httpd_accept_exhausted(errno))
+            {
+                httpd_reactor_accept_pause(reactor);
+            }
+            else if ((EAGAIN != errno) && (EWOULDBLOCK != errno))
+            {
+                perror("accept");
+            }
+            break;
+        }
+
+        if (httpd_admission_check(client_sock) < 0)
+        {
+            continue;
+        }
+        httpd_accept_client_request(reactor, client_sock, httpd_monotonic_ns());
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_reactor_accept_pause
+ * 功  能:    文件描述符耗尽时暂停本线程的accept: 水平触发的监听socket移出
+ *            epoll，避免在无法accept时反复被唤醒
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_reactor_accept_pause(httpd_reactor_t *reactor)
+{
+    atomic_fetch_add_explicit(&g_httpd_admission.paused, 1, memory_order_relaxed);
+    reactor->accept_resume = httpd_monotonic_ns() + HTTPD_ACCEPT_PAUSE_MS * 1000000LL;
+
+#ifdef HTTPD_IO_URING
+    /* multishot accept出错时已结束，恢复时重新提交 */
+    if (reactor->listen_uring)
+    {
+        return;
+    }
+#endif
+
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, reactor->listen_ev.fd, NULL);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_reactor_accept_resume
+ * 功  能:    暂停时间已到，恢复本线程的accept
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_reactor_accept_resume(httpd_reactor_t *reactor)
+{
+    struct epoll_event ev;
+
+    reactor->accept_resume = 0;
+
+#ifdef HTTPD_IO_URING
+    if (reactor->listen_uring)
+    {
+        if (httpd_uring_accept(reactor->uring, reactor->listen_ev.fd) < 0)
+        {
+            reactor->accept_resume = httpd_monotonic_ns() + HTTPD_ACCEPT_PAUSE_MS * 1000000LL;
+        }
+        return;
+    }
+#endif
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &reactor->listen_ev;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->listen_ev.fd, &ev) < 0)
+    {
+        perror("epoll_ctl failed");
+    }
+}
+
+#ifdef HTTPD_IO_URING
+/*****************************************************************************
+ * 函  数:    httpd_uring_create
+ * 功  能:    用io_uring_setup创建io_uring实例并映射提交/完成队列；需要时注册
+ *            接收缓冲区环，由内核在数据到达时选择缓冲区
+ * 输  入:    entries:   提交队列长度
+ *            recv_bufs: 是否注册接收缓冲区环
+ * 输  出:    无
+ * 返回值:    io_uring实例，NULL表示内核不支持或创建失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static httpd_uring_t *httpd_uring_create(unsigned int entries, int recv_bufs)
+{
+    httpd_uring_t *ring = NULL;
+    struct io_uring_params params;
+    struct io_uring_buf_reg reg;
+    unsigned int *sq_array = NULL;
+    size_t cq_size = 0;
+    unsigned int i = 0;
+
+    ring = (httpd_uring_t *)calloc(1, sizeof(httpd_uring_t));
+    if (NULL == ring)
+    {
+        return NULL;
+    }
+
+    /* 每个连接最多同时有3个请求未完成，完成队列留足余量减少溢出 */
+    memset(&params, 0x00, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * HTTPD_URING_CQ_RATIO;
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        free(ring);
+        return NULL;
+    }
+
+    /* 只支持提交队列和完成队列共用一次mmap的内核(5.4及以后) */
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        httpd_uring_destroy(ring);
+        errno = ENOSYS;
+        return NULL;
+    }
+
+    ring->ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (cq_size > ring->ring_size)
+    {
+        ring->ring_size = cq_size;
+    }
+
+    ring->ring = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring->ring)
+    {
+        ring->ring = NULL;
+        httpd_uring_destroy(ring);
+        return NULL;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ring->sqes)
+    {
+        ring->sqes = NULL;
+        httpd_uring_destroy(ring);
+        return NULL;
+    }
+
+    ring->sq_head = (unsigned int *)((char *)ring->ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int *)((char *)ring->ring + params.sq_off.tail);
+    ring->sq_flags = (unsigned int *)((char *)ring->ring + params.sq_off.flags);
+    ring->sq_mask = *(unsigned int *)((char *)ring->ring + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned int *)((char *)ring->ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)((char *)ring->ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int *)((char *)ring->ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->ring + params.cq_off.cqes);
+
+    /* 提交队列项与索引一一对应，按队列尾位置填写 */
+    sq_array = (unsigned int *)((char *)ring->ring + params.sq_off.array);
+    for (i = 0; i < params.sq_entries; i++)
+    {
+        sq_array[i] = i;
+    }
+
+    if (!recv_bufs)
+    {
+        return ring;
+    }
+
+    ring->bufs = (char *)malloc(HTTPD_URING_BUF_NUM * HTTPD_URING_BUF_SIZE);
+    ring->buf_ring = (struct io_uring_buf_ring *)mmap(NULL, HTTPD_URING_BUF_NUM * sizeof(struct io_uring_buf),
+                                                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == (void *)ring->buf_ring)
+    {
+        ring->buf_ring = NULL;
+    }
+
+    memset(&reg, 0x00, sizeof(reg));
+    reg.ring_addr = (uintptr_t)ring->buf_ring;
+    reg.ring_entries = HTTPD_URING_BUF_NUM;
+    reg.bgid = HTTPD_URING_BGID;
+    if ((NULL == ring->bufs) || (NULL == ring->buf_ring) ||
+        (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0))
+    {
+        /* 内核不支持缓冲区环(5.19以前)时，请求仍由epoll通知后recv读取 */
+        if (NULL != ring->buf_ring)
+        {
+            munmap(ring->buf_ring, HTTPD_URING_BUF_NUM * sizeof(struct io_uring_buf));
+            ring->buf_ring = NULL;
+        }
+        free(ring->bufs);
+        ring->bufs = NULL;
+        return ring;
+    }
+
+    for (i = 0; i < HTTPD_URING_BUF_NUM; i++)
+    {
+        httpd_uring_buf_recycle(ring, i);
+    }
+
+    return ring;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_destroy
+ * 功  能:    解除共享内存映射并关闭io_uring实例
+ * 输  入:    ring: io_uring实例
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_uring_destroy(httpd_uring_t *ring)
+{
+    if (NULL != ring->buf_ring)
+    {
+        munmap(ring->buf_ring, HTTPD_URING_BUF_NUM * sizeof(struct io_uring_buf));
+    }
+    free(ring->bufs);
+
+    if (NULL != ring->sqes)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (NULL != ring->ring)
+    {
+        munmap(ring->ring, ring->ring_size);
+    }
+
+    close(ring->fd);
+    free(ring);
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_submit
+ * 功  能:    发布已填写的提交队列项并用一次io_uring_enter提交
+ * 输  入:    ring:    io_uring实例
+ *            wait_nr: 等待的完成事件数，0表示不等待
+ * 输  出:    无
+ * 返回值:    >=0: 提交的请求数  -1: 失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_uring_submit(httpd_uring_t *ring, unsigned int wait_nr)
+{
+    unsigned int pending = 0;
+    int ret = 0;
+
+    /* 提交队列项写完后再更新队列尾，内核看到新的队列尾时数据已可见 */
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+    pending = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if ((0 == pending) && (0 == wait_nr))
+    {
+        return 0;
+    }
+
+    do
+    {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, pending, wait_nr,
+                           (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while ((ret < 0) && (EINTR == errno));
+
+    return ret;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_reserve
+ * 功  能:    确保提交队列至少有n个空位，不足时先提交已填写的请求。一组链接的
+ *            请求必须填写在同一次提交中
+ * 输  入:    ring: io_uring实例
+ *            n:    需要的空位数
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 提交队列已满
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_uring_reserve(httpd_uring_t *ring, unsigned int n)
+{
+    if (ring->sq_entries - (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE)) >= n)
+    {
+        return 0;
+    }
+
+    httpd_uring_submit(ring, 0);
+
+    return (ring->sq_entries - (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE)) >= n) ? 0 : -1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_get_sqe
+ * 功  能:    取一个清零的提交队列项(调用前需用httpd_uring_reserve保留空位)
+ * 输  入:    ring:      io_uring实例
+ *            user_data: 请求标识，原样带回完成事件
+ * 输  出:    无
+ * 返回值:    提交队列项
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static struct io_uring_sqe *httpd_uring_get_sqe(httpd_uring_t *ring, __u64 user_data)
+{
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+
+    ring->sqe_tail++;
+    memset(sqe, 0x00, sizeof(*sqe));
+    sqe->user_data = user_data;
+
+    return sqe;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_peek
+ * 功  能:    从完成队列取出一个完成事件，完成队列曾溢出时先取回内核暂存的事件
+ * 输  入:    ring: io_uring实例
+ * 输  出:    cqe:  完成事件
+ * 返回值:    1: 取到完成事件  0: 完成队列为空
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_uring_peek(httpd_uring_t *ring, struct io_uring_cqe *cqe)
+{
+    unsigned int head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        /* 完成队列溢出时内核暂存的完成事件，要通过io_uring_enter取回 */
+        if (!(__atomic_load_n(ring->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW))
+        {
+            return 0;
+        }
+
+        syscall(__NR_io_uring_enter, ring->fd, 0, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            return 0;
+        }
+    }
+
+    cqe->user_data = ring->cqes[head & ring->cq_mask].user_data;
+    cqe->res = ring->cqes[head & ring->cq_mask].res;
+    cqe->flags = ring->cqes[head & ring->cq_mask].flags;
+
+    /* 读完后再归还完成队列项 */
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_buf_recycle
+ * 功  能:    将接收缓冲区放回缓冲区环，供内核选择
+ * 输  入:    ring: io_uring实例
+ *            bid:  缓冲区编号
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_uring_buf_recycle(httpd_uring_t *ring, int bid)
+{
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (HTTPD_URING_BUF_NUM - 1)];
 
+    buf->addr = (uintptr_t)(ring->bufs + (size_t)bid * HTTPD_URING_BUF_SIZE);
+    buf->len = HTTPD_URING_BUF_SIZE;
+    buf->bid = (__u16)bid;
 
-/*-----------------------------------*/
-/* 宏定义                            */
-/*-----------------------------------*/
-#define SERVER_STRING "Server: httpd/1.0.0\r\n" /* 定义http server名称 */
+    ring->buf_tail++;
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
 
-/*-----------------------------------*/
-/* 数据结构定义                       */
-/*-----------------------------------*/
-/* HTTP请求行数据结构定义 */
-typedef struct __HTTP_REQUEST_LINE_DATA_T_
+/*****************************************************************************
+ * 函  数:    httpd_uring_accept
+ * 功  能:    提交multishot accept: 一次提交，每个新连接产生一个完成事件
+ * 输  入:    ring:      io_uring实例
+ *            listen_fd: 监听socket
+ * 输  出:    无
+ * 返回值:    0: 成功  -1: 提交队列已满
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_uring_accept(httpd_uring_t *ring, int listen_fd)
 {
-    char method[10];        /* 请求方法                */
-    char path[255];         /* 请求资源路径            */
-    char query_string[255]; /* 查询参数， 仅GET命令有效 */
-    int  cgi;               /* 是否需要执行CGI程序标志  */
-} http_request_line_data_t;
+    struct io_uring_sqe *sqe = NULL;
 
-/* HTTP请求数据结构定义 */
-typedef struct __HTTP_REQUEST_DATA_T_
+    if (httpd_uring_reserve(ring, 1) < 0)
+    {
+        return -1;
+    }
+
+    sqe = httpd_uring_get_sqe(ring, HTTPD_URING_DATA(NULL, HTTPD_URING_ACCEPT));
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    httpd_uring_recv
+ * 功  能:    为连接提交接收请求，由内核在数据到达时从缓冲区环中选择缓冲区，
+ *            等待中的连接不占用接收缓冲区
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void httpd_uring_recv(httpd_conn_t *conn)
 {
-    http_request_line_data_t req_line_data;  /* 请求行数据    */
-    int content_length;                      /* 请求体数据长度 */
-} http_request_data_t;
+    httpd_uring_t *ring = conn->reactor->uring;
+    struct io_uring_sqe *sqe = NULL;
+    int space = (int)sizeof(conn->rbuf) - conn->rlen;
 
-/*-----------------------------------*/
-/* 函数声明                          */
-/*-----------------------------------*/
-/* 记录错误信息并关闭服务器程序 */
-static void httpd_error_exit(const char *error); 
+    /* 不支持时由epoll通知后recv读取 */
+    if ((NULL == ring) || (NULL == ring->buf_ring) || (space <= 0) || (httpd_uring_reserve(ring, 1) < 0))
+    {
+        return;
+    }
 
-/* 创建TCP服务监听 */
-static int httpd_server_startup(void);
+    sqe = httpd_uring_get_sqe(ring, HTTPD_URING_DATA(conn, HTTPD_URING_RECV));
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->ev.fd;
+    sqe->len = (space < HTTPD_URING_BUF_SIZE) ? space : HTTPD_URING_BUF_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = HTTPD_URING_BGID;
 
-/* 获取一行HTTP报文 */
-static int httpd_get_line_message(int sock, char *buf, int size);
+    conn->uring_recv = 1;
+    conn->uring_ops++;
+}
 
-/* 解析HTTP报文的请求行 */
-static void httpd_request_line_analyze(int client_sock, http_request_line_data_t *req_line_data);
+/*****************************************************************************
+ * 函  数:    httpd_uring_send_file
+ * 功  能:    用io_uring发送静态文件: 文件->管道、等待socket可写、管道->socket
+ *            三个请求链接后一次提交，完成后由完成事件继续处理连接
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 文件发送完毕  0: 等待完成事件  -1: 出错
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int httpd_uring_send_file(httpd_conn_t *conn)
+{
+    httpd_uring_t *ring = conn->reactor->uring;
+    struct io_uring_sqe *sqe = NULL;
+    size_t count = 0;
+    int more = 0;
 
-/* 解析HTTP报文的请求头 */
-static void httpd_request_header_analyze(int client_sock, const char *method, int *content_length);
+    if (conn->uring_file > 0)
+    {
+        return 0;
+    }
 
-/* 返回请求方法错误信息给客户端 */
-static void httpd_request_method_error(int client);
+    if (conn->uring_error)
+    {
+        return -1;
+    }
 
-/* 返回请求资源路径错误给客户端 */
-static void httpd_request_path_error(int client);
+    if ((0 == conn->file_left) && (0 == conn->splice_len))
+    {
+        return 1;
+    }
 
-/* 返回不能执行CGI程序错误给客户端 */
-static void httpd_request_cannot_execute_error(int client);
+    if (conn->splice_pipe[0] < 0)
+    {
+        if (pipe2(conn->splice_pipe, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            conn->splice_pipe[0] = -1;
+            conn->splice_pipe[1] = -1;
+            return -1;
+        }
 
-/* 返回HTTP坏请求错误(content_lenght有误) */
-static void httpd_request_bad_error(int client);
+        /* 管道越大每次往返发送的数据越多 */
+        fcntl(conn->splice_pipe[1], F_SETPIPE_SZ, HTTPD_SENDFILE_CHUNK);
+    }
 
-/* 检查并处理HTTP请求错误 */
-static int  httpd_request_error_deal(int client, http_request_data_t *h_data);
+    if (conn->splice_pipe_size <= 0)
+    {
+        conn->splice_pipe_size = fcntl(conn->splice_pipe[1], F_GETPIPE_SZ);
+    }
 
-/* 发送回复报文头 */
-static void httpd_response_header(int client);
+    /* 提交队列已满时直接发送 */
+    if ((conn->splice_pipe_size <= 0) || (httpd_uring_reserve(ring, 3) < 0))
+    {
+        return httpd_conn_sendfile(conn);
+    }
 
-/* 返回静态请求文件给客户端 */
-static void httpd_send_file(int client, const char *filename);
+    /* 管道已空，从文件读入下一段(不超过管道容量，避免阻塞) */
+    if (0 == conn->splice_len)
+    {
+        count = (conn->file_left < conn->splice_pipe_size) ? (size_t)conn->file_left : (size_t)conn->splice_pipe_size;
+        sqe = httpd_uring_get_sqe(ring, HTTPD_URING_DATA(conn, HTTPD_URING_SPLICE_IN));
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->fd = conn->splice_pipe[1];
+        sqe->off = (__u64)-1;
+        sqe->splice_fd_in = conn->file_fd;
+        sqe->splice_off_in = conn->file_offset;
+        sqe->len = count;
+        sqe->splice_flags = SPLICE_F_MOVE;
+        sqe->flags = IOSQE_IO_LINK;
+        conn->uring_file++;
+    }
+    else
+    {
+        count = conn->splice_len;
+    }
+    more = (conn->file_left > ((0 == conn->splice_len) ? (off_t)count : 0));
 
-/* 执行CGI程序处理HTTP请求，并将处理结果发送回客户端 */
-static void httpd_execute_cgi(int client, http_request_data_t *h_data);
+    sqe = httpd_uring_get_sqe(ring, HTTPD_URING_DATA(conn, HTTPD_URING_POLL_OUT));
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = conn->ev.fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->flags = IOSQE_IO_LINK;
 
-/* 处理客户端请求 */
-static void *httpd_accept_client_request(void *from_client);
+    /* 读入管道的数据不足count时，splice读完管道中已有的数据即返回 */
+    sqe = httpd_uring_get_sqe(ring, HTTPD_URING_DATA(conn, HTTPD_URING_SPLICE_OUT));
+    sqe->opcode = IORING_OP_SPLICE;
+    sqe->fd = conn->ev.fd;
+    sqe->off = (__u64)-1;
+    sqe->splice_fd_in = conn->splice_pipe[0];
+    sqe->splice_off_in = (__u64)-1;
+    sqe->len = count;
+    sqe->splice_flags = SPLICE_F_MOVE | (more ? SPLICE_F_MORE : 0);
 
+    conn->uring_file += 2;
+    conn->uring_ops += conn->uring_file;
+
+    return 0;
+}
 
 /*****************************************************************************
- * 函  数:    httpd_error_exit
- * 功  能:    记录错误信息并关闭服务器程序
- * 输  入:    无
+ * 函  数:    httpd_uring_cancel
+ * 功  能:    取消连接尚未完成的io_uring请求。关闭文件描述符不会结束已提交的
+ *            请求，连接内存要等到所有完成事件返回后才能释放
+ * 输  入:    conn: 客户端连接
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
  * 更  新:    无
  ****************************************************************************/
-static void httpd_error_exit(const char *error)
+static void httpd_uring_cancel(httpd_conn_t *conn)
 {
-    perror(error);
-    exit(1);
-}
+    static const int ops[] = {HTTPD_URING_RECV, HTTPD_URING_SPLICE_IN, HTTPD_URING_POLL_OUT, HTTPD_URING_SPLICE_OUT};
+    httpd_uring_t *ring = conn->reactor->uring;
+    struct io_uring_sqe *sqe = NULL;
+    size_t i = 0;
+
+    if ((NULL == ring) || (0 == conn->uring_ops))
+    {
+        return;
+    }
 
+    for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+    {
+        if (((HTTPD_URING_RECV == ops[i]) ? conn->uring_recv : conn->uring_file) &&
+            (0 == httpd_uring_reserve(ring, 1)))
+        {
+            sqe = httpd_uring_get_sqe(ring, HTTPD_URING_DATA(NULL, HTTPD_URING_CANCEL));
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = HTTPD_URING_DATA(conn, ops[i]);
+        }
+    }
+}
 
 /*****************************************************************************
- * 函  数:    httpd_server_startup
- * 功  能:    创建TCP服务监听
- * 输  入:    无
+ * 函  数:    httpd_reactor_uring_init
+ * 功  能:    为反应堆创建io_uring，完成事件通过eventfd通知epoll，与其他事件在
+ *            同一个循环中处理。内核不支持时保持使用epoll+非阻塞调用
+ * 输  入:    reactor: 反应堆
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
  * 更  新:    无
  ****************************************************************************/
-static int httpd_server_startup(void)
+static void httpd_reactor_uring_init(httpd_reactor_t *reactor)
 {
-    int server_sock = -1;
-    int on = 1;
-    struct sockaddr_in server_addr;
+    struct epoll_event ev;
 
-    server_sock = socket(PF_INET, SOCK_STREAM, 0);
-    if (-1 == server_sock)
+    reactor->uring = httpd_uring_create(HTTPD_URING_ENTRIES, 1);
+    if (NULL == reactor->uring)
     {
-        httpd_error_exit("socket failed");
+        perror("io_uring_setup failed, using epoll");
+        return;
     }
 
-    memset(&server_addr, 0x00, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(8000);
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    reactor->uring_ev.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reactor->uring_ev.type = HTTPD_EV_URING;
 
-    if (setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0)
+    ev.events = EPOLLIN;
+    ev.data.ptr = &reactor->uring_ev;
+    if ((reactor->uring_ev.fd < 0) ||
+        (syscall(__NR_io_uring_register, reactor->uring->fd, IORING_REGISTER_EVENTFD, &reactor->uring_ev.fd, 1) < 0) ||
+        (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->uring_ev.fd, &ev) < 0))
     {
-        httpd_error_exit("setsockopt failed");
+        perror("io_uring eventfd failed, using epoll");
+        if (reactor->uring_ev.fd >= 0)
+        {
+            close(reactor->uring_ev.fd);
+            reactor->uring_ev.fd = -1;
+        }
+        httpd_uring_destroy(reactor->uring);
+        reactor->uring = NULL;
     }
+}
 
-    if (bind(server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
-    {
-        httpd_error_exit("bind failed");
-    }
+/*****************************************************************************
+ * 函  数:    httpd_reactor_uring_complete
+ * 功  能:    处理反应堆io_uring的完成事件: 接管新连接、将收到的数据放入连接
+ *            接收缓冲区、更新文件发送进度，然后继续处理连接
+ * 输  入:    reactor: 反应堆
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 关闭的连接对象回收复用
+ *            2026-10-16 changzehai(DTT) 统计发送字节数
+ *            2026-10-16 changzehai(DTT) 发送字节数同时计入访问日志
+ *            2026-10-16 changzehai(DTT) 超过连接数上限时回复503，文件描述符耗尽时暂停accept
+ ****************************************************************************/
+static void httpd_reactor_uring_complete(httpd_reactor_t *reactor)
+{
+    httpd_uring_t *ring = reactor->uring;
+    struct io_uring_cqe cqe;
+    struct epoll_event ev;
+    httpd_conn_t *conn = NULL;
+    int bid = 0;
+    int op = 0;
 
-    if (listen(server_sock, 5) < 0)
+    while (httpd_uring_peek(ring, &cqe))
     {
-        httpd_error_exit("listen failed");
-    }
+        op = (int)(cqe.user_data & HTTPD_URING_OP_MASK);
+        conn = (httpd_conn_t *)(uintptr_t)(cqe.user_data & ~(__u64)HTTPD_URING_OP_MASK);
 
-    return (server_sock);
-}
+        if (HTTPD_URING_ACCEPT == op)
+        {
+            if (cqe.res >= 0)
+            {
+                if (0 == httpd_admission_check(cqe.res))
+                {
+                    httpd_accept_client_request(reactor, cqe.res, httpd_monotonic_ns());
+                }
+            }
+            else if (-EINVAL == cqe.res)
+            {
+                /* 内核不支持multishot accept(5.19以前)，改由epoll通知后accept */
+                reactor->listen_uring = 0;
+                ev.events = EPOLLIN;
+                ev.data.ptr = &reactor->listen_ev;
+                if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->listen_ev.fd, &ev) < 0)
+                {
+                    httpd_error_exit("epoll_ctl failed");
+                }
+                continue;
+            }
+            else if (httpd_accept_exhausted(-cqe.res))
+            {
+                /* 文件描述符耗尽，暂停一段时间后再重新提交 */
+                if (!(cqe.flags & IORING_CQE_F_MORE))
+                {
+                    httpd_reactor_accept_pause(reactor);
+                    continue;
+                }
+            }
+            else if ((-ECONNABORTED != cqe.res) && (-EINTR != cqe.res) && (-EAGAIN != cqe.res))
+            {
+                fprintf(stderr, "accept: %s\n", strerror(-cqe.res));
+            }
+
+            /* 出错或内核中止时multishot accept结束，需要重新提交 */
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+            {
+                httpd_uring_accept(ring, reactor->listen_ev.fd);
+            }
+            continue;
+        }
+
+        if (HTTPD_URING_CANCEL == op)
+        {
+            continue;
+        }
+
+        conn->uring_ops--;
+
+        switch (op)
+        {
+            case HTTPD_URING_RECV:
+                conn->uring_recv = 0;
+                if (cqe.flags & IORING_CQE_F_BUFFER)
+                {
+                    /* 提交时请求长度不超过接收缓冲区剩余空间，期间剩余空间只会变大 */
+                    bid = (int)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    if ((cqe.res > 0) && (conn->ev.fd >= 0))
+                    {
+                        memcpy(conn->rbuf + conn->rlen, ring->bufs + (size_t)bid * HTTPD_URING_BUF_SIZE, cqe.res);
+                        conn->rlen += cqe.res;
+                    }
+                    httpd_uring_buf_recycle(ring, bid);
+                }
+                else if ((0 == cqe.res) ||
+                         ((cqe.res < 0) && (-ENOBUFS != cqe.res) && (-ECANCELED != cqe.res) && (-EINTR != cqe.res)))
+                {
+                    /* 客户端关闭连接或出错；缓冲区用完时改由recv读取 */
+                    conn->uring_error = 1;
+                }
+                break;
+
+            case HTTPD_URING_SPLICE_IN:
+                conn->uring_file--;
+                if (cqe.res > 0)
+                {
+                    conn->file_offset += cqe.res;
+                    conn->file_left -= cqe.res;
+                    conn->splice_len += cqe.res;
+                }
+                else if (-ECANCELED != cqe.res)
+                {
+                    /* 0表示文件在发送过程中被截短，已无法满足Content-Length */
+                    conn->uring_error = 1;
+                }
+                break;
+
+            case HTTPD_URING_POLL_OUT:
+                conn->uring_file--;
+                break;
 
+            case HTTPD_URING_SPLICE_OUT:
+                /* 前面的请求读入数据不足时链接被中断，剩余数据下次继续发送 */
+                conn->uring_file--;
+                if (cqe.res > 0)
+                {
+                    conn->splice_len -= cqe.res;
+                    httpd_conn_sent(conn, cqe.res);
+                }
+                else if ((cqe.res < 0) && (-ECANCELED != cqe.res) && (-EAGAIN != cqe.res) && (-EINTR != cqe.res))
+                {
+                    conn->uring_error = 1;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (conn->ev.fd < 0)
+        {
+            if ((0 == conn->uring_ops) && conn->uring_detached)
+            {
+                httpd_conn_recycle(conn);
+            }
+        }
+        else if ((HTTPD_URING_RECV == op) || (0 == conn->uring_file))
+        {
+            httpd_conn_process(conn);
+        }
+    }
+}
 
 /*****************************************************************************
- * 函  数:    httpd_get_line_message
- * 功  能:    获取一行HTTP报文
- * 输  入:    无
+ * 函  数:    httpd_uring_accept_connections
+ * 功  能:    用io_uring multishot accept接受客户端连接并分配给工作线程，一次
+ *            io_uring_enter可返回一批新连接
+ * 输  入:    server_sock: 监听socket
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
+ * 返回值:    -1: 内核不支持，应改用poll+accept
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 超过连接数上限时回复503，文件描述符耗尽时暂停accept
  ****************************************************************************/
-static int httpd_get_line_message(int sock, char *buf, int size)
+static int httpd_uring_accept_connections(int server_sock)
 {
+    httpd_uring_t *ring = NULL;
+    httpd_worker_t *worker = NULL;
+    struct io_uring_cqe cqe;
+    int paused = 0;
     int i = 0;
-    int n = 0;
-    char c = '\0';
 
-    while ((i < size - 1) && (c != '\n'))
+    ring = httpd_uring_create(HTTPD_URING_ENTRIES, 0);
+    if (NULL == ring)
     {
-        n = recv(sock, &c, 1, 0);
-        if (n > 0)
+        perror("io_uring_setup failed, using accept");
+        return -1;
+    }
+
+    httpd_uring_accept(ring, server_sock);
+
+    while (1)
+    {
+        if (httpd_uring_submit(ring, 1) < 0)
         {
-            if (c == '\r')
+            httpd_error_exit("io_uring_enter failed");
+        }
+
+        /* 同一批连接只唤醒一次对应的工作线程 */
+        while (httpd_uring_peek(ring, &cqe))
+        {
+            if (cqe.res >= 0)
             {
-                n = recv(sock, &c, 1, MSG_PEEK);
-                if ((n > 0) && (c == '\n'))
+                if (httpd_admission_check(cqe.res) < 0)
                 {
-                    recv(sock, &c, 1, 0);
+                    continue;
                 }
-                else
+                worker = httpd_dispatch_connection(cqe.res);
+                worker->notified = 1;
+            }
+            else if (-EINVAL == cqe.res)
+            {
+                fprintf(stderr, "io_uring multishot accept not supported, using accept\n");
+                httpd_uring_destroy(ring);
+                return -1;
+            }
+            else if (httpd_accept_exhausted(-cqe.res))
+            {
+                /* 文件描述符耗尽，唤醒工作线程后暂停一段时间再重新提交 */
+                if (!(cqe.flags & IORING_CQE_F_MORE))
                 {
-                    c = '\n';
+                    paused = 1;
+                    continue;
                 }
-                
             }
+            else if ((-ECONNABORTED != cqe.res) && (-EINTR != cqe.res) && (-EAGAIN != cqe.res))
+            {
+                errno = -cqe.res;
+                httpd_error_exit("accept");
+            }
+
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+            {
+                httpd_uring_accept(ring, server_sock);
+            }
+        }
 
-            buf[i] = c;
-            i++;
+        for (i = 0; i < g_httpd_config.worker_num; i++)
+        {
+            worker = &g_httpd_workers[i];
+            if (worker->notified)
+            {
+                worker->notified = 0;
+                httpd_worker_notify(worker);
+            }
         }
-        else
+
+        if (paused)
         {
-            c = '\n';
+            paused = 0;
+            atomic_fetch_add_explicit(&g_httpd_admission.paused, 1, memory_order_relaxed);
+            usleep(HTTPD_ACCEPT_PAUSE_MS * 1000);
+            httpd_uring_accept(ring, server_sock);
         }
     }
 
-    buf[i] = '\0';
-    
-    return(i);
+    return 0;
 }
+#endif
 
 /*****************************************************************************
- * 函  数:    httpd_request_line_analyze
- * 功  能:    解析HTTP报文的请求行
+ * 函  数:    httpd_worker_pool_startup
+ * 功  能:    创建工作线程池，每个线程拥有独立的epoll反应堆和连接队列；
+ *            SO_REUSEPORT模式下每个线程还拥有自己的监听socket
  * 输  入:    无
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 增加SO_REUSEPORT监听及CPU绑定
+ *            2026-10-16 changzehai(DTT) 可选为每个线程创建io_uring
+ *            2026-10-16 changzehai(DTT) 访问日志在工作线程启动前初始化
+ *            2026-10-16 changzehai(DTT) 初始化时间轮
+ *            2026-10-16 changzehai(DTT) 记录监听socket是否由io_uring accept
+ *            2026-10-16 changzehai(DTT) 分配路径缓存
  ****************************************************************************/
-static void httpd_request_line_analyze(int client_sock, http_request_line_data_t *req_line_data)
+static void httpd_worker_pool_startup(void)
 {
+    httpd_worker_t *worker = NULL;
+    struct epoll_event ev;
+    int i = 0;
 
-    char buf[1024] = {0};
-    char url[255] = {0};
-    char *query_string = NULL;
-    size_t i = 0;
-    size_t j = 0;
-
-    i = 0;
-    j = 0;
-
-    httpd_get_line_message(client_sock, buf, sizeof(buf));
-
-    while (!isspace((int)buf[j]) && (i < (sizeof(req_line_data->method) - 1)))
+    g_httpd_workers = (httpd_worker_t *)calloc(g_httpd_config.worker_num, sizeof(httpd_worker_t));
+    if (NULL == g_httpd_workers)
     {
-        req_line_data->method[i] = buf[j];
-        i++;
-        j++;
+        httpd_error_exit("calloc failed");
     }
-    req_line_data->method[i] = '\0';
 
-    i = 0;
-    /* 将method后面的后边的空白字符略过 */
-    while(isspace((int)buf[j]) && (j < sizeof(buf)))
+    for (i = 0; i < g_httpd_config.worker_num; i++)
     {
-        j++;
-    }
+        worker = &g_httpd_workers[i];
+        worker->id = i;
+        worker->reactor.now = httpd_monotonic_time();
+        httpd_timer_init(&worker->reactor.timers, worker->reactor.now);
+        worker->reactor.paths = (httpd_path_entry_t *)calloc(HTTPD_PATH_CACHE_SIZE, sizeof(httpd_path_entry_t));
+        if (NULL == worker->reactor.paths)
+        {
+            httpd_error_exit("calloc failed");
+        }
 
-    /* 继续读取request-URL */
-    while (!isspace((int)buf[j]) && (i < sizeof(url) - 1) && (j < sizeof(buf)))
-    {
-        url[i] = buf[j];
-        i++; 
-        j++;
-    }
-    url[i] = '\0';
+        if (httpd_ring_init(&worker->queue, g_httpd_config.queue_size) < 0)
+        {
+            httpd_error_exit("httpd_ring_init failed");
+        }
 
-    if (0 == strcasecmp(req_line_data->method, "GET"))
-    {
-        query_string = url;
-        
-        while ((*query_string != '?') && (*query_string != '\0'))
+        worker->reactor.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (worker->reactor.epoll_fd < 0)
         {
-            query_string++;
+            httpd_error_exit("epoll_create1 failed");
         }
 
-        if ('?' == *query_string)
+        worker->reactor.notify_ev.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (worker->reactor.notify_ev.fd < 0)
         {
-            *query_string = '\0';
-            query_string++;
-            sprintf(req_line_data->query_string, "%s", query_string);
-            req_line_data->cgi = 1;
+            httpd_error_exit("eventfd failed");
+        }
+        worker->reactor.notify_ev.type = HTTPD_EV_NOTIFY;
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = &worker->reactor.notify_ev;
+        if (epoll_ctl(worker->reactor.epoll_fd, EPOLL_CTL_ADD, worker->reactor.notify_ev.fd, &ev) < 0)
+        {
+            httpd_error_exit("epoll_ctl failed");
+        }
+
+#ifdef HTTPD_IO_URING
+        if (g_httpd_config.io_uring)
+        {
+            httpd_reactor_uring_init(&worker->reactor);
+        }
+#endif
+
+        /* 每个线程独立监听同一端口，不再经过主线程accept和分配 */
+        worker->reactor.listen_ev.fd = -1;
+        if (g_httpd_config.reuseport)
+        {
+            worker->reactor.listen_ev.fd = httpd_server_startup(1);
+            worker->reactor.listen_ev.type = HTTPD_EV_LISTEN;
+
+#ifdef HTTPD_IO_URING
+            if ((NULL != worker->reactor.uring) &&
+                (0 == httpd_uring_accept(worker->reactor.uring, worker->reactor.listen_ev.fd)))
+            {
+                worker->reactor.listen_uring = 1;
+                continue;
+            }
+#endif
+
+            ev.events = EPOLLIN;
+            ev.data.ptr = &worker->reactor.listen_ev;
+            if (epoll_ctl(worker->reactor.epoll_fd, EPOLL_CTL_ADD, worker->reactor.listen_ev.fd, &ev) < 0)
+            {
+                httpd_error_exit("epoll_ctl failed");
+            }
         }
-        
-    }
-    else if (0 == strcasecmp(req_line_data->method, "POST"))
-    {
-        req_line_data->cgi = 1;
     }
-    else
+
+    /* 监听组按创建顺序编号，与工作线程编号一致 */
+    if (g_httpd_config.reuseport && g_httpd_config.pin_cpu)
     {
-        /* code */
+        httpd_reuseport_attach_cpu(g_httpd_workers[0].reactor.listen_ev.fd, g_httpd_config.worker_num);
     }
-    
 
-    /* url中的路径格式化到path */
-    sprintf(req_line_data->path, "htdocs%s", url);
-   
-    /* 如果path只是一个目录，默认设置为首页index.html */
-    if (req_line_data->path[strlen(req_line_data->path) - 1] == '/')
+    /* 访问日志缓冲区需在工作线程处理请求前创建 */
+    if (NULL != g_httpd_log.path)
     {
-        strcat(req_line_data->path, "index.html");
+        httpd_log_startup();
     }
 
-    
+    /* 所有工作线程数据就绪后再启动线程，工作窃取会访问其他线程的队列 */
+    for (i = 0; i < g_httpd_config.worker_num; i++)
+    {
+        worker = &g_httpd_workers[i];
+        if (pthread_create(&worker->tid, NULL, httpd_worker_run, worker) != 0)
+        {
+            httpd_error_exit("pthread_create failed");
+        }
+
+        if (g_httpd_config.pin_cpu)
+        {
+            httpd_worker_pin_cpu(worker);
+        }
+    }
 }
 
 /*****************************************************************************
- * 函  数:    httpd_request_header_analyze
- * 功  能:    解析HTTP报文的请求头
- * 输  入:    无
+ * 函  数:    httpd_dispatch_connection
+ * 功  能:    将新连接轮询分配给工作线程，目标队列已满时依次尝试其他线程
+ * 输  入:    client: 客户端socket
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
+ * 返回值:    被分配的工作线程
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 记录accept时间
  ****************************************************************************/
-static void httpd_request_header_analyze(int client_sock, const char *method, int *content_length)
+static httpd_worker_t *httpd_dispatch_connection(int client)
 {
+    static int next = 0;
+    httpd_worker_t *worker = NULL;
+    long long accepted = httpd_monotonic_ns();
+    int i = 0;
 
-    int numchars = 1;
-    char buf[1024] = {0};
-
-    if (0 == strcasecmp(method, "POST"))
+    while (1)
     {
-        numchars = httpd_get_line_message(client_sock, buf, sizeof(buf));
-
-        /* 循环读取头信息找到Content-Length字段的值 */
-        while ((numchars > 0) && strcmp("\n", buf))
+        for (i = 0; i < g_httpd_config.worker_num; i++)
         {
-            buf[15] = '\0';/* 目的是为了截取Content-Length: */
-   
-            if (strcasecmp(buf, "Content-Length:") == 0)
+            worker = &g_httpd_workers[next];
+            next = (next + 1) % g_httpd_config.worker_num;
+
+            if (0 == httpd_ring_push(&worker->queue, client, accepted))
             {
-                *content_length = atoi(&(buf[16])); /* 获取Content-Length的值 */
+                return worker;
             }
-            numchars = httpd_get_line_message(client_sock, buf, sizeof(buf));
-        }        
-    }
-    else
-    {
-        while ((numchars > 0) && strcmp("\n", buf)) 
-        {
-            numchars = httpd_get_line_message(client_sock, buf, sizeof(buf));
         }
+
+        /* 所有队列已满，暂停接受连接，新连接在内核backlog中排队 */
+        usleep(1000);
     }
-    
 }
 
 /*****************************************************************************
- * 函  数:    httpd_request_method_error
- * 功  能:    返回请求方法错误信息给客户端
+ * 函  数:    httpd_admission_init
+ * 功  能:    初始化连接准入控制: 文件描述符软上限提高到硬上限，扣除保留数
+ *            后作为连接数上限(不超过配置的最大连接数)，并预生成503回复
  * 输  入:    无
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
  * 更  新:    无
  ****************************************************************************/
-static void httpd_request_method_error(int client)
+static void httpd_admission_init(void)
 {
-	char buf[128] = {0};
+    httpd_admission_t *adm = &g_httpd_admission;
+    const char *body = "<HTML><HEAD><TITLE>Service Unavailable\r\n"
+                       "</TITLE></HEAD>\r\n"
+                       "<BODY><P>Too many connections, please retry later.\r\n"
+                       "</BODY></HTML>\r\n";
+    struct rlimit rl;
+    int fd_limit = INT_MAX;
+    int len = 0;
 
+    if (0 == getrlimit(RLIMIT_NOFILE, &rl))
+    {
+        if (rl.rlim_cur < rl.rlim_max)
+        {
+            rl.rlim_cur = rl.rlim_max;
+            if (setrlimit(RLIMIT_NOFILE, &rl) < 0)
+            {
+                getrlimit(RLIMIT_NOFILE, &rl);
+            }
+        }
+        if ((RLIM_INFINITY != rl.rlim_cur) && (rl.rlim_cur < INT_MAX))
+        {
+            fd_limit = (int)rl.rlim_cur;
+        }
+    }
 
-	/* 发送501说明相应方法没有实现 */
-	sprintf(buf, "HTTP/1.0 501 Method Not Implemented\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, SERVER_STRING);
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "Content-Type: text/html\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "<HTML><HEAD><TITLE>Method Not Implemented\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "</TITLE></HEAD>\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "<BODY><P>HTTP request method not supported.\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "</BODY></HTML>\r\n");
-	send(client, buf, strlen(buf), 0);
+    adm->limit = fd_limit - g_httpd_config.fd_reserve;
+    if (adm->limit <= 0)
+    {
+        fprintf(stderr, "fd limit %d is below the reserve %d, raise it with ulimit -n\n",
+                fd_limit, g_httpd_config.fd_reserve);
+        adm->limit = (fd_limit / 2 > 0) ? fd_limit / 2 : 1;
+    }
+    if ((g_httpd_config.max_conns > 0) && (g_httpd_config.max_conns < adm->limit))
+    {
+        adm->limit = g_httpd_config.max_conns;
+    }
 
+    /* 超过上限的连接不进入工作线程，直接发送该回复后关闭 */
+    len = httpd_response_header_format(adm->response, sizeof(adm->response), "503 Service Unavailable",
+                                       "text/html", strlen(body), NULL, NULL);
+    len += snprintf(adm->response + len, sizeof(adm->response) - len,
+                    "Retry-After: 1\r\nConnection: close\r\n\r\n%s", body);
+    adm->response_len = ((size_t)len < sizeof(adm->response)) ? (size_t)len : sizeof(adm->response) - 1;
 }
 
 /*****************************************************************************
- * 函  数:    httpd_request_path_error
- * 功  能:    返回请求资源路径错误给客户端
- * 输  入:    无
+ * 函  数:    httpd_admission_check
+ * 功  能:    检查新连接是否超过连接数上限，超过时发送预生成的503回复并关闭
+ * 输  入:    client: 客户端socket
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
+ * 返回值:    0: 接受(计入连接数，关闭时减去)  -1: 已拒绝并关闭
+ * 创  建:    2026-10-16 changzehai(DTT)
  * 更  新:    无
  ****************************************************************************/
-static void httpd_request_path_error(int client)
+static int httpd_admission_check(int client)
 {
-	char buf[128] = {0};
-
-	/* 返回404 */
-	sprintf(buf, "HTTP/1.0 404 NOT FOUND\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, SERVER_STRING);
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "Content-Type: text/html\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "<HTML><TITLE>Not Found</TITLE>\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "<BODY><P>The server could not fulfill\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "your request because the resource specified\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "is unavailable or nonexistent.\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "</BODY></HTML>\r\n");
-	send(client, buf, strlen(buf), 0);  
-}
+    httpd_admission_t *adm = &g_httpd_admission;
 
+    if (atomic_fetch_add_explicit(&adm->active, 1, memory_order_relaxed) < adm->limit)
+    {
+        return 0;
+    }
+    atomic_fetch_sub_explicit(&adm->active, 1, memory_order_relaxed);
 
-/*****************************************************************************
- * 函  数:    httpd_request_cannot_execute_error
- * 功  能:    返回不能执行CGI程序错误给客户端
- * 输  入:    无
- * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
- ****************************************************************************/
-static void httpd_request_cannot_execute_error(int client)
-{
-	char buf[128] = {0};
-	
-	
-	/* 发送500 错误 */
-	sprintf(buf, "HTTP/1.0 500 Internal Server Error\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "Content-type: text/html\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "\r\n");
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "<P>Error prohibited CGI execution.\r\n");
-	send(client, buf, strlen(buf), 0);
+    /* 不读请求、不等待发送完成，新socket的发送缓冲区足够放下整个回复 */
+    send(client, adm->response, adm->response_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    close(client);
+    atomic_fetch_add_explicit(&adm->rejected, 1, memory_order_relaxed);
 
+    return -1;
 }
 
 /*****************************************************************************
- * 函  数:    httpd_request_bad_error
- * 功  能:    返回HTTP坏请求错误(content_lenght有误)
- * 输  入:    无
+ * 函  数:    httpd_accept_exhausted
+ * 功  能:    判断accept失败是否因为文件描述符或内存耗尽，此时应暂停accept
+ *            等待连接关闭释放资源，而不是退出
+ * 输  入:    err: accept返回的错误码
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
+ * 返回值:    1: 资源耗尽  0: 其他错误
+ * 创  建:    2026-10-16 changzehai(DTT)
  * 更  新:    无
  ****************************************************************************/
-static void httpd_request_bad_error(int client)
+static int httpd_accept_exhausted(int err)
 {
-	char buf[128] = {0};
-
-
-	/* 发送400错误 */
-	sprintf(buf, "HTTP/1.0 400 BAD REQUEST\r\n");
-	send(client, buf, sizeof(buf), 0);
-	sprintf(buf, "Content-type: text/html\r\n");
-	send(client, buf, sizeof(buf), 0);
-	sprintf(buf, "\r\n");
-	send(client, buf, sizeof(buf), 0);
-	sprintf(buf, "<P>Your browser sent a bad request, ");
-	send(client, buf, sizeof(buf), 0);
-	sprintf(buf, "such as a POST without a Content-Length.\r\n");
-	send(client, buf, sizeof(buf), 0);
-
+    return (EMFILE == err) || (ENFILE == err) || (ENOBUFS == err) || (ENOMEM == err);
 }
 
 /*****************************************************************************
- * 函  数:    httpd_request_error_deal
- * 功  能:    检查并处理HTTP请求错误
- * 输  入:    无
+ * 函  数:    httpd_accept_connections
+ * 功  能:    接受客户端连接并分配给工作线程
+ * 输  入:    server_sock: 监听socket
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 超过连接数上限时回复503，文件描述符耗尽时暂停accept
  ****************************************************************************/
-static int  httpd_request_error_deal(int client, http_request_data_t *h_data)
+static void httpd_accept_connections(int server_sock)
 {
-    struct stat st;
-
-    /* 检查请求方法是否正确 */
-    if ((0 != strcasecmp(h_data->req_line_data.method, "GET")) && 
-        (0 != strcasecmp(h_data->req_line_data.method, "POST")))
-    {
-        httpd_request_method_error(client);
-        return -1;
-    }
+    int client_sock = -1;
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_len = 0;
+    struct pollfd pfd;
+    httpd_worker_t *worker = NULL;
+    int paused = 0;
 
-    /* 检查请求资源路径是否正确 */
-    if (stat(h_data->req_line_data.path, &st) == -1) 
-    {
-        httpd_request_path_error(client);
-        return -1;
-    }
+    pfd.fd = server_sock;
+    pfd.events = POLLIN;
 
-#ifdef DEBUG
-    /* 如果需要执行CGI程序，需要检查请求的CGI脚步是否具有可执行权限 */
-    if (1 == h_data->req_line_data.cgi)
+    while (1)
     {
-        if ((st.st_mode & S_IXUSR) ||
-            (st.st_mode & S_IXGRP) ||
-            (st.st_mode & S_IXOTH))
+        if (poll(&pfd, 1, -1) < 0)
         {
-            httpd_request_cannot_execute_error(client);
-            return -1;
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            httpd_error_exit("poll failed");
         }
-    }
-#endif
-
-    /* 如果是POST请求，需检查Content_length长度是否正确 */
-    if ((0 == strcasecmp(h_data->req_line_data.method, "POST")) &&
-        (h_data->content_length < 0))
-    {
-        httpd_request_bad_error(client);
-        return -1;
-    }
-
-   
-    return 0;
-}
-
-/*****************************************************************************
- * 函  数:    httpd_response_header
- * 功  能:    发送回复报文头
- * 输  入:    无
- * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
- ****************************************************************************/
-static void httpd_response_header(int client)
-{
-	char buf[1024];
 
-	/* 发送HTTP头 */
-	strcpy(buf, "HTTP/1.0 200 OK\r\n");
-	send(client, buf, strlen(buf), 0);
-	strcpy(buf, SERVER_STRING);
-	send(client, buf, strlen(buf), 0);
-	sprintf(buf, "Content-Type: text/html\r\n");
-	send(client, buf, strlen(buf), 0);
-	strcpy(buf, "\r\n");
-	send(client, buf, strlen(buf), 0);    
-}
+        /* 一直accept到EAGAIN，同一批连接只唤醒一次对应的工作线程 */
+        while (1)
+        {
+            client_addr_len = sizeof(client_addr);
+            client_sock = accept4(server_sock,
+                                  (struct sockaddr *)&client_addr,
+                                  &client_addr_len,
+                                  SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (-1 == client_sock)
+            {
+                if ((EINTR == errno) || (ECONNABORTED == errno))
+                {
+                    continue;
+                }
+                if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+                {
+                    break;
+                }
+                if (httpd_accept_exhausted(errno))
+                {
+                    paused = 1;
+                    break;
+                }
+                httpd_error_exit("accept");
+            }
 
-/*****************************************************************************
- * 函  数:    httpd_send_file
- * 功  能:    返回静态请求文件给客户端
- * 输  入:    无
- * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
- ****************************************************************************/
-static void httpd_send_file(int client, const char *filename)
-{
-	FILE *fp = NULL;
-	char buf[1024] = {0};
-	
+            if (httpd_admission_check(client_sock) < 0)
+            {
+                continue;
+            }
+            worker = httpd_dispatch_connection(client_sock);
+            worker->notified = 1;
+        }
 
-	/* 打开文件 */
-	fp = fopen(filename, "r");
-	if (fp != NULL)
-    {
+        for (client_sock = 0; client_sock < g_httpd_config.worker_num; client_sock++)
+        {
+            worker = &g_httpd_workers[client_sock];
+            if (worker->notified)
+            {
+                worker->notified = 0;
+                httpd_worker_notify(worker);
+            }
+        }
 
-	    /* 读取并发送文件内容 */
-	    fgets(buf, sizeof(buf), fp);
-	    while (!feof(fp)) /* 判断文件是否读取到末尾 */
-	    {
-	        /* 读取并发送文件内容 */
-	        send(client, buf, strlen(buf), 0);
-	        fgets(buf, sizeof(buf), fp);
-	    }
+        /* 文件描述符耗尽时暂停accept，新连接在内核backlog中排队，等待已有
+           连接关闭释放文件描述符 */
+        if (paused)
+        {
+            paused = 0;
+            atomic_fetch_add_explicit(&g_httpd_admission.paused, 1, memory_order_relaxed);
+            usleep(HTTPD_ACCEPT_PAUSE_MS * 1000);
+        }
     }
-	else
-	{
-	    /* 如果文件不存在，则返回not_found */
-	    httpd_request_path_error(client);        
-	}
-
-    /* 关闭文件句柄 */
-	fclose(fp);
 }
 
-
 /*****************************************************************************
- * 函  数:    httpd_execute_cgi
- * 功  能:    执行CGI程序处理HTTP请求，并将处理结果发送回客户端
- * 输  入:    无
+ * 函  数:    httpd_usage
+ * 功  能:    打印命令行用法
+ * 输  入:    prog: 程序名
  * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    2026-10-16 changzehai(DTT) 增加访问日志选项
+ *            2026-10-16 changzehai(DTT) 增加各阶段超时选项
+ *            2026-10-16 changzehai(DTT) 增加连接数上限选项
+ *            2026-10-16 changzehai(DTT) 增加请求体长度上限选项
  ****************************************************************************/
-static void httpd_execute_cgi(int client, http_request_data_t *h_data)
+static void httpd_usage(const char *prog)
 {
-    pid_t pid;
-    int cgi_output[2]; 
-    int cgi_input[2];
-    int i = 0;
-    int status = 0;  
-    char c = '\0';
-
-
-    /* 创建父进程读子进程写的管道 */
-    if (pipe(cgi_output) < 0) {
-        httpd_request_cannot_execute_error(client);
-        return;
-     }
-
-    /* 创建子进程写父进程读的管道 */
-    if (pipe(cgi_input) < 0) {
-        httpd_request_cannot_execute_error(client);
-        return;
-    }
-
-    /* fork出一个子进程运行cgi脚本 */
-    if ( (pid = fork()) < 0 ) {
-        httpd_request_cannot_execute_error(client);
-        return;
-    }   
-
-
-	if (pid == 0)  /* 子进程: 运行CGI 脚本 */
-	{
-		char meth_env[40] = {0};
-		char query_env[300] = {0};
-		char length_env[20] = {0};
-		
-		/* 1代表着stdout，0代表着stdin，将系统标准输出重定向为cgi_output[1] */
-		dup2(cgi_output[1], 1);
-		/* 将系统标准输入重定向为cgi_input[0] */
-		dup2(cgi_input[0], 0);
-		
-		/* 关闭了cgi_output中的读通道 */
-		close(cgi_output[0]);
-		/* 关闭了cgi_input中的写通道 */
-		close(cgi_input[1]);
-		/* CGI标准需要将请求的方法存储环境变量中，然后和cgi脚本进行交互 */
-		/* 存储REQUEST_METHOD */
-		sprintf(meth_env, "REQUEST_METHOD=%s", h_data->req_line_data.method);
-		putenv(meth_env);
-		
-		
-		if (strcasecmp(h_data->req_line_data.method, "GET") == 0)  /* GET方法 */
-		{
-			/* 存储QUERY_STRING */
-			sprintf(query_env, "QUERY_STRING=%s", h_data->req_line_data.query_string);
-			putenv(query_env);
-            printf("query_string:%s\n", query_env);
-		}
-		else  /* POST方法 */
-		{   
-			/* 存储CONTENT_LENGTH */
-			sprintf(length_env, "CONTENT_LENGTH=%d", h_data->content_length);
-			putenv(length_env);
-		}
-		
-		/* 执行CGI脚本 */
-		execl(h_data->req_line_data.path, h_data->req_line_data.path, NULL);
-		
-		/* 退出子进程 */
-		exit(0);
-	
-	} 
-	else /* 父进程 */
-	{    
-        /* 关闭了cgi_output中的写通道，注意这是父进程中cgi_output变量和子进程要区分开 */
-		close(cgi_output[1]);
-        /* 关闭了cgi_input中的读通道 */
-		close(cgi_input[0]);
-	
-		if (strcasecmp(h_data->req_line_data.method, "POST") == 0)
-		{
-			for (i = 0; i <  h_data->content_length; i++) 
-			{
-			    /* 开始读取POST中的内容 */
-			    recv(client, &c, 1, 0);
-
-			    /* 将数据发送给cgi脚本 */
-			    write(cgi_input[1], &c, 1);
-			}
-        }
-
-		/* 读取cgi脚本返回数据 */
-		while (read(cgi_output[0], &c, 1) > 0)
-		{
-			/* 发送给浏览器 */
-			send(client, &c, 1, 0);
-		}
-	
-		/* 运行结束关闭 */
-		close(cgi_output[0]);
-		close(cgi_input[1]);
-	
-        /* 等待子进程退出后父进程再退出 */
-		waitpid(pid, &status, 0);
-	    
-    }
+    fprintf(stderr,
+            "Usage: %s [-p port] [-w workers] [-q queue_size] [-k timeout] [-r max_requests] [-c cache_kb]\n"
+            "          [-f url[:procs]]... [-l cgi_max] [-L cgi_script_max] [-W cgi_wait] [-T cgi_wait_timeout]\n"
+            "          [-H header_timeout] [-B body_timeout] [-S send_timeout] [-C cgi_timeout]\n"
+            "          [-m max_conns] [-F fd_reserve] [-b backlog] [-M body_max_kb] [-R] [-a] [-u]\n"
+            "          [-A access_log] [-j]\n"
+            "  -p port          listen port (default %d)\n"
+            "  -w workers       worker threads (default: number of CPUs)\n"
+            "  -q queue_size    pending connection queue per worker (default %d)\n"
+            "  -k timeout       keep-alive idle timeout in seconds (default %d)\n"
+            "  -r max_requests  max requests per keep-alive connection (default %d)\n"
+            "  -c cache_kb      static file cache budget in KB, 0 disables (default %d)\n"
+            "  -f url[:procs]   run a CGI script as a FastCGI process pool, may be repeated\n"
+            "                   (default %d processes, max %d; falls back to CGI when busy)\n"
+            "  -l cgi_max       max concurrent CGI requests, 0 = unlimited (default %d)\n"
+            "  -L cgi_script_max  max concurrent requests per CGI script, 0 = unlimited (default %d)\n"
+            "  -W cgi_wait      max CGI requests waiting for a slot before 503 (default %d)\n"
+            "  -T cgi_wait_timeout  seconds a CGI request may wait before 503 (default %d)\n"
+            "  -H header_timeout  seconds to receive the request line and headers, counted\n"
+            "                   from the first byte (default %d)\n"
+            "  -B body_timeout  seconds without request body data before closing (default %d)\n"
+            "  -S send_timeout  seconds without response progress before closing (default %d)\n"
+            "  -C cgi_timeout   seconds a CGI program may run before it is killed (default %d)\n"
+            "  -m max_conns     max open client connections; extra ones get a 503 and are closed\n"
+            "                   (default: file descriptor limit minus the reserve)\n"
+            "  -F fd_reserve    file descriptors kept free for files, pipes and logs (default %d)\n"
+            "  -b backlog       listen backlog (default %d)\n"
+            "  -M body_max_kb   max request body size in KB, including chunked uploads,\n"
+            "                   0 = unlimited (default %d)\n"
+            "  -R               one SO_REUSEPORT listener per worker instead of a single acceptor\n"
+            "  -a               pin each worker thread to a CPU\n"
+            "  -u               use io_uring for accept, request reads and static files\n"
+            "                   (build with 'make IO_URING=1'; falls back to epoll if unavailable)\n"
+            "  -A access_log    write an access log in Combined Log Format plus the service time\n"
+            "                   in microseconds, '-' for stdout; reopened on SIGHUP (default: off)\n"
+            "  -j               write the access log as one JSON object per line\n",
+            prog, HTTPD_SERVER_PORT, HTTPD_QUEUE_SIZE, HTTPD_KEEPALIVE_TIMEOUT, HTTPD_KEEPALIVE_MAX,
+            HTTPD_CACHE_SIZE, HTTPD_FCGI_PROCS, HTTPD_FCGI_MAX_PROCS, HTTPD_CGI_MAX, HTTPD_CGI_SCRIPT_MAX,
+            HTTPD_CGI_WAIT_MAX, HTTPD_CGI_WAIT_TIMEOUT, HTTPD_HEADER_TIMEOUT, HTTPD_BODY_TIMEOUT,
+            HTTPD_SEND_TIMEOUT, HTTPD_CGI_TIMEOUT, HTTPD_FD_RESERVE, HTTPD_LISTEN_BACKLOG, HTTPD_BODY_MAX);
 }
 
 
-
 /*****************************************************************************
- * 函  数:    httpd_accept_client_request
- * 功  能:    处理客户端请求
+ * 函  数:    main
+ * 功  能:    主程序
  * 输  入:    无
  * 输  出:    无
  * 返回值:    无  
  * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
+ * 更  新:    2026-10-16 changzehai(DTT) 主线程只负责接受连接，请求由工作线程池处理
+ *            2026-10-16 changzehai(DTT) 增加-u选项使用io_uring
+ *            2026-10-16 changzehai(DTT) 记录服务器启动时间
+ *            2026-10-16 changzehai(DTT) 增加访问日志选项
+ *            2026-10-16 changzehai(DTT) 增加各阶段超时选项
+ *            2026-10-16 changzehai(DTT) 增加连接数上限选项
+ *            2026-10-16 changzehai(DTT) 增加请求体长度上限选项
  ****************************************************************************/
-static void *httpd_accept_client_request(void *from_client)
+int main(int argc, char *argv[])
 {
-    int client = -1;
-    http_request_data_t http_data;
+    int server_sock = -1;
+    int opt = 0;
 
-    
-    client = *(int *)from_client;
-    memset(&http_data, 0x00, sizeof(http_data));
-
-    /* 解析HTTP请求行 */
-    httpd_request_line_analyze(client, &http_data.req_line_data);
-
-    /* 解析HTTP请求头 */
-    httpd_request_header_analyze(client, http_data.req_line_data.method, &http_data.content_length);
-
-#ifndef DEBUG
-    printf("method: %s\n", http_data.req_line_data.method);
-    printf("path:%s\n", http_data.req_line_data.path);
-    printf("cgi = %d\n", http_data.req_line_data.cgi);
-    printf("query_string:%s\n", http_data.req_line_data.query_string);
-    printf("content_length:%d\n", http_data.content_length);
-    printf("\n");
-#endif
+    g_httpd_config.port = HTTPD_SERVER_PORT;
+    g_httpd_config.worker_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    g_httpd_config.queue_size = HTTPD_QUEUE_SIZE;
+    g_httpd_config.keepalive_timeout = HTTPD_KEEPALIVE_TIMEOUT;
+    g_httpd_config.keepalive_max = HTTPD_KEEPALIVE_MAX;
+    g_httpd_config.cache_size = HTTPD_CACHE_SIZE;
+    g_httpd_config.cgi_max = HTTPD_CGI_MAX;
+    g_httpd_config.cgi_script_max = HTTPD_CGI_SCRIPT_MAX;
+    g_httpd_config.cgi_wait_max = HTTPD_CGI_WAIT_MAX;
+    g_httpd_config.cgi_wait_timeout = HTTPD_CGI_WAIT_TIMEOUT;
+    g_httpd_config.header_timeout = HTTPD_HEADER_TIMEOUT;
+    g_httpd_config.body_timeout = HTTPD_BODY_TIMEOUT;
+    g_httpd_config.send_timeout = HTTPD_SEND_TIMEOUT;
+    g_httpd_config.cgi_timeout = HTTPD_CGI_TIMEOUT;
+    g_httpd_config.max_conns = HTTPD_MAX_CONNS;
+    g_httpd_config.fd_reserve = HTTPD_FD_RESERVE;
+    g_httpd_config.backlog = HTTPD_LISTEN_BACKLOG;
+    g_httpd_config.body_max = (long long)HTTPD_BODY_MAX * 1024;
 
+    while ((opt = getopt(argc, argv, "p:w:q:k:r:c:f:l:L:W:T:H:B:S:C:m:F:b:M:A:jRauh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                g_httpd_config.port = atoi(optarg);
+                break;
+            case 'w':
+                g_httpd_config.worker_num = atoi(optarg);
+                break;
+            case 'q':
+                g_httpd_config.queue_size = atoi(optarg);
+                break;
+            case 'k':
+                g_httpd_config.keepalive_timeout = atoi(optarg);
+                break;
+            case 'r':
+                g_httpd_config.keepalive_max = atoi(optarg);
+                break;
+            case 'c':
+                g_httpd_config.cache_size = atoi(optarg);
+                break;
+            case 'l':
+                g_httpd_config.cgi_max = atoi(optarg);
+                break;
+            case 'L':
+                g_httpd_config.cgi_script_max = atoi(optarg);
+                break;
+            case 'W':
+                g_httpd_config.cgi_wait_max = atoi(optarg);
+                break;
+            case 'T':
+                g_httpd_config.cgi_wait_timeout = atoi(optarg);
+                break;
+            case 'H':
+                g_httpd_config.header_timeout = atoi(optarg);
+                break;
+            case 'B':
+                g_httpd_config.body_timeout = atoi(optarg);
+                break;
+            case 'S':
+                g_httpd_config.send_timeout = atoi(optarg);
+                break;
+            case 'C':
+                g_httpd_config.cgi_timeout = atoi(optarg);
+                break;
+            case 'm':
+                g_httpd_config.max_conns = atoi(optarg);
+                break;
+            case 'F':
+                g_httpd_config.fd_reserve = atoi(optarg);
+                break;
+            case 'b':
+                g_httpd_config.backlog = atoi(optarg);
+                break;
+            case 'M':
+                g_httpd_config.body_max = atoll(optarg) * 1024;
+                break;
+            case 'R':
+                g_httpd_config.reuseport = 1;
+                break;
+            case 'a':
+                g_httpd_config.pin_cpu = 1;
+                break;
+            case 'u':
+                g_httpd_config.io_uring = 1;
+                break;
+            case 'A':
+                g_httpd_log.path = optarg;
+                break;
+            case 'j':
+                g_httpd_log.json = 1;
+                break;
+            case 'f':
+                if (httpd_fcgi_config(optarg) < 0)
+                {
+                    httpd_usage(argv[0]);
+                    return(1);
+                }
+                break;
+            default:
+                httpd_usage(argv[0]);
+                return(1);
+        }
+    }
 
-    /* HTTP请求错误处理 */
-    if (-1 == httpd_request_error_deal(client, &http_data))
+    if (g_httpd_config.worker_num <= 0)
     {
-        printf("httpd request error\n");
-        return NULL;
+        g_httpd_config.worker_num = 1;
     }
-    else
+    if (g_httpd_config.queue_size <= 0)
     {
-        /* 返回正确响应码200 */
-	    send(client, "HTTP/1.0 200 OK\r\n", strlen("HTTP/1.0 200 OK\r\n"), 0);
+        g_httpd_config.queue_size = HTTPD_QUEUE_SIZE;
     }
-
-    /* 处理客户端请求，并将处理结果返回给客户端 */
-    if (0 == http_data.req_line_data.cgi) /* 不带参数的GET请求，不需要执行CGI程序，直接返回请求的资源文件 */
+    if (g_httpd_config.keepalive_max <= 0)
     {
-        /* 发送回复报文头 */
-	    httpd_response_header(client);
-        
-        /* 发送所请求的资源文件给客户端 */
-        httpd_send_file(client, http_data.req_line_data.path);
+        g_httpd_config.keepalive_max = 1;
     }
-    else 
+    if (g_httpd_config.backlog <= 0)
     {
-        /* 执行CGI程序处理HTTP请求，并将处理结果发送回客户端 */
-        httpd_execute_cgi(client, &http_data);
+        g_httpd_config.backlog = HTTPD_LISTEN_BACKLOG;
     }
-    
+    if (g_httpd_config.cgi_wait_max < 0)
+    {
+        g_httpd_config.cgi_wait_max = 0;
+    }
+    if (g_httpd_config.header_timeout <= 0)
+    {
+        g_httpd_config.header_timeout = HTTPD_HEADER_TIMEOUT;
+    }
+    if (g_httpd_config.body_timeout <= 0)
+    {
+        g_httpd_config.body_timeout = HTTPD_BODY_TIMEOUT;
+    }
+    if (g_httpd_config.send_timeout <= 0)
+    {
+        g_httpd_config.send_timeout = HTTPD_SEND_TIMEOUT;
+    }
+    if (g_httpd_config.cgi_timeout <= 0)
+    {
+        g_httpd_config.cgi_timeout = HTTPD_CGI_TIMEOUT;
+    }
+    if (g_httpd_config.max_conns < 0)
+    {
+        g_httpd_config.max_conns = HTTPD_MAX_CONNS;
+    }
+    if (g_httpd_config.fd_reserve < 0)
+    {
+        g_httpd_config.fd_reserve = 0;
+    }
+    if (g_httpd_config.body_max < 0)
+    {
+        g_httpd_config.body_max = 0;
+    }
+#ifndef HTTPD_IO_URING
+    if (g_httpd_config.io_uring)
+    {
+        fprintf(stderr, "built without io_uring support (make IO_URING=1), using epoll\n");
+        g_httpd_config.io_uring = 0;
+    }
+#endif
 
-    return NULL;
-}
+    /* 客户端断开后继续写socket不应终止服务器 */
+    signal(SIGPIPE, SIG_IGN);
 
+    pthread_mutex_init(&g_httpd_cgi_limit.lock, NULL);
 
+    /* 初始化请求解析: 选择SIMD分隔符查找函数，生成已知请求头哈希表 */
+    httpd_scan_init();
+    httpd_header_hash_init();
+    g_httpd_start_time = httpd_monotonic_time();
 
-/*****************************************************************************
- * 函  数:    main
- * 功  能:    主程序
- * 输  入:    无
- * 输  出:    无
- * 返回值:    无  
- * 创  建:    2020-04-12 changzehai(DTT)
- * 更  新:    无
- ****************************************************************************/
-int main(void)
-{
-    int server_sock = -1;
-    int client_sock = -1;
-    socklen_t client_addr_len = 0;
-    struct sockaddr_in client_addr;
-    pthread_t newthread;
+    /* 计算连接数上限，预生成超过上限时的503回复 */
+    httpd_admission_init();
 
-    
-    client_addr_len = sizeof(client_addr);
-    memset(&client_addr, 0x00, sizeof(client_addr));
+    /* 初始化静态文件缓存 */
+    httpd_cache_init((g_httpd_config.cache_size > 0) ? (size_t)g_httpd_config.cache_size * 1024 : 0);
 
-    /* 启动server socket */
-    server_sock = httpd_server_startup();
-    printf("httpd running on 8000 !!!\n");
+    /* 启动FastCGI常驻进程 */
+    httpd_fcgi_startup();
 
-    while (1)
+    /* SO_REUSEPORT模式下由各工作线程自己监听和accept */
+    if (g_httpd_config.reuseport)
     {
-        /* 接受客户端连接 */
-        client_sock = accept(server_sock,
-                          (struct sockaddr *)&client_addr,
-                          &client_addr_len);
-        if (-1 == client_sock)
-        {
-            httpd_error_exit("accept");
-        }
+        httpd_worker_pool_startup();
+        printf("httpd running on %d with %d workers (SO_REUSEPORT), max %d connections !!!\n",
+               g_httpd_config.port, g_httpd_config.worker_num, g_httpd_admission.limit);
 
-        /*启动线程处理新的连接 */
-        if (pthread_create(&newthread , NULL, httpd_accept_client_request, (void*)&client_sock) != 0)
+        for (opt = 0; opt < g_httpd_config.worker_num; opt++)
         {
-            perror("pthread_create failed");
+            pthread_join(g_httpd_workers[opt].tid, NULL);
         }
+        return(0);
+    }
+
+    /* 启动server socket */
+    server_sock = httpd_server_startup(0);
+
+    /* 启动工作线程池 */
+    httpd_worker_pool_startup();
+    printf("httpd running on %d with %d workers, max %d connections !!!\n",
+           g_httpd_config.port, g_httpd_config.worker_num, g_httpd_admission.limit);
+
+    /* 接受客户端连接 */
+#ifdef HTTPD_IO_URING
+    if (g_httpd_config.io_uring)
+    {
+        httpd_uring_accept_connections(server_sock);
     }
+#endif
+    httpd_accept_connections(server_sock);
 
     printf("closed!\n");
     /* 关闭server socket */
@@ -802,5 +9706,3 @@ int main(void)
 
     return(0);
 }
-
-
@@ -0,0 +1,1435 @@
+/*****************************************************************************/
+/* 文件名:    httpd_bench.c                                                  */
+/* 描  述:    HTTP服务器压力测试工具: 多线程epoll客户端，支持闭环/开环(恒定   */
+/*            到达率)两种压测模式、持久连接开关及静态文件/GET CGI/POST CGI     */
+/*            混合请求，输出吞吐量及延迟分布                                  */
+/* 创  建:    2026-10-16 changzehai                                          */
+/* 更  新:    无                                                             */
+/* Copyright 1998 - 2020 CZH. All Rights Reserved                            */
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <strings.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+
+/*-----------------------------------*/
+/* 宏定义                            */
+/*-----------------------------------*/
+#define BENCH_SERVER_PORT   8000   /* 默认服务器端口(与httpd一致)   */
+#define BENCH_THREADS       2      /* 默认压测线程数               */
+#define BENCH_CONNECTIONS   32     /* 默认并发连接数               */
+#define BENCH_DURATION      10     /* 默认压测时间(秒)             */
+#define BENCH_MAX_EVENTS    256    /* epoll_wait一次最多返回的事件数 */
+#define BENCH_REQ_SIZE      2048   /* 请求报文最大长度              */
+#define BENCH_RBUF_SIZE     16384  /* 连接接收缓冲区大小(回复头的最大长度) */
+#define BENCH_RETRY_NS      10000000LL    /* 连接失败后重试间隔(10ms)  */
+#define BENCH_POLL_MS       100    /* 没有待发请求时epoll_wait最长等待时间 */
+#define BENCH_HIST_SUB_BITS 4      /* 延迟直方图每个2的幂区间细分为2^4个桶 */
+#define BENCH_HIST_MAX_BITS 40     /* 延迟直方图记录的最大值2^40ns(约18分钟) */
+#define BENCH_HIST_BUCKETS  ((BENCH_HIST_MAX_BITS - BENCH_HIST_SUB_BITS + 1) << BENCH_HIST_SUB_BITS)
+
+/* 默认混合请求: 静态文件/GET CGI/POST CGI，对应htdocs中的页面和脚本 */
+#define BENCH_STATIC_PATH   "/index.html"
+#define BENCH_GET_CGI_PATH  "/user.cgi?trial"
+#define BENCH_POST_CGI_PATH "/register.cgi"
+#define BENCH_POST_BODY     "name=bench&passwd=123456&email=bench%40example.com"
+
+
+/*-----------------------------------*/
+/* 类型定义                           */
+/*-----------------------------------*/
+/* 请求类型定义 */
+typedef enum __BENCH_REQ_E_
+{
+    BENCH_REQ_STATIC = 0,  /* 静态文件 */
+    BENCH_REQ_GET_CGI,     /* GET CGI  */
+    BENCH_REQ_POST_CGI,    /* POST CGI */
+    BENCH_REQ_NUM
+} bench_req_e;
+
+/* 错误类型定义 */
+typedef enum __BENCH_ERR_E_
+{
+    BENCH_ERR_CONNECT = 0, /* 连接失败           */
+    BENCH_ERR_IO,          /* 收发失败或连接被关闭 */
+    BENCH_ERR_PARSE,       /* 回复格式错误        */
+    BENCH_ERR_NUM
+} bench_err_e;
+
+/* 连接状态定义 */
+typedef enum __BENCH_CONN_STATE_E_
+{
+    BENCH_CONN_IDLE = 0,   /* 空闲，等待分派请求 */
+    BENCH_CONN_CONNECTING, /* 正在建立连接      */
+    BENCH_CONN_SENDING,    /* 正在发送请求      */
+    BENCH_CONN_RECEIVING   /* 正在接收回复      */
+} bench_conn_state_e;
+
+/* 回复报文体长度的确定方式 */
+typedef enum __BENCH_BODY_E_
+{
+    BENCH_BODY_LENGTH = 0, /* Content-Length         */
+    BENCH_BODY_CHUNKED,    /* Transfer-Encoding: chunked */
+    BENCH_BODY_CLOSE       /* 读到连接关闭为止         */
+} bench_body_e;
+
+/* chunked报文体解析状态 */
+typedef enum __BENCH_CHUNK_E_
+{
+    BENCH_CHUNK_SIZE = 0,  /* 分块长度行   */
+    BENCH_CHUNK_DATA,      /* 分块数据     */
+    BENCH_CHUNK_CRLF,      /* 分块结尾CRLF */
+    BENCH_CHUNK_TRAILER    /* 尾部字段     */
+} bench_chunk_e;
+
+/* 延迟直方图定义(纳秒，对数-线性分桶) */
+typedef struct __BENCH_HIST_T_
+{
+    unsigned long count;                       /* 次数    */
+    unsigned long sum;                         /* 总延迟  */
+    unsigned long max;                         /* 最大值  */
+    unsigned long buckets[BENCH_HIST_BUCKETS]; /* 各桶次数 */
+} bench_hist_t;
+
+struct __BENCH_THREAD_T_;
+
+/* 客户端连接定义 */
+typedef struct __BENCH_CONN_T_
+{
+    int fd;                          /* socket，未连接时为-1           */
+    int state;                       /* 连接状态BENCH_CONN_*          */
+    int type;                        /* 当前请求类型BENCH_REQ_*        */
+    long long start;                 /* 请求的计划发送时间(纳秒)        */
+    long long retry_at;              /* 连接失败后的重试时间(纳秒)      */
+    char req[BENCH_REQ_SIZE];        /* 请求报文                     */
+    int req_len;                     /* 请求报文长度                  */
+    int req_sent;                    /* 已发送长度                    */
+    char rbuf[BENCH_RBUF_SIZE];      /* 接收缓冲区                    */
+    int rlen;                        /* 接收缓冲区中未处理的数据长度     */
+    int header_done;                 /* 回复头是否已解析              */
+    int status;                      /* 回复状态码                    */
+    int body;                        /* 报文体长度确定方式BENCH_BODY_*  */
+    long body_left;                  /* 剩余报文体长度(Content-Length) */
+    int chunk;                       /* chunked解析状态BENCH_CHUNK_*   */
+    long chunk_left;                 /* 当前分块剩余长度               */
+    int close;                       /* 服务器要求关闭连接             */
+    struct __BENCH_THREAD_T_ *thread; /* 所属压测线程                 */
+    struct __BENCH_CONN_T_ *next;    /* 空闲队列链接                  */
+} bench_conn_t;
+
+/* 压测线程定义 */
+typedef struct __BENCH_THREAD_T_
+{
+    pthread_t tid;                   /* 线程ID                      */
+    int id;                          /* 线程编号                     */
+    int epoll_fd;                    /* epoll文件描述符              */
+    bench_conn_t *conns;             /* 本线程的连接                  */
+    int conn_num;                    /* 本线程的连接数                */
+    bench_conn_t *idle_head;         /* 空闲连接队列(FIFO)            */
+    bench_conn_t *idle_tail;
+    unsigned int seed;               /* 随机数种子(选择请求类型)       */
+    long long interval;              /* 开环模式请求间隔(纳秒)         */
+    long long next_due;              /* 开环模式下一个请求的计划时间    */
+    unsigned long requests;          /* 完成的请求数                  */
+    unsigned long bytes;             /* 接收的字节数                  */
+    unsigned long reconnects;        /* 建立的连接数                  */
+    unsigned long unsent;            /* 开环模式压测结束时仍未发出的请求数 */
+    unsigned long inflight;          /* 压测结束时仍未完成的请求数      */
+    unsigned long errors[BENCH_ERR_NUM]; /* 各类错误数               */
+    unsigned long status[6];         /* 各类状态码(1xx~5xx)回复数，0为其他 */
+    bench_hist_t hist[BENCH_REQ_NUM]; /* 各类请求的延迟              */
+} bench_thread_t;
+
+/* 压测配置定义 */
+typedef struct __BENCH_CONFIG_T_
+{
+    const char *host;                /* 服务器IPv4地址               */
+    int port;                        /* 服务器端口                   */
+    int thread_num;                  /* 压测线程数                   */
+    int conn_num;                    /* 并发连接数                   */
+    int duration;                    /* 压测时间(秒)                 */
+    double rate;                     /* 开环模式每秒请求数，0为闭环模式 */
+    int keepalive;                   /* 是否使用持久连接              */
+    int weight[BENCH_REQ_NUM];       /* 各类请求的比例                */
+    const char *path[BENCH_REQ_NUM]; /* 各类请求的URI                */
+    const char *body;                /* POST请求体                   */
+    struct sockaddr_in addr;         /* 服务器地址                   */
+    long long start;                 /* 压测开始时间(纳秒)            */
+    long long end;                   /* 压测结束时间(纳秒)            */
+} bench_config_t;
+
+
+/*-----------------------------------*/
+/* 全局变量                          */
+/*-----------------------------------*/
+static bench_config_t g_bench_config;
+
+/* 请求类型名称，按BENCH_REQ_*编号排列 */
+static const char *g_bench_req_names[BENCH_REQ_NUM] = { "static", "get-cgi", "post-cgi" };
+
+
+/*-----------------------------------*/
+/* 函数声明                          */
+/*-----------------------------------*/
+/* 获取单调时钟纳秒数 */
+static long long bench_now_ns(void);
+
+/* 计算延迟所在的直方图桶 */
+static int  bench_hist_index(unsigned long ns);
+
+/* 计算直方图桶的上界 */
+static unsigned long bench_hist_upper(int idx);
+
+/* 记录一次延迟 */
+static void bench_hist_record(bench_hist_t *hist, long long ns);
+
+/* 合并直方图 */
+static void bench_hist_merge(bench_hist_t *dst, const bench_hist_t *src);
+
+/* 从直方图计算百分位延迟 */
+static unsigned long bench_hist_percentile(const bench_hist_t *hist, double q);
+
+/* 空闲连接入队 */
+static void bench_idle_push(bench_thread_t *thread, bench_conn_t *conn);
+
+/* 生成请求报文 */
+static void bench_request_build(bench_conn_t *conn);
+
+/* 在连接上发出一个请求 */
+static void bench_conn_issue(bench_conn_t *conn, long long start);
+
+/* 关闭连接 */
+static void bench_conn_close(bench_conn_t *conn);
+
+/* 请求失败处理 */
+static void bench_conn_fail(bench_conn_t *conn, int err);
+
+/* 请求完成处理 */
+static void bench_conn_done(bench_conn_t *conn);
+
+/* 从接收缓冲区头部移除已处理的数据 */
+static void bench_conn_consume(bench_conn_t *conn, int len);
+
+/* 查找回复报文头结尾 */
+static int  bench_header_end(const char *buf, int len);
+
+/* 解析回复报文头 */
+static int  bench_response_header(bench_conn_t *conn);
+
+/* 解析接收缓冲区中的回复数据 */
+static int  bench_response_parse(bench_conn_t *conn);
+
+/* 发送请求报文 */
+static int  bench_conn_send(bench_conn_t *conn);
+
+/* 接收回复报文 */
+static int  bench_conn_recv(bench_conn_t *conn);
+
+/* 驱动连接状态机 */
+static void bench_conn_process(bench_conn_t *conn, unsigned int events);
+
+/* 压测线程 */
+static void *bench_thread_run(void *arg);
+
+/* 打印一行延迟统计 */
+static void bench_report_latency(const char *name, const bench_hist_t *hist);
+
+/* 汇总并打印压测结果 */
+static void bench_report(bench_thread_t *threads);
+
+/* 解析请求比例参数 */
+static int  bench_mix_config(const char *arg);
+
+/* 打印命令行用法 */
+static void bench_usage(const char *prog);
+
+
+/*****************************************************************************
+ * 函  数:    bench_now_ns
+ * 功  能:    获取单调时钟纳秒数
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    单调时钟纳秒数
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static long long bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_hist_index
+ * 功  能:    计算延迟所在的直方图桶: 小于2^SUB_BITS的值每个值一个桶，之后每个
+ *            2的幂区间均分为2^SUB_BITS个桶，相对误差不超过1/2^SUB_BITS
+ * 输  入:    ns: 延迟(纳秒)
+ * 输  出:    无
+ * 返回值:    桶下标
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_hist_index(unsigned long ns)
+{
+    int bits = 0;
+
+    if (ns < (1UL << BENCH_HIST_SUB_BITS))
+    {
+        return (int)ns;
+    }
+    if (ns >= (1UL << BENCH_HIST_MAX_BITS))
+    {
+        return BENCH_HIST_BUCKETS - 1;
+    }
+
+    bits = 63 - __builtin_clzl(ns);
+    return ((bits - BENCH_HIST_SUB_BITS + 1) << BENCH_HIST_SUB_BITS) +
+           (int)((ns >> (bits - BENCH_HIST_SUB_BITS)) & ((1UL << BENCH_HIST_SUB_BITS) - 1));
+}
+
+/*****************************************************************************
+ * 函  数:    bench_hist_upper
+ * 功  能:    计算直方图桶的上界(桶内最大值)
+ * 输  入:    idx: 桶下标
+ * 输  出:    无
+ * 返回值:    桶上界(纳秒)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static unsigned long bench_hist_upper(int idx)
+{
+    int bits = 0;
+    unsigned long sub = 0;
+
+    if (idx < (1 << BENCH_HIST_SUB_BITS))
+    {
+        return (unsigned long)idx;
+    }
+
+    bits = (idx >> BENCH_HIST_SUB_BITS) + BENCH_HIST_SUB_BITS - 1;
+    sub = (unsigned long)(idx & ((1 << BENCH_HIST_SUB_BITS) - 1));
+    return ((((1UL << BENCH_HIST_SUB_BITS) | sub) + 1) << (bits - BENCH_HIST_SUB_BITS)) - 1;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_hist_record
+ * 功  能:    记录一次延迟
+ * 输  入:    hist: 延迟直方图
+ *            ns:   延迟(纳秒)
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_hist_record(bench_hist_t *hist, long long ns)
+{
+    unsigned long value = (ns > 0) ? (unsigned long)ns : 0;
+
+    hist->count++;
+    hist->sum += value;
+    hist->buckets[bench_hist_index(value)]++;
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_hist_merge
+ * 功  能:    将一个直方图合并到另一个直方图
+ * 输  入:    dst: 目标直方图
+ *            src: 源直方图
+ * 输  出:    dst: 合并后的直方图
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_hist_merge(bench_hist_t *dst, const bench_hist_t *src)
+{
+    int i = 0;
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++)
+    {
+        dst->buckets[i] += src->buckets[i];
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_hist_percentile
+ * 功  能:    从直方图计算百分位延迟，取所在桶的上界，不超过实际最大值
+ * 输  入:    hist: 延迟直方图
+ *            q:    百分位(0~1)
+ * 输  出:    无
+ * 返回值:    百分位延迟(纳秒)
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static unsigned long bench_hist_percentile(const bench_hist_t *hist, double q)
+{
+    unsigned long target = 0;
+    unsigned long seen = 0;
+    unsigned long upper = 0;
+    int i = 0;
+
+    if (0 == hist->count)
+    {
+        return 0;
+    }
+
+    target = (unsigned long)(q * (double)hist->count + 0.999999);
+    if (0 == target)
+    {
+        target = 1;
+    }
+
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+        if (seen >= target)
+        {
+            upper = bench_hist_upper(i);
+            return (upper < hist->max) ? upper : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_idle_push
+ * 功  能:    空闲连接加入本线程空闲队列尾部
+ * 输  入:    thread: 压测线程
+ *            conn:   客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_idle_push(bench_thread_t *thread, bench_conn_t *conn)
+{
+    conn->state = BENCH_CONN_IDLE;
+    conn->next = NULL;
+    if (NULL == thread->idle_tail)
+    {
+        thread->idle_head = conn;
+    }
+    else
+    {
+        thread->idle_tail->next = conn;
+    }
+    thread->idle_tail = conn;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_request_build
+ * 功  能:    按配置的比例随机选择请求类型并生成请求报文
+ * 输  入:    conn: 客户端连接
+ * 输  出:    conn->req: 请求报文
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_request_build(bench_conn_t *conn)
+{
+    bench_config_t *config = &g_bench_config;
+    const char *connection = config->keepalive ? "" : "Connection: close\r\n";
+    int total = 0;
+    int r = 0;
+    int i = 0;
+
+    for (i = 0; i < BENCH_REQ_NUM; i++)
+    {
+        total += config->weight[i];
+    }
+
+    r = rand_r(&conn->thread->seed) % total;
+    for (i = 0; i < BENCH_REQ_NUM - 1; i++)
+    {
+        if (r < config->weight[i])
+        {
+            break;
+        }
+        r -= config->weight[i];
+    }
+    conn->type = i;
+
+    if (BENCH_REQ_POST_CGI == conn->type)
+    {
+        conn->req_len = snprintf(conn->req, sizeof(conn->req),
+                                 "POST %s HTTP/1.1\r\n"
+                                 "Host: %s\r\n"
+                                 "User-Agent: httpd_bench\r\n"
+                                 "Content-Type: application/x-www-form-urlencoded\r\n"
+                                 "Content-Length: %zu\r\n"
+                                 "%s\r\n%s",
+                                 config->path[i], config->host, strlen(config->body), connection,
+                                 config->body);
+    }
+    else
+    {
+        conn->req_len = snprintf(conn->req, sizeof(conn->req),
+                                 "GET %s HTTP/1.1\r\n"
+                                 "Host: %s\r\n"
+                                 "User-Agent: httpd_bench\r\n"
+                                 "%s\r\n",
+                                 config->path[i], config->host, connection);
+    }
+    if (conn->req_len >= (int)sizeof(conn->req))
+    {
+        conn->req_len = sizeof(conn->req) - 1;
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_issue
+ * 功  能:    在空闲连接上发出一个请求，未连接时先建立连接
+ * 输  入:    conn:  客户端连接
+ *            start: 请求的计划发送时间(纳秒)，延迟从该时间算起
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_conn_issue(bench_conn_t *conn, long long start)
+{
+    struct epoll_event ev;
+    int one = 1;
+
+    conn->start = start;
+    conn->req_sent = 0;
+    conn->rlen = 0;
+    conn->header_done = 0;
+    conn->close = 0;
+    bench_request_build(conn);
+
+    if (conn->fd >= 0)
+    {
+        conn->state = BENCH_CONN_SENDING;
+        bench_conn_process(conn, EPOLLOUT);
+        return;
+    }
+
+    conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd < 0)
+    {
+        bench_conn_fail(conn, BENCH_ERR_CONNECT);
+        return;
+    }
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    /* 边沿触发，连接建立后同时关注读写事件 */
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(conn->thread->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) < 0)
+    {
+        bench_conn_fail(conn, BENCH_ERR_CONNECT);
+        return;
+    }
+
+    conn->thread->reconnects++;
+    conn->state = BENCH_CONN_CONNECTING;
+    if (connect(conn->fd, (struct sockaddr *)&g_bench_config.addr, sizeof(g_bench_config.addr)) < 0)
+    {
+        if (EINPROGRESS != errno)
+        {
+            bench_conn_fail(conn, BENCH_ERR_CONNECT);
+        }
+        return;
+    }
+
+    conn->state = BENCH_CONN_SENDING;
+    bench_conn_process(conn, EPOLLOUT);
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_close
+ * 功  能:    关闭连接(关闭socket会自动将其从epoll中移除)
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_conn_close(bench_conn_t *conn)
+{
+    if (conn->fd >= 0)
+    {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_fail
+ * 功  能:    请求失败: 记录错误，关闭连接后放回空闲队列，连接失败时稍后重试
+ *            避免服务器不可用时空转
+ * 输  入:    conn: 客户端连接
+ *            err:  错误类型BENCH_ERR_*
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_conn_fail(bench_conn_t *conn, int err)
+{
+    conn->thread->errors[err]++;
+    conn->retry_at = (BENCH_ERR_CONNECT == err) ? bench_now_ns() + BENCH_RETRY_NS : 0;
+    bench_conn_close(conn);
+    bench_idle_push(conn->thread, conn);
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_done
+ * 功  能:    请求完成: 记录延迟和状态码，不使用持久连接或服务器要求关闭时
+ *            关闭连接，然后放回空闲队列
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_conn_done(bench_conn_t *conn)
+{
+    bench_thread_t *thread = conn->thread;
+
+    bench_hist_record(&thread->hist[conn->type], bench_now_ns() - conn->start);
+    thread->requests++;
+    thread->status[((conn->status >= 100) && (conn->status < 600)) ? conn->status / 100 : 0]++;
+
+    if (!g_bench_config.keepalive || conn->close)
+    {
+        bench_conn_close(conn);
+    }
+    conn->retry_at = 0;
+    bench_idle_push(thread, conn);
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_consume
+ * 功  能:    从接收缓冲区头部移除已处理的数据
+ * 输  入:    conn: 客户端连接
+ *            len:  已处理的长度
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_conn_consume(bench_conn_t *conn, int len)
+{
+    memmove(conn->rbuf, conn->rbuf + len, conn->rlen - len);
+    conn->rlen -= len;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_header_end
+ * 功  能:    查找回复报文头结尾的空行。CGI程序输出的报文头常以LF换行，服务器
+ *            原样转发，因此同时接受CRLF和LF
+ * 输  入:    buf: 接收的数据
+ *            len: 数据长度
+ * 输  出:    无
+ * 返回值:    >0: 含结尾空行的报文头长度  0: 报文头未到齐
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_header_end(const char *buf, int len)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+
+    while (NULL != (p = memchr(p, '\n', end - p)))
+    {
+        p++;
+        if ((p < end) && ('\r' == *p))
+        {
+            p++;
+        }
+        if (p >= end)
+        {
+            break;
+        }
+        if ('\n' == *p)
+        {
+            return (int)(p + 1 - buf);
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_response_header
+ * 功  能:    解析回复报文头: 状态码、报文体长度的确定方式及是否关闭连接，
+ *            跳过100 Continue临时回复
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 解析完成  0: 数据未到齐  -1: 格式错误或回复头过长
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_response_header(bench_conn_t *conn)
+{
+    char *end = NULL;
+    char *line = NULL;
+    char *next = NULL;
+    int len = 0;
+
+    while (1)
+    {
+        len = bench_header_end(conn->rbuf, conn->rlen);
+        if (0 == len)
+        {
+            return (conn->rlen >= BENCH_RBUF_SIZE) ? -1 : 0;
+        }
+        end = conn->rbuf + len - 1;
+        *end = '\0';
+
+        if ((0 != strncmp(conn->rbuf, "HTTP/1.", 7)) || (len < 12))
+        {
+            return -1;
+        }
+        conn->status = atoi(conn->rbuf + 9);
+
+        if (100 != conn->status)
+        {
+            break;
+        }
+        bench_conn_consume(conn, len);
+    }
+
+    /* 没有Content-Length及chunked时报文体到连接关闭为止 */
+    conn->body = BENCH_BODY_CLOSE;
+    conn->body_left = 0;
+    conn->close = 0;
+
+    for (line = strchr(conn->rbuf, '\n'); NULL != line; line = next)
+    {
+        line += 1;
+        next = strchr(line, '\n');
+        if (NULL != next)
+        {
+            *next = '\0';
+        }
+
+        if (0 == strncasecmp(line, "Content-Length:", 15))
+        {
+            conn->body = BENCH_BODY_LENGTH;
+            conn->body_left = atol(line + 15);
+        }
+        else if ((0 == strncasecmp(line, "Transfer-Encoding:", 18)) && (NULL != strcasestr(line, "chunked")))
+        {
+            conn->body = BENCH_BODY_CHUNKED;
+            conn->chunk = BENCH_CHUNK_SIZE;
+        }
+        else if ((0 == strncasecmp(line, "Connection:", 11)) && (NULL != strcasestr(line, "close")))
+        {
+            conn->close = 1;
+        }
+    }
+
+    /* 304/204回复没有报文体 */
+    if ((304 == conn->status) || (204 == conn->status))
+    {
+        conn->body = BENCH_BODY_LENGTH;
+        conn->body_left = 0;
+    }
+    if (BENCH_BODY_CLOSE == conn->body)
+    {
+        conn->close = 1;
+    }
+
+    conn->header_done = 1;
+    bench_conn_consume(conn, len);
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_response_parse
+ * 功  能:    解析接收缓冲区中的回复数据，报文体只计数不保存
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 回复接收完毕  0: 数据未到齐  -1: 格式错误
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_response_parse(bench_conn_t *conn)
+{
+    char *end = NULL;
+    long n = 0;
+    int ret = 0;
+
+    if (!conn->header_done)
+    {
+        ret = bench_response_header(conn);
+        if (ret <= 0)
+        {
+            return ret;
+        }
+    }
+
+    switch (conn->body)
+    {
+        case BENCH_BODY_LENGTH:
+            n = (conn->rlen < conn->body_left) ? conn->rlen : conn->body_left;
+            bench_conn_consume(conn, (int)n);
+            conn->body_left -= n;
+            return (0 == conn->body_left) ? 1 : 0;
+
+        case BENCH_BODY_CLOSE:
+            conn->rlen = 0;
+            return 0;
+
+        default:
+            break;
+    }
+
+    /* chunked报文体 */
+    while (1)
+    {
+        switch (conn->chunk)
+        {
+            case BENCH_CHUNK_SIZE:
+            case BENCH_CHUNK_TRAILER:
+                end = memmem(conn->rbuf, conn->rlen, "\r\n", 2);
+                if (NULL == end)
+                {
+                    return (conn->rlen >= BENCH_RBUF_SIZE) ? -1 : 0;
+                }
+                if (BENCH_CHUNK_TRAILER == conn->chunk)
+                {
+                    /* 尾部字段以空行结束 */
+                    ret = (end == conn->rbuf);
+                    bench_conn_consume(conn, (int)(end + 2 - conn->rbuf));
+                    if (ret)
+                    {
+                        return 1;
+                    }
+                    break;
+                }
+                *end = '\0';
+                if (!isxdigit((unsigned char)conn->rbuf[0]))
+                {
+                    return -1;
+                }
+                conn->chunk_left = strtol(conn->rbuf, NULL, 16);
+                conn->chunk = (0 == conn->chunk_left) ? BENCH_CHUNK_TRAILER : BENCH_CHUNK_DATA;
+                bench_conn_consume(conn, (int)(end + 2 - conn->rbuf));
+                break;
+
+            case BENCH_CHUNK_DATA:
+                n = (conn->rlen < conn->chunk_left) ? conn->rlen : conn->chunk_left;
+                bench_conn_consume(conn, (int)n);
+                conn->chunk_left -= n;
+                if (conn->chunk_left > 0)
+                {
+                    return 0;
+                }
+                conn->chunk = BENCH_CHUNK_CRLF;
+                break;
+
+            default:
+                if (conn->rlen < 2)
+                {
+                    return 0;
+                }
+                bench_conn_consume(conn, 2);
+                conn->chunk = BENCH_CHUNK_SIZE;
+                break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_send
+ * 功  能:    发送请求报文，直到发送完毕或socket不可写
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 发送完毕  0: socket不可写  -1: 发送失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_conn_send(bench_conn_t *conn)
+{
+    ssize_t n = 0;
+
+    while (conn->req_sent < conn->req_len)
+    {
+        n = send(conn->fd, conn->req + conn->req_sent, conn->req_len - conn->req_sent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+        }
+        conn->req_sent += n;
+    }
+
+    return 1;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_recv
+ * 功  能:    接收并解析回复报文，直到回复完毕或socket无数据可读
+ * 输  入:    conn: 客户端连接
+ * 输  出:    无
+ * 返回值:    1: 回复接收完毕  0: 数据未到齐  -1: 接收失败  -2: 格式错误
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_conn_recv(bench_conn_t *conn)
+{
+    ssize_t n = 0;
+    int ret = 0;
+
+    while (1)
+    {
+        n = recv(conn->fd, conn->rbuf + conn->rlen, BENCH_RBUF_SIZE - conn->rlen, 0);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+        }
+
+        if (0 == n)
+        {
+            /* 报文体到连接关闭为止的回复，连接关闭即接收完毕 */
+            return (conn->header_done && (BENCH_BODY_CLOSE == conn->body)) ? 1 : -1;
+        }
+
+        conn->thread->bytes += n;
+        conn->rlen += n;
+
+        ret = bench_response_parse(conn);
+        if (0 != ret)
+        {
+            return (ret > 0) ? 1 : -2;
+        }
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_conn_process
+ * 功  能:    驱动连接状态机: 建立连接->发送请求->接收回复，每个阶段处理到
+ *            socket不可读写(EAGAIN)为止
+ * 输  入:    conn:   客户端连接
+ *            events: epoll事件
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_conn_process(bench_conn_t *conn, unsigned int events)
+{
+    socklen_t len = sizeof(int);
+    int err = 0;
+    int ret = 0;
+
+    switch (conn->state)
+    {
+        case BENCH_CONN_CONNECTING:
+            if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+            {
+                return;
+            }
+            if ((getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) || (0 != err))
+            {
+                bench_conn_fail(conn, BENCH_ERR_CONNECT);
+                return;
+            }
+            conn->state = BENCH_CONN_SENDING;
+            /* fall through */
+
+        case BENCH_CONN_SENDING:
+            ret = bench_conn_send(conn);
+            if (ret <= 0)
+            {
+                if (ret < 0)
+                {
+                    bench_conn_fail(conn, BENCH_ERR_IO);
+                }
+                return;
+            }
+            conn->state = BENCH_CONN_RECEIVING;
+            /* fall through */
+
+        case BENCH_CONN_RECEIVING:
+            ret = bench_conn_recv(conn);
+            if (ret > 0)
+            {
+                bench_conn_done(conn);
+            }
+            else if (ret < 0)
+            {
+                bench_conn_fail(conn, (-2 == ret) ? BENCH_ERR_PARSE : BENCH_ERR_IO);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_thread_run
+ * 功  能:    压测线程: 闭环模式下每个连接收到回复后立即发出下一个请求；开环
+ *            模式下按恒定间隔生成请求，没有空闲连接时请求顺延，延迟仍从计划
+ *            发送时间算起(修正协调遗漏，coordinated omission)
+ * 输  入:    arg: 压测线程
+ * 输  出:    无
+ * 返回值:    NULL
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void *bench_thread_run(void *arg)
+{
+    bench_thread_t *thread = (bench_thread_t *)arg;
+    bench_config_t *config = &g_bench_config;
+    struct epoll_event events[BENCH_MAX_EVENTS];
+    bench_conn_t *conn = NULL;
+    long long now = 0;
+    long long wake = 0;
+    int timeout = 0;
+    int n = 0;
+    int i = 0;
+
+    thread->next_due = config->start;
+
+    while (1)
+    {
+        now = bench_now_ns();
+        if (now >= config->end)
+        {
+            break;
+        }
+
+        /* 向空闲连接分派请求，空闲队列按入队顺序处理；立即完成的请求会重新
+           入队，每轮最多分派连接数个请求，避免其他连接的事件得不到处理 */
+        for (i = 0; (i < thread->conn_num) && (NULL != (conn = thread->idle_head)); i++)
+        {
+            if (conn->retry_at > now)
+            {
+                break;
+            }
+            if ((config->rate > 0) && (thread->next_due > now))
+            {
+                break;
+            }
+
+            thread->idle_head = conn->next;
+            if (NULL == thread->idle_head)
+            {
+                thread->idle_tail = NULL;
+            }
+
+            if (config->rate > 0)
+            {
+                bench_conn_issue(conn, thread->next_due);
+                thread->next_due += thread->interval;
+            }
+            else
+            {
+                bench_conn_issue(conn, now);
+            }
+        }
+
+        /* 计算下一次需要分派请求的时间 */
+        wake = now + (long long)BENCH_POLL_MS * 1000000LL;
+        if (NULL != thread->idle_head)
+        {
+            wake = thread->idle_head->retry_at;
+            if ((config->rate > 0) && (thread->next_due > wake))
+            {
+                wake = thread->next_due;
+            }
+        }
+        if (wake > config->end)
+        {
+            wake = config->end;
+        }
+        timeout = (wake > now) ? (int)((wake - now + 999999) / 1000000) : 0;
+
+        n = epoll_wait(thread->epoll_fd, events, BENCH_MAX_EVENTS, timeout);
+        for (i = 0; i < n; i++)
+        {
+            bench_conn_process((bench_conn_t *)events[i].data.ptr, events[i].events);
+        }
+    }
+
+    /* 统计压测结束时未完成和未发出的请求 */
+    for (i = 0; i < thread->conn_num; i++)
+    {
+        if (BENCH_CONN_IDLE != thread->conns[i].state)
+        {
+            thread->inflight++;
+        }
+        bench_conn_close(&thread->conns[i]);
+    }
+    if ((config->rate > 0) && (thread->next_due < config->end))
+    {
+        thread->unsent = (unsigned long)((config->end - thread->next_due) / thread->interval);
+    }
+
+    return NULL;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_report_latency
+ * 功  能:    打印一行延迟统计(毫秒)
+ * 输  入:    name: 请求类型名称
+ *            hist: 延迟直方图
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_report_latency(const char *name, const bench_hist_t *hist)
+{
+    if (0 == hist->count)
+    {
+        return;
+    }
+
+    printf("%-10s %10lu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, hist->count,
+           (double)hist->sum / hist->count / 1e6,
+           bench_hist_percentile(hist, 0.50) / 1e6,
+           bench_hist_percentile(hist, 0.90) / 1e6,
+           bench_hist_percentile(hist, 0.99) / 1e6,
+           bench_hist_percentile(hist, 0.999) / 1e6,
+           hist->max / 1e6);
+}
+
+/*****************************************************************************
+ * 函  数:    bench_report
+ * 功  能:    汇总各压测线程的数据并打印吞吐量及延迟分布
+ * 输  入:    threads: 压测线程数组
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_report(bench_thread_t *threads)
+{
+    bench_config_t *config = &g_bench_config;
+    static bench_hist_t hist[BENCH_REQ_NUM];
+    static bench_hist_t total;
+    unsigned long requests = 0;
+    unsigned long bytes = 0;
+    unsigned long reconnects = 0;
+    unsigned long unsent = 0;
+    unsigned long inflight = 0;
+    unsigned long errors[BENCH_ERR_NUM] = { 0 };
+    unsigned long status[6] = { 0 };
+    double seconds = (double)(config->end - config->start) / 1e9;
+    int t = 0;
+    int i = 0;
+
+    for (t = 0; t < config->thread_num; t++)
+    {
+        requests += threads[t].requests;
+        bytes += threads[t].bytes;
+        reconnects += threads[t].reconnects;
+        unsent += threads[t].unsent;
+        inflight += threads[t].inflight;
+        for (i = 0; i < BENCH_ERR_NUM; i++)
+        {
+            errors[i] += threads[t].errors[i];
+        }
+        for (i = 0; i < 6; i++)
+        {
+            status[i] += threads[t].status[i];
+        }
+        for (i = 0; i < BENCH_REQ_NUM; i++)
+        {
+            bench_hist_merge(&hist[i], &threads[t].hist[i]);
+            bench_hist_merge(&total, &threads[t].hist[i]);
+        }
+    }
+
+    printf("%lu requests in %.2fs, %.2f MB read, %lu connections opened\n",
+           requests, seconds, bytes / 1048576.0, reconnects);
+    printf("throughput: %.2f req/s, %.2f MB/s", requests / seconds, bytes / 1048576.0 / seconds);
+    if (config->rate > 0)
+    {
+        printf(" (target %.2f req/s, %lu not sent)", config->rate, unsent);
+    }
+    printf("\n");
+    printf("responses: 2xx %lu, 3xx %lu, 4xx %lu, 5xx %lu, other %lu\n",
+           status[2], status[3], status[4], status[5], status[0] + status[1]);
+    printf("errors: connect %lu, io %lu, parse %lu, unfinished %lu\n",
+           errors[BENCH_ERR_CONNECT], errors[BENCH_ERR_IO], errors[BENCH_ERR_PARSE], inflight);
+
+    printf("\n%-10s %10s %10s %10s %10s %10s %10s %10s\n",
+           "latency", "count", "mean(ms)", "p50", "p90", "p99", "p99.9", "max");
+    bench_report_latency("all", &total);
+    for (i = 0; i < BENCH_REQ_NUM; i++)
+    {
+        bench_report_latency(g_bench_req_names[i], &hist[i]);
+    }
+}
+
+/*****************************************************************************
+ * 函  数:    bench_mix_config
+ * 功  能:    解析请求比例参数"static,get_cgi,post_cgi"，如"80,15,5"
+ * 输  入:    arg: 参数字符串
+ * 输  出:    g_bench_config.weight: 各类请求的比例
+ * 返回值:    0: 成功  -1: 格式错误
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static int bench_mix_config(const char *arg)
+{
+    char *end = NULL;
+    int total = 0;
+    int i = 0;
+
+    for (i = 0; i < BENCH_REQ_NUM; i++)
+    {
+        g_bench_config.weight[i] = (int)strtol(arg, &end, 10);
+        if ((end == arg) || (g_bench_config.weight[i] < 0))
+        {
+            return -1;
+        }
+        total += g_bench_config.weight[i];
+
+        if (i < BENCH_REQ_NUM - 1)
+        {
+            if (',' != *end)
+            {
+                return -1;
+            }
+            arg = end + 1;
+        }
+    }
+
+    return (('\0' == *end) && (total > 0)) ? 0 : -1;
+}
+
+/*****************************************************************************
+ * 函  数:    bench_usage
+ * 功  能:    打印命令行用法
+ * 输  入:    prog: 程序名
+ * 输  出:    无
+ * 返回值:    无
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-H host] [-p port] [-t threads] [-c connections] [-d seconds] [-R rate] [-n]\n"
+            "          [-m static,get_cgi,post_cgi] [-s path] [-g path] [-P path] [-b body]\n"
+            "  -H host          server IPv4 address (default 127.0.0.1)\n"
+            "  -p port          server port (default %d)\n"
+            "  -t threads       client threads (default %d)\n"
+            "  -c connections   concurrent connections (default %d)\n"
+            "  -d seconds       test duration (default %d)\n"
+            "  -R rate          open loop: constant total request rate per second, latency is\n"
+            "                   measured from the scheduled send time (default 0: closed loop)\n"
+            "  -n               no keep-alive, one request per connection\n"
+            "  -m s,g,p         request mix weights for static/GET CGI/POST CGI (default 100,0,0)\n"
+            "  -s path          static request URI (default %s)\n"
+            "  -g path          GET CGI request URI (default %s)\n"
+            "  -P path          POST CGI request URI (default %s)\n"
+            "  -b body          POST CGI request body (default %s)\n",
+            prog, BENCH_SERVER_PORT, BENCH_THREADS, BENCH_CONNECTIONS, BENCH_DURATION,
+            BENCH_STATIC_PATH, BENCH_GET_CGI_PATH, BENCH_POST_CGI_PATH, BENCH_POST_BODY);
+}
+
+/*****************************************************************************
+ * 函  数:    main
+ * 功  能:    主程序: 解析参数，启动压测线程，压测结束后打印结果
+ * 输  入:    无
+ * 输  出:    无
+ * 返回值:    0: 成功  1: 失败
+ * 创  建:    2026-10-16 changzehai(DTT)
+ * 更  新:    无
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+    bench_config_t *config = &g_bench_config;
+    bench_thread_t *threads = NULL;
+    bench_thread_t *thread = NULL;
+    int opt = 0;
+    int t = 0;
+    int i = 0;
+
+    config->host = "127.0.0.1";
+    config->port = BENCH_SERVER_PORT;
+    config->thread_num = BENCH_THREADS;
+    config->conn_num = BENCH_CONNECTIONS;
+    config->duration = BENCH_DURATION;
+    config->keepalive = 1;
+    config->weight[BENCH_REQ_STATIC] = 100;
+    config->path[BENCH_REQ_STATIC] = BENCH_STATIC_PATH;
+    config->path[BENCH_REQ_GET_CGI] = BENCH_GET_CGI_PATH;
+    config->path[BENCH_REQ_POST_CGI] = BENCH_POST_CGI_PATH;
+    config->body = BENCH_POST_BODY;
+
+    while ((opt = getopt(argc, argv, "H:p:t:c:d:R:nm:s:g:P:b:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'H':
+                config->host = optarg;
+                break;
+            case 'p':
+                config->port = atoi(optarg);
+                break;
+            case 't':
+                config->thread_num = atoi(optarg);
+                break;
+            case 'c':
+                config->conn_num = atoi(optarg);
+                break;
+            case 'd':
+                config->duration = atoi(optarg);
+                break;
+            case 'R':
+                config->rate = atof(optarg);
+                break;
+            case 'n':
+                config->keepalive = 0;
+                break;
+            case 'm':
+                if (bench_mix_config(optarg) < 0)
+                {
+                    bench_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 's':
+                config->path[BENCH_REQ_STATIC] = optarg;
+                break;
+            case 'g':
+                config->path[BENCH_REQ_GET_CGI] = optarg;
+                break;
+            case 'P':
+                config->path[BENCH_REQ_POST_CGI] = optarg;
+                break;
+            case 'b':
+                config->body = optarg;
+                break;
+            default:
+                bench_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if ((config->thread_num <= 0) || (config->conn_num <= 0) || (config->duration <= 0) ||
+        (config->rate < 0))
+    {
+        bench_usage(argv[0]);
+        return 1;
+    }
+    if (config->thread_num > config->conn_num)
+    {
+        config->thread_num = config->conn_num;
+    }
+
+    config->addr.sin_family = AF_INET;
+    config->addr.sin_port = htons(config->port);
+    if (1 != inet_pton(AF_INET, config->host, &config->addr.sin_addr))
+    {
+        fprintf(stderr, "invalid host: %s\n", config->host);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    threads = (bench_thread_t *)calloc(config->thread_num, sizeof(bench_thread_t));
+    if (NULL == threads)
+    {
+        perror("calloc failed");
+        return 1;
+    }
+
+    printf("%s:%d, %d threads, %d connections, %ds, %s, keep-alive %s\n",
+           config->host, config->port, config->thread_num, config->conn_num, config->duration,
+           (config->rate > 0) ? "open loop" : "closed loop", config->keepalive ? "on" : "off");
+    printf("mix: static %d (%s), get-cgi %d (%s), post-cgi %d (%s)\n\n",
+           config->weight[BENCH_REQ_STATIC], config->path[BENCH_REQ_STATIC],
+           config->weight[BENCH_REQ_GET_CGI], config->path[BENCH_REQ_GET_CGI],
+           config->weight[BENCH_REQ_POST_CGI], config->path[BENCH_REQ_POST_CGI]);
+    fflush(stdout);
+
+    /* 连接平均分配给各压测线程，初始全部空闲 */
+    for (t = 0; t < config->thread_num; t++)
+    {
+        thread = &threads[t];
+        thread->id = t;
+        thread->seed = (unsigned int)(time(NULL) ^ (t * 2654435761U));
+        thread->conn_num = config->conn_num / config->thread_num + (t < config->conn_num % config->thread_num);
+        if (config->rate > 0)
+        {
+            thread->interval = (long long)(1e9 * config->thread_num / config->rate);
+            if (thread->interval <= 0)
+            {
+                thread->interval = 1;
+            }
+        }
+
+        thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        thread->conns = (bench_conn_t *)calloc(thread->conn_num, sizeof(bench_conn_t));
+        if ((thread->epoll_fd < 0) || (NULL == thread->conns))
+        {
+            perror("bench thread init failed");
+            return 1;
+        }
+
+        for (i = 0; i < thread->conn_num; i++)
+        {
+            thread->conns[i].fd = -1;
+            thread->conns[i].thread = thread;
+            bench_idle_push(thread, &thread->conns[i]);
+        }
+    }
+
+    config->start = bench_now_ns();
+    config->end = config->start + (long long)config->duration * 1000000000LL;
+
+    for (t = 0; t < config->thread_num; t++)
+    {
+        if (pthread_create(&threads[t].tid, NULL, bench_thread_run, &threads[t]) != 0)
+        {
+            perror("pthread_create failed");
+            return 1;
+        }
+    }
+
+    for (t = 0; t < config->thread_num; t++)
+    {
+        pthread_join(threads[t].tid, NULL);
+    }
+
+    bench_report(threads);
+
+    return 0;
+}